@@ -25,6 +25,26 @@
 #define ACHORDION_STREAK
 // #define ACHORDION_LOG
 
+// Adjust the tapping term of keys that misfire, see features/misfire.h
+// #define MISFIRE_NUDGE
+
+// Tap-hold keys tracked by key statistics and the misfire detector. The keymap
+// has 19 tap-hold positions: 14 mod-taps and 5 layer-taps on the base layer,
+// which the symbol layer's layer-tap to SNUM shares a position with. Layout
+// permutations keep mod-taps in place. One slot is spare.
+#define TAP_HOLD_SLOTS 20
+#define KEY_STATS_TAP_HOLD_SLOTS TAP_HOLD_SLOTS
+#define MISFIRE_SLOTS TAP_HOLD_SLOTS
+
+// Type home row letters on press and retract them if the key is held, see
+// features/speculative_tap.h
+// #define SPECULATIVE_TAP
+
+// Repeat navigation keys and backspace at an accelerating rate while they are
+// held, see features/accel_repeat.h
+#define ACCEL_REPEAT
+#define ACCEL_REPEAT_DELAY 250
+
 // Support for up to 16 layers
 #define LAYER_STATE_16BIT
 
@@ -41,8 +61,20 @@
 #undef RGB_MATRIX_TIMEOUT
 #define RGB_MATRIX_TIMEOUT 300000
 
-#undef MOUSEKEY_WHEEL_DELAY
-#define MOUSEKEY_WHEEL_DELAY 0
+// Scroll the mouse wheel keys smoothly, see features/smooth_scroll.h
+#define SMOOTH_SCROLL
+
+// Scroll in fractions of a detent on hosts with high resolution scrolling,
+// together with the pointing device lines in rules.mk. Off, so scrolling moves
+// in whole detents: the pointing device feature costs flash that hasn't been
+// measured on this build, and macOS ignores the multiplier and scrolls faster
+// instead.
+// #define POINTING_DEVICE_HIRES_SCROLL_ENABLE
+// #define WHEEL_EXTENDED_REPORT
+
+// Move the mouse cursor with velocity and friction instead of QMK's fixed
+// steps, see features/kinetic_mouse.h
+#define KINETIC_MOUSE
 
 #define RGB_MATRIX_DEFAULT_SPD 60
 
@@ -55,6 +87,27 @@
 // Type lowercase if shift is applied during Caps Word is on
 #define CAPS_WORD_INVERT_ON_SHIFT
 
+// Dynamic macros are handled in userspace, see features/dynamic_macros.h.
+// Two macros share the buffer, each event takes a byte.
+#define DYNAMIC_MACRO_BUFFER_BYTES 384
+// Keep recorded macros across power cycles.
+#define DYNAMIC_MACRO_EEPROM
+
+// Tap-hold tuning parameters are saved to EEPROM, see features/tuning.h.
+// Saves rotate through the slots to spread wear, a slot has room for 10
+// parameters.
+#define TUNING_EEPROM_SLOTS 8
+#define TUNING_EEPROM_SLOT_SIZE 23
+
+// User EEPROM datablock layout
+//  - Dynamic macros: 5 byte header followed by the macro buffer
+//  - Tuning parameters: slots of saved parameters
+#define DYNAMIC_MACRO_EEPROM_OFFSET 0
+#define DYNAMIC_MACRO_EEPROM_SIZE (5 + DYNAMIC_MACRO_BUFFER_BYTES)
+#define TUNING_EEPROM_OFFSET (DYNAMIC_MACRO_EEPROM_OFFSET + DYNAMIC_MACRO_EEPROM_SIZE)
+#define TUNING_EEPROM_SIZE (TUNING_EEPROM_SLOTS * TUNING_EEPROM_SLOT_SIZE)
+#define EECONFIG_USER_DATA_SIZE (TUNING_EEPROM_OFFSET + TUNING_EEPROM_SIZE)
+
 // Disable RGB_* keycodes
 #define RGBLIGHT_DISABLE_KEYCODES
 #define RGB_MATRIX_DISABLE_KEYCODES
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "quantum.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//------------------------------------------------------------------------------
+// ErgoDox EZ matrix
+//
+// Userspace replacement for the stock ErgoDox EZ matrix scanner (see
+// `matrix.c`). The left half sits behind an MCP23018 I/O expander on I2C and
+// the right half is wired directly to the ATmega32U4. Both halves are scanned
+// in the same pass, and the left half is dropped and retried with a backoff
+// when the expander stops answering instead of stalling the scan loop.
+//
+// tools/host/matrix_test.c runs it against a mocked expander and port.
+//------------------------------------------------------------------------------
+
+// Number of full matrix scans completed during the last second.
+uint16_t ergodox_matrix_scan_rate(void);
+
+// Number of I2C errors seen since boot, saturating at UINT16_MAX.
+uint16_t ergodox_matrix_i2c_errors(void);
+
+// Whether the left half (MCP23018) is currently responding.
+bool ergodox_matrix_left_connected(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,89 @@
+#include "accel_repeat.h"
+
+#define FIXED_SHIFT 8
+
+// The repeating key, KC_NO when none. `interval` is in 8.8 fixed point.
+static struct {
+    uint16_t keycode;
+    keypos_t key;
+    uint16_t next;
+    uint16_t interval;
+    bool     lift_shift;
+} repeat = {.keycode = KC_NO};
+
+__attribute__((weak)) uint16_t accel_repeat_keycode(uint16_t keycode, keyrecord_t *record) {
+    return KC_NO;
+}
+
+//------------------------------------------------------------------------------
+// Helpers
+//------------------------------------------------------------------------------
+static bool is_modifier(uint16_t keycode, keyrecord_t *record) {
+    return IS_MODIFIER_KEYCODE(keycode)
+        || IS_QK_ONE_SHOT_MOD(keycode)
+        || (IS_QK_MOD_TAP(keycode) && record->tap.count == 0);
+}
+
+static void tap(void) {
+    if (!repeat.lift_shift) {
+        tap_code16(repeat.keycode);
+        return;
+    }
+    const uint8_t mods = get_mods();
+    del_weak_mods(MOD_MASK_SHIFT);
+#ifndef NO_ACTION_ONESHOT
+    del_oneshot_mods(MOD_MASK_SHIFT);
+#endif
+    unregister_mods(MOD_MASK_SHIFT);
+    tap_code16(repeat.keycode);
+    set_mods(mods);
+}
+
+//------------------------------------------------------------------------------
+// Processing
+//------------------------------------------------------------------------------
+bool process_accel_repeat(uint16_t keycode, keyrecord_t *record) {
+    const uint16_t repeated = accel_repeat_keycode(keycode, record);
+
+    if (!record->event.pressed) {
+        if (repeat.keycode != KC_NO && KEYEQ(record->event.key, repeat.key)) {
+            repeat.keycode = KC_NO;
+        }
+        // The press was tapped, there is nothing to release.
+        return repeated == KC_NO;
+    }
+
+    if (repeated == KC_NO) {
+        if (!is_modifier(keycode, record)) {
+            repeat.keycode = KC_NO;
+        }
+        return true;
+    }
+
+    repeat.keycode    = repeated;
+    repeat.key        = record->event.key;
+    repeat.next       = timer_read() + ACCEL_REPEAT_DELAY;
+    repeat.interval   = ACCEL_REPEAT_INTERVAL << FIXED_SHIFT;
+    repeat.lift_shift = repeated != keycode;
+    tap();
+    return false;
+}
+
+void accel_repeat_task(void) {
+    if (repeat.keycode == KC_NO) {
+        return;
+    }
+    const uint16_t now = timer_read();
+    if (!timer_expired(now, repeat.next)) {
+        return;
+    }
+
+    tap();
+    // Timed from now rather than the last deadline, so that a late scan
+    // doesn't send a burst to catch up.
+    repeat.next = now + (repeat.interval >> FIXED_SHIFT);
+
+    const uint16_t step = ((uint32_t)repeat.interval * ACCEL_REPEAT_ACCEL) >> 8;
+    const uint16_t min  = ACCEL_REPEAT_MIN_INTERVAL << FIXED_SHIFT;
+    repeat.interval     = repeat.interval - step > min ? repeat.interval - step : min;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "quantum.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//------------------------------------------------------------------------------
+// Accelerated repeat
+//
+// Key repeat done by the firmware for a few keys, mostly navigation, instead
+// of the host's fixed repeat rate. A held key repeats after an initial delay,
+// and each repeat comes sooner than the last until the shortest interval:
+//
+//     interval = max(interval - interval * ACCEL_REPEAT_ACCEL / 256,
+//                    ACCEL_REPEAT_MIN_INTERVAL)
+//
+// The interval is kept in 8.8 fixed point milliseconds. With the defaults it
+// goes from 60 ms to 10 ms in about 30 repeats, just under a second.
+//
+// The press is tapped right away and the key is never held down on the host,
+// so the host doesn't repeat it on top. Repeats are tapped with the mods held
+// at that moment, so Shift or Alt can be added or dropped while the key is
+// held. Only one key repeats at a time. Another press stops it, unless it is a
+// modifier.
+//
+// Which keys repeat, and what they type, is decided per press by
+// `accel_repeat_keycode()`, which repeats nothing by default. When it returns
+// another keycode than the pressed one, Shift is lifted for its taps, as with
+// custom shift keys.
+//------------------------------------------------------------------------------
+
+#ifndef ACCEL_REPEAT_DELAY
+#    define ACCEL_REPEAT_DELAY 250
+#endif
+
+#ifndef ACCEL_REPEAT_INTERVAL
+#    define ACCEL_REPEAT_INTERVAL 60
+#endif
+
+#ifndef ACCEL_REPEAT_MIN_INTERVAL
+#    define ACCEL_REPEAT_MIN_INTERVAL 10
+#endif
+
+// Fraction of the interval taken off at each repeat, out of 256.
+#ifndef ACCEL_REPEAT_ACCEL
+#    define ACCEL_REPEAT_ACCEL 16
+#endif
+
+_Static_assert(ACCEL_REPEAT_INTERVAL < 256 && ACCEL_REPEAT_MIN_INTERVAL <= ACCEL_REPEAT_INTERVAL,
+               "accelerated repeat intervals are 8.8 fixed point");
+
+// Call from `process_record_user()` after tap-hold keys are settled and
+// before custom shift keys. Returns false for repeating keys.
+bool process_accel_repeat(uint16_t keycode, keyrecord_t *record);
+
+// Call from `matrix_scan_user()` to send the repeats.
+void accel_repeat_task(void);
+
+// Keycode a key press types and repeats, KC_NO for keys that don't repeat.
+uint16_t accel_repeat_keycode(uint16_t keycode, keyrecord_t *record);
+
+#ifdef __cplusplus
+}
+#endif
@@ -22,6 +22,7 @@
 
 #include "achordion.h"
 #include "debug_helper.h"
+#include "stack_watch.h"
 
 #if !defined(IS_QK_MOD_TAP)
 // Attempt to detect out-of-date QMK installation, which would fail with
@@ -36,6 +37,13 @@ static uint16_t tap_hold_keycode = KC_NO;
 static uint16_t hold_timer = 0;
 // Eagerly applied mods, if any.
 static uint8_t eager_mods = 0;
+// Whether QMK considered the active key held before its tapping term, as it
+// does for permissive hold.
+static bool early_hold = false;
+// Press of another key held back in STATE_NESTED, and the reason to report if
+// the active key is settled as tapped after all.
+static keyrecord_t nested_record;
+static uint8_t nested_reason = ACHORDION_SETTLED_BY_CHORD;
 
 #ifdef ACHORDION_STREAK
 // Timer for typing streak
@@ -55,6 +63,9 @@ enum {
   STATE_TAPPING,
   // Active tap-hold key has been settled as held.
   STATE_HOLDING,
+  // Active tap-hold key would be settled as tapped, but it holds on nested
+  // taps, so the other key's press is held back until either key is released.
+  STATE_NESTED,
   // This state is set while calling `process_record()`, which will recursively
   // call `process_achordion()`. This state is checked so that we don't process
   // events generated by Achordion and potentially create an infinite loop.
@@ -65,10 +76,17 @@ static uint8_t achordion_state = STATE_RELEASED;
 // Calls `process_record()` with state set to RECURSING.
 static void recursively_process_record(keyrecord_t* record, uint8_t state) {
   achordion_state = STATE_RECURSING;
+  stack_watch_mark(STACK_MARK_ACHORDION);
   process_record(record);
   achordion_state = state;
 }
 
+// Converts a 5-bit mod, where bit 4 selects right-hand mods for all the others,
+// to an 8-bit mod mask.
+static uint8_t mods_to_8bit(uint8_t mod) {
+  return (mod & 0x10) ? (mod & 0x0F) << 4 : mod & 0x0F;
+}
+
 // Clears eagerly-applied mods.
 static void clear_eager_mods(void) {
   unregister_mods(eager_mods);
@@ -76,12 +94,59 @@ static void clear_eager_mods(void) {
 }
 
 // Sends hold press event and settles the active tap-hold key as held.
-static void settle_as_hold(void) {
+static void settle_as_hold(uint8_t reason) {
+  achordion_settled(tap_hold_keycode, &tap_hold_record, true, reason);
   clear_eager_mods();
   // Create hold press event.
   recursively_process_record(&tap_hold_record, STATE_HOLDING);
 }
 
+// Sends tap press and release events and settles the active tap-hold key as
+// tapped.
+static void settle_as_tap(uint8_t reason) {
+  achordion_settled(tap_hold_keycode, &tap_hold_record, false, reason);
+  clear_eager_mods();  // Clear in case eager mods were set.
+
+  dprintln("Achordion: Plumbing tap press.");
+  tap_hold_record.tap.count = 1;  // Revise event as a tap.
+  tap_hold_record.tap.interrupted = true;
+  // Plumb tap press event.
+  recursively_process_record(&tap_hold_record, STATE_TAPPING);
+
+  send_keyboard_report();
+#if TAP_CODE_DELAY > 0
+  wait_ms(TAP_CODE_DELAY);
+#endif  // TAP_CODE_DELAY > 0
+
+  dprintln("Achordion: Plumbing tap release.");
+  tap_hold_record.event.pressed = false;
+  // The tap is released now, not when the key was pressed.
+  tap_hold_record.event.time = timer_read() | 1;
+  // Plumb tap release event.
+  recursively_process_record(&tap_hold_record, STATE_TAPPING);
+}
+
+// Plumbs the press held back in STATE_NESTED, once the active key is settled.
+static void release_nested_press(void) {
+  dprintln("Achordion: Plumbing nested press.");
+  recursively_process_record(&nested_record, achordion_state);
+}
+
+// Whether QMK settled a tap-hold key press as held before its tapping term.
+static bool is_early_hold(uint16_t keycode, keyrecord_t* record) {
+  return record->tap.count == 0 &&
+         TIMER_DIFF_16(timer_read(), record->event.time) <
+             GET_TAPPING_TERM(keycode, record);
+}
+
+// Reports a tap-hold key press that keeps QMK's decision.
+static void settled_by_qmk(uint16_t keycode, keyrecord_t* record) {
+  achordion_settled(keycode, record, record->tap.count == 0,
+                    is_early_hold(keycode, record)
+                        ? ACHORDION_SETTLED_BY_PERMISSIVE_HOLD
+                        : ACHORDION_SETTLED_BY_QMK);
+}
+
 const char* state_str(uint8_t state) {
     switch (state) {
         case STATE_UNSETTLED:
@@ -92,6 +157,8 @@ const char* state_str(uint8_t state) {
             return "  TAPPING";
         case STATE_HOLDING:
             return "  HOLDING";
+        case STATE_NESTED:
+            return "   NESTED";
         case STATE_RECURSING:
             return "RECURSING";
         default:
@@ -135,11 +202,13 @@ bool process_achordion(uint16_t keycode, keyrecord_t* record) {
         tap_hold_keycode = keycode;
         tap_hold_record = *record;
         hold_timer = record->event.time + timeout;
+        early_hold = is_early_hold(keycode, record);
 
-        if (is_mt) {  // Apply mods immediately if they are "eager."
-          uint8_t mod = mod_config(QK_MOD_TAP_GET_MODS(tap_hold_keycode));
-          if (achordion_eager_mod(mod)) {
-            eager_mods = ((mod & 0x10) == 0) ? mod : (mod << 4);
+        if (IS_QK_MOD_TAP(keycode)) {  // Apply mods immediately if "eager."
+          const uint8_t mods =
+              mods_to_8bit(mod_config(QK_MOD_TAP_GET_MODS(tap_hold_keycode)));
+          if (achordion_eager_mods(tap_hold_keycode, mods)) {
+            eager_mods = mods;
             register_mods(eager_mods);
           }
         }
@@ -150,17 +219,53 @@ bool process_achordion(uint16_t keycode, keyrecord_t* record) {
       }
     }
 
+    // Otherwise QMK's decision stands.
+    if (is_tap_hold && record->event.pressed && is_key_event) {
+      settled_by_qmk(keycode, record);
+    }
+
 #ifdef ACHORDION_STREAK
     streak_timer = (timer_read() + achordion_streak_timeout(keycode)) | 1;
 #endif
     return true;  // Otherwise, continue with default handling.
   }
 
+  if (achordion_state == STATE_NESTED) {
+    const bool is_nested_key =
+        is_key_event &&
+        record->event.key.row == nested_record.event.key.row &&
+        record->event.key.col == nested_record.event.key.col;
+
+    if (is_nested_key && !record->event.pressed) {
+      // The other key was tapped within the hold.
+      dprintln("Achordion: Nested tap. Plumbing hold press.");
+      settle_as_hold(ACHORDION_SETTLED_BY_NESTED_TAP);
+      release_nested_press();
+      recursively_process_record(record, achordion_state);
+      return false;
+    }
+
+    if (keycode == tap_hold_keycode && !record->event.pressed) {
+      // A roll, settle as tapped and handle the release below.
+      settle_as_tap(nested_reason);
+      release_nested_press();
+    } else if (record->event.pressed) {
+      // A third key, settle as the other key first decided.
+      settle_as_tap(nested_reason);
+      release_nested_press();
+      recursively_process_record(record, achordion_state);
+      return false;
+    } else {
+      return true;  // Release of a key pressed before, nothing to decide.
+    }
+  }
+
   if (keycode == tap_hold_keycode && !record->event.pressed) {
     // The active tap-hold key is being released.
     if (achordion_state == STATE_HOLDING) {
       dprintln("Achordion: Key released. Plumbing hold release.");
       tap_hold_record.event.pressed = false;
+      tap_hold_record.event.time = record->event.time;
       // Plumb hold release event.
       recursively_process_record(&tap_hold_record, STATE_RELEASED);
     } else {
@@ -195,34 +300,53 @@ bool process_achordion(uint16_t keycode, keyrecord_t* record) {
     // events back into the handling pipeline so that QMK features and other
     // user code can see them. This is done by calling `process_record()`, which
     // in turn calls most handlers including `process_record_user()`.
-    if (!is_streak && (!is_key_event || (is_tap_hold && record->tap.count == 0) ||
-        achordion_chord(tap_hold_keycode, &tap_hold_record, keycode, record))) {
-      dprintln("Achordion: Plumbing hold press.");
-      settle_as_hold();
+    uint8_t reason = ACHORDION_SETTLED_BY_CHORD;
+    bool hold = false;
+    if (is_streak) {
+      reason = ACHORDION_SETTLED_BY_STREAK;
+    } else if (!is_key_event || (is_tap_hold && record->tap.count == 0)) {
+      reason = ACHORDION_SETTLED_BY_OTHER_HOLD;
+      hold = true;
     } else {
-      clear_eager_mods();  // Clear in case eager mods were set.
+      hold = achordion_chord(tap_hold_keycode, &tap_hold_record, keycode, record);
+      if (hold && early_hold) {
+        reason = ACHORDION_SETTLED_BY_PERMISSIVE_HOLD;
+      }
+    }
 
-      dprintln("Achordion: Plumbing tap press.");
-      tap_hold_record.tap.count = 1;  // Revise event as a tap.
-      tap_hold_record.tap.interrupted = true;
-      // Plumb tap press event.
-      recursively_process_record(&tap_hold_record, STATE_TAPPING);
+    if (!hold && reason != ACHORDION_SETTLED_BY_STREAK && is_key_event &&
+        !is_tap_hold && achordion_nested_hold(tap_hold_keycode)) {
+      // Wait for either key's release: a tap of the other key within the
+      // hold settles as held, as with permissive hold. A streak is typing,
+      // where fast rolls overlap the same way, so it always taps.
+      dprintln("Achordion: Holding back nested press.");
+      nested_record = *record;
+      nested_reason = reason;
+      achordion_state = STATE_NESTED;
+      return false;
+    }
 
-      send_keyboard_report();
-#if TAP_CODE_DELAY > 0
-      wait_ms(TAP_CODE_DELAY);
-#endif  // TAP_CODE_DELAY > 0
+    if (hold) {
+      dprintln("Achordion: Plumbing hold press.");
+      settle_as_hold(reason);
+    } else {
+      settle_as_tap(reason);
+    }
 
-      dprintln("Achordion: Plumbing tap release.");
-      tap_hold_record.event.pressed = false;
-      // Plumb tap release event.
-      recursively_process_record(&tap_hold_record, STATE_TAPPING);
+    // The other tap-hold key, if any, keeps QMK's decision.
+    if (is_tap_hold && is_key_event) {
+      settled_by_qmk(keycode, record);
     }
 
     recursively_process_record(record, achordion_state);  // Re-process event.
     return false;  // Block the original event.
   }
 
+  // A tap-hold key pressed while another one is settled keeps QMK's decision.
+  if (is_tap_hold && record->event.pressed && is_key_event) {
+    settled_by_qmk(keycode, record);
+  }
+
 #ifdef ACHORDION_STREAK
   // update idle timer on regular keys event
   streak_timer = (timer_read() + achordion_streak_timeout(keycode)) | 1;
@@ -234,7 +358,13 @@ void achordion_task(void) {
   if (achordion_state == STATE_UNSETTLED &&
       timer_expired(timer_read(), hold_timer)) {
     dprintln("Achordion: Timeout. Plumbing hold press.");
-    settle_as_hold();  // Timeout expired, settle the key as held.
+    // Timeout expired, settle the key as held.
+    settle_as_hold(ACHORDION_SETTLED_BY_TIMEOUT);
+  } else if (achordion_state == STATE_NESTED &&
+             timer_expired(timer_read(), hold_timer)) {
+    dprintln("Achordion: Timeout. Plumbing hold and nested press.");
+    settle_as_hold(ACHORDION_SETTLED_BY_TIMEOUT);
+    release_nested_press();
   }
 
 #ifdef ACHORDION_STREAK
@@ -254,6 +384,10 @@ static bool on_left_hand(keypos_t pos) {
 #endif
 }
 
+bool achordion_pending(void) {
+  return achordion_state == STATE_UNSETTLED || achordion_state == STATE_NESTED;
+}
+
 bool achordion_opposite_hands(const keyrecord_t* tap_hold_record,
                               const keyrecord_t* other_record) {
   return on_left_hand(tap_hold_record->event.key) !=
@@ -274,9 +408,19 @@ __attribute__((weak)) uint16_t achordion_timeout(uint16_t tap_hold_keycode) {
   return 1000;
 }
 
+__attribute__((weak)) void achordion_settled(uint16_t tap_hold_keycode,
+                                            keyrecord_t* tap_hold_record,
+                                            bool hold, uint8_t reason) {}
+
+// By default, tap-hold keys don't hold on nested taps.
+__attribute__((weak)) bool achordion_nested_hold(uint16_t tap_hold_keycode) {
+  return false;
+}
+
 // By default, Shift and Ctrl mods are eager, and Alt and GUI are not.
-__attribute__((weak)) bool achordion_eager_mod(uint8_t mod) {
-  return (mod & (MOD_LALT | MOD_LGUI)) == 0;
+__attribute__((weak)) bool achordion_eager_mods(uint16_t tap_hold_keycode,
+                                                uint8_t mods) {
+  return (mods & (MOD_MASK_ALT | MOD_MASK_GUI)) == 0;
 }
 
 #ifdef ACHORDION_STREAK
@@ -150,26 +150,89 @@ bool achordion_chord(uint16_t tap_hold_keycode, keyrecord_t* tap_hold_record,
 uint16_t achordion_timeout(uint16_t tap_hold_keycode);
 
 /**
- * Optional callback defining which mods are "eagerly" applied.
+ * Optional callback defining which mod-taps are "eagerly" applied.
  *
- * This callback defines  which mods are "eagerly" applied while a mod-tap
- * key is still being settled. This is helpful to reduce delay particularly when
- * using mod-tap keys with an external mouse.
+ * This callback defines whether the mods of a mod-tap key are "eagerly"
+ * applied while the key is still being settled. This is helpful to reduce
+ * delay particularly when using mod-tap keys with an external mouse. It is
+ * called for any combination of mods, such as `MEH_T()` and `ALL_T()` keys.
  *
  * Define this callback in your keymap.c. The default callback is eager for
- * Shift and Ctrl, and not for Alt and GUI:
+ * keys that have only Shift and Ctrl mods, and not for Alt and GUI:
  *
- *     bool achordion_eager_mod(uint8_t mod) {
- *       return (mod & (MOD_LALT | MOD_LGUI)) == 0;
+ *     bool achordion_eager_mods(uint16_t tap_hold_keycode, uint8_t mods) {
+ *       return (mods & (MOD_MASK_ALT | MOD_MASK_GUI)) == 0;
  *     }
  *
- * @note `mod` should be compared with `MOD_` prefixed codes, not `KC_` codes,
- * described at <https://docs.qmk.fm/#/mod_tap>.
+ * @note `mods` is an 8-bit mod mask as used by `register_mods()`, compare it
+ * with `MOD_BIT()` or `MOD_MASK_` codes, not with the 5-bit `MOD_` codes used
+ * in mod-tap keycodes.
  *
- * @param mod Modifier `MOD_` code.
- * @return True if the modifier should be eagerly applied.
+ * @param tap_hold_keycode Keycode of the mod-tap key.
+ * @param mods Mods of the key as an 8-bit mod mask.
+ * @return True if the mods should be eagerly applied.
  */
-bool achordion_eager_mod(uint8_t mod);
+bool achordion_eager_mods(uint16_t tap_hold_keycode, uint8_t mods);
+
+/**
+ * Optional callback to hold a tap-hold key when another key is tapped within
+ * it.
+ *
+ * When the chord rule would settle the tap-hold key as tapped, a key for which
+ * this returns true waits instead, holding back the other key's press:
+ *
+ *  - If the other key is released first, the tap-hold key is held, as with
+ *    QMK's permissive hold. Same-hand shortcuts like Cmd+C work this way.
+ *  - If the tap-hold key is released first, or a third key is pressed, it is
+ *    tapped as first decided.
+ *
+ * A typing streak still settles the key as tapped right away, since fast
+ * rolls like "se" overlap just like a nested tap. Use
+ * `achordion_check_streak()` to let shortcuts through a streak.
+ *
+ * @param tap_hold_keycode Keycode of the tap-hold key.
+ * @return True to hold the key on nested taps.
+ */
+bool achordion_nested_hold(uint16_t tap_hold_keycode);
+
+/** Reasons passed to `achordion_settled()`. */
+enum achordion_settle_reason {
+  /** QMK's decision, Achordion was bypassed or the key was tapped. */
+  ACHORDION_SETTLED_BY_QMK,
+  /** QMK's early hold, as with permissive hold, confirmed by the chord rule. */
+  ACHORDION_SETTLED_BY_PERMISSIVE_HOLD,
+  /** No other key was pressed within `achordion_timeout()`. */
+  ACHORDION_SETTLED_BY_TIMEOUT,
+  /** `achordion_chord()` decided. */
+  ACHORDION_SETTLED_BY_CHORD,
+  /** The other key was pressed during a typing streak. */
+  ACHORDION_SETTLED_BY_STREAK,
+  /** The other key was a held tap-hold key or not a key event. */
+  ACHORDION_SETTLED_BY_OTHER_HOLD,
+  /** The other key was tapped within the hold, see `achordion_nested_hold()`. */
+  ACHORDION_SETTLED_BY_NESTED_TAP,
+};
+
+/**
+ * Optional callback, called when a tap-hold key is settled.
+ *
+ * Called once per press of a tap-hold key, with the decision and the path
+ * that led to it, before the tap or hold is sent. Keys pressed while another
+ * tap-hold key is active keep QMK's decision and are reported as such.
+ *
+ * @param tap_hold_keycode Keycode of the tap-hold key.
+ * @param tap_hold_record keyrecord_t from the tap-hold press event.
+ * @param hold True if the key was settled as held.
+ * @param reason One of `enum achordion_settle_reason`.
+ */
+void achordion_settled(uint16_t tap_hold_keycode, keyrecord_t* tap_hold_record,
+                       bool hold, uint8_t reason);
+
+/**
+ * Returns true while a tap-hold key is pressed and Achordion has not settled it
+ * yet, so that its decision waits for the next key press.
+ */
+bool achordion_pending(void);
 
 /**
  * Returns true if the args come from keys on opposite hands.
@@ -15,6 +15,7 @@
  */
 
 #include "casemodes.h"
+#include "stack_watch.h"
 
 /* The caps word concept started with me @iaap on splitkb.com discord.
  * However it has been implemented and extended by many splitkb.com users:
@@ -44,36 +45,37 @@
 
 #define IS_OSM(keycode) (keycode >= QK_ONE_SHOT_MOD && keycode <= QK_ONE_SHOT_MOD_MAX)
 
-// enum to keep track of the xcase state
-static enum xcase_state xcase_state = XCASE_OFF;
+// the xcase state and the number of delimiters in a row, packed in a byte
+static struct {
+    enum xcase_state state : 2;
+    uint8_t delimiters_count : 6;
+} xcase;
 // the keycode of the xcase delimiter
 static uint16_t xcase_delimiter;
 // the number of keys to the last delimiter
 static int8_t distance_to_last_delim = -1;
-// the number of delimiters in a row
-static int8_t delimiters_count = 0;
 
 // Get xcase state
 enum xcase_state get_xcase_state(void) {
-    return xcase_state;
+    return xcase.state;
 }
 
 // Enable xcase and pickup the next keystroke as the delimiter
 void enable_xcase(void) {
-    xcase_state = XCASE_WAIT;
+    xcase.state = XCASE_WAIT;
 }
 
 // Enable xcase with the specified delimiter
 void enable_xcase_with(uint16_t delimiter) {
-    xcase_state = XCASE_ON;
+    xcase.state = XCASE_ON;
     xcase_delimiter = delimiter;
     distance_to_last_delim = -1;
-    delimiters_count = 0;
+    xcase.delimiters_count = 0;
 }
 
 // Disable xcase
 void disable_xcase(void) {
-    xcase_state = XCASE_OFF;
+    xcase.state = XCASE_OFF;
 }
 
 uint8_t map_5bit_to_8bit(uint8_t mod_5bit) {
@@ -96,6 +98,7 @@ static void place_delimiter(void) {
         uint8_t mod_5bit = xcase_delimiter & 0x1F;
         set_oneshot_mods(map_5bit_to_8bit(mod_5bit));
     } else {
+        stack_watch_mark(STACK_MARK_CASEMODES);
         tap_code16(xcase_delimiter);
     }
 }
@@ -149,7 +152,7 @@ bool use_default_xcase_separator(uint16_t keycode, const keyrecord_t *record) {
 }
 
 bool process_case_modes(uint16_t keycode, const keyrecord_t *record) {
-    if (xcase_state) {
+    if (xcase.state) {
         if ((QK_MOD_TAP <= keycode && keycode <= QK_MOD_TAP_MAX)
             || (QK_LAYER_TAP <= keycode && keycode <= QK_LAYER_TAP_MAX)) {
             // Earlier return if this has not been considered tapped yet
@@ -163,7 +166,7 @@ bool process_case_modes(uint16_t keycode, const keyrecord_t *record) {
             return true;
         }
 
-        if (xcase_state == XCASE_WAIT) {
+        if (xcase.state == XCASE_WAIT) {
             // grab the next input to be the delimiter
             if (use_default_xcase_separator(keycode, record)) {
                 enable_xcase_with(DEFAULT_XCASE_SEPARATOR);
@@ -193,11 +196,11 @@ bool process_case_modes(uint16_t keycode, const keyrecord_t *record) {
 
         if (record->event.pressed) {
             // handle xcase mode
-            if (xcase_state == XCASE_ON) {
+            if (xcase.state == XCASE_ON) {
                 // place the delimiter if space is tapped
                 if (keycode == KC_SPACE) {
-                    delimiters_count++;
-                    if (delimiters_count < DEFAULT_DELIMITERS_TERMINATE_COUNT) {
+                    xcase.delimiters_count++;
+                    if (xcase.delimiters_count < DEFAULT_DELIMITERS_TERMINATE_COUNT) {
                         place_delimiter();
                         distance_to_last_delim = 0;
                         return false;
@@ -213,8 +216,8 @@ bool process_case_modes(uint16_t keycode, const keyrecord_t *record) {
                 // decrement distance to delimiter on back space
                 else if (keycode == KC_BSPC) {
                     --distance_to_last_delim;
-                    if (delimiters_count > 0) {
-                        --delimiters_count;
+                    if (xcase.delimiters_count > 0) {
+                        --xcase.delimiters_count;
                     }
                 }
                 // don't increment distance to last delim if negative
@@ -224,7 +227,7 @@ bool process_case_modes(uint16_t keycode, const keyrecord_t *record) {
                         place_delimiter();
                     }
                     ++distance_to_last_delim;
-                    delimiters_count = 0;
+                    xcase.delimiters_count = 0;
                 }
 
             } // end XCASE_ON
@@ -28,6 +28,16 @@
 #error "custom_shift_keys: QMK version is too old to build. Please update QMK."
 #else
 
+uint8_t custom_shift_keys_count(void) {
+  return pgm_read_byte(&NUM_CUSTOM_SHIFT_KEYS);
+}
+
+custom_shift_key_t custom_shift_key_get(uint8_t index) {
+  custom_shift_key_t entry;
+  memcpy_P(&entry, &custom_shift_keys[index], sizeof(entry));
+  return entry;
+}
+
 bool process_custom_shift_keys(uint16_t keycode, keyrecord_t *record) {
   static uint16_t registered_keycode = KC_NO;
 
@@ -53,9 +63,11 @@ bool process_custom_shift_keys(uint16_t keycode, keyrecord_t *record) {
       }
 
       // Search for a custom shift key whose keycode is `keycode`.
-      for (int i = 0; i < NUM_CUSTOM_SHIFT_KEYS; ++i) {
-        if (keycode == custom_shift_keys[i].keycode) {
-          registered_keycode = custom_shift_keys[i].shifted_keycode;
+      const uint8_t count = custom_shift_keys_count();
+      for (uint8_t i = 0; i < count; ++i) {
+        const custom_shift_key_t entry = custom_shift_key_get(i);
+        if (keycode == entry.keycode) {
+          registered_keycode = entry.shifted_keycode;
           if (IS_QK_MODS(registered_keycode) &&  // Should keycode be shifted?
               (QK_MODS_GET_MODS(registered_keycode) & MOD_LSFT) != 0) {
             register_code16(registered_keycode);  // If so, press it directly.
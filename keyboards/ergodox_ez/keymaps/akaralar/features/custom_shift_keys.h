@@ -26,16 +26,19 @@
  *
  *     #include "features/custom_shift_keys.h"
  *
- *     const custom_shift_key_t custom_shift_keys[] = {
+ *     const custom_shift_key_t PROGMEM custom_shift_keys[] = {
  *       {KC_DOT , KC_QUES}, // Shift . is ?
  *       {KC_COMM, KC_EXLM}, // Shift , is !
  *       {KC_MINS, KC_EQL }, // Shift - is =
  *       {KC_COLN, KC_SCLN}, // Shift : is ;
  *     };
+ *     const uint8_t PROGMEM NUM_CUSTOM_SHIFT_KEYS =
+ *         sizeof(custom_shift_keys) / sizeof(custom_shift_key_t);
  *
  * Each row defines one key. The first field is the keycode as it appears in
  * your layout and determines what is typed normally. The second entry is what
- * you want the key to type when shifted.
+ * you want the key to type when shifted. The table and its size are kept in
+ * flash, read them with `custom_shift_key_get()` and `custom_shift_keys_count()`.
  *
  * Step 2: Handle custom shift keys from your `process_record_user` function as
  *
@@ -73,10 +76,16 @@ typedef struct {
   uint16_t shifted_keycode;
 } custom_shift_key_t;
 
-/** Table of custom shift keys. */
-extern const custom_shift_key_t custom_shift_keys[];
+/** Table of custom shift keys, in PROGMEM. */
+extern const custom_shift_key_t PROGMEM custom_shift_keys[];
+/** Number of entries in the `custom_shift_keys` table, in PROGMEM. */
+extern const uint8_t PROGMEM NUM_CUSTOM_SHIFT_KEYS;
+
 /** Number of entries in the `custom_shift_keys` table. */
-extern uint8_t NUM_CUSTOM_SHIFT_KEYS;
+uint8_t custom_shift_keys_count(void);
+
+/** Reads entry `index` of the `custom_shift_keys` table from flash. */
+custom_shift_key_t custom_shift_key_get(uint8_t index);
 
 /**
  * Handler function for custom shift keys.
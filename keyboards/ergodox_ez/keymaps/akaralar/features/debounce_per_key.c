@@ -0,0 +1,145 @@
+#include "debounce_per_key.h"
+#include "debounce.h"
+
+#ifndef DEBOUNCE
+#    define DEBOUNCE 5
+#endif
+
+// Counters share a byte with a flag telling whether the key is waiting for a
+// stable state (pending) or ignoring changes after an eager press (lockout).
+#define COUNTER_PENDING 0x80
+#define COUNTER_MASK 0x7F
+
+#if DEBOUNCE > COUNTER_MASK
+#    error "debounce_per_key: DEBOUNCE must be at most 127 ms"
+#endif
+
+#define KEY_INDEX(row, col) ((row) * MATRIX_COLS + (col))
+
+static uint8_t      counters[MATRIX_ROWS * MATRIX_COLS];
+static uint8_t      chatter[MATRIX_ROWS * MATRIX_COLS];
+static matrix_row_t eager_mask[MATRIX_ROWS];
+static matrix_row_t last_raw[MATRIX_ROWS];
+static uint16_t     last_time       = 0;
+static bool         counters_active = false;
+
+__attribute__((weak)) bool debounce_eager_key(uint8_t row, uint8_t col) {
+    return true;
+}
+
+void debounce_init(uint8_t num_rows) {
+    for (uint8_t row = 0; row < num_rows; row++) {
+        eager_mask[row] = 0;
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            if (debounce_eager_key(row, col)) {
+                eager_mask[row] |= (matrix_row_t)1 << col;
+            }
+        }
+    }
+    last_time = timer_read();
+}
+
+void debounce_free(void) {}
+
+// Starts debouncing a key whose raw state differs from its cooked state.
+// Returns true if the cooked state changed right away.
+static bool start_debounce(uint8_t *counter, matrix_row_t *cooked_row, matrix_row_t bit, bool eager, bool pressed) {
+    if (eager && pressed) {
+        *cooked_row |= bit;
+        *counter = DEBOUNCE;
+        return true;
+    }
+    *counter = COUNTER_PENDING | DEBOUNCE;
+    return false;
+}
+
+bool debounce(matrix_row_t raw[], matrix_row_t cooked[], uint8_t num_rows, bool changed) {
+    if (!changed && !counters_active) {
+        last_time = timer_read();
+        return false;
+    }
+
+    const uint16_t now     = timer_read();
+    const uint16_t diff    = TIMER_DIFF_16(now, last_time);
+    const uint8_t  elapsed = diff > COUNTER_MASK ? COUNTER_MASK : diff;
+    last_time              = now;
+
+    bool cooked_changed = false;
+    counters_active     = false;
+
+    for (uint8_t row = 0; row < num_rows; row++) {
+        const matrix_row_t transitions = raw[row] ^ last_raw[row];
+        last_raw[row]                  = raw[row];
+
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            const matrix_row_t bit     = (matrix_row_t)1 << col;
+            const uint8_t      index   = KEY_INDEX(row, col);
+            uint8_t           *counter = &counters[index];
+
+            if (*counter == 0) {
+                if ((raw[row] ^ cooked[row]) & bit) {
+                    cooked_changed |= start_debounce(counter, &cooked[row], bit, eager_mask[row] & bit, raw[row] & bit);
+                    counters_active = true;
+                }
+                continue;
+            }
+
+            // The raw state moved while the key was still settling.
+            if ((transitions & bit) && chatter[index] < UINT8_MAX) {
+                chatter[index]++;
+            }
+
+            const uint8_t remaining = *counter & COUNTER_MASK;
+            if (*counter & COUNTER_PENDING) {
+                if (!((raw[row] ^ cooked[row]) & bit)) {
+                    // Bounced back to the cooked state, nothing to report.
+                    *counter = 0;
+                } else if (remaining <= elapsed) {
+                    cooked[row] ^= bit;
+                    cooked_changed = true;
+                    *counter       = 0;
+                } else {
+                    *counter        = COUNTER_PENDING | (remaining - elapsed);
+                    counters_active = true;
+                }
+            } else if (remaining <= elapsed) {
+                // Lockout after an eager press is over. If the key was released
+                // in the meantime, debounce the release right away.
+                *counter = 0;
+                if ((raw[row] ^ cooked[row]) & bit) {
+                    start_debounce(counter, &cooked[row], bit, false, false);
+                    counters_active = true;
+                }
+            } else {
+                *counter        = remaining - elapsed;
+                counters_active = true;
+            }
+        }
+    }
+
+    return cooked_changed;
+}
+
+uint8_t debounce_chatter_count(uint8_t row, uint8_t col) {
+    if (row >= MATRIX_ROWS || col >= MATRIX_COLS) {
+        return 0;
+    }
+    return chatter[KEY_INDEX(row, col)];
+}
+
+void debounce_clear_chatter(void) {
+    memset(chatter, 0, sizeof(chatter));
+}
+
+#ifdef CONSOLE_ENABLE
+void debounce_print_chatter(void) {
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            const uint8_t count = chatter[KEY_INDEX(row, col)];
+            if (count) {
+                uprintf("chatter col: %1u, row: %2u, count: %3u\n", col, row, count);
+            }
+        }
+    }
+}
+#endif
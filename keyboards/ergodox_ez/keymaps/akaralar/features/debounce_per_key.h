@@ -0,0 +1,45 @@
+#pragma once
+
+#include "quantum.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//------------------------------------------------------------------------------
+// Per-key debounce
+//
+// Replaces QMK's debounce with one that picks the algorithm per key:
+//  - Eager keys report a press as soon as it is seen, then ignore the key for
+//    `DEBOUNCE` ms. A release is only reported once it has been stable for
+//    `DEBOUNCE` ms.
+//  - Deferred keys report both presses and releases only after they have been
+//    stable for `DEBOUNCE` ms.
+//
+// Every raw state change seen while a key is still being debounced counts as a
+// bounce and increments that key's chatter counter.
+//
+// Enable with `DEBOUNCE_TYPE = custom` and add this file to `SRC` in rules.mk.
+//
+// tools/host/debounce_replay.c replays bounce waveforms through both algorithms
+// and compares their latency and false presses.
+//------------------------------------------------------------------------------
+
+// Optional callback deciding which keys are eager, evaluated once at init.
+// By default every key is eager.
+bool debounce_eager_key(uint8_t row, uint8_t col);
+
+// Number of bounces detected on a key since boot, saturating at 255.
+uint8_t debounce_chatter_count(uint8_t row, uint8_t col);
+
+// Clears all chatter counters.
+void debounce_clear_chatter(void);
+
+#ifdef CONSOLE_ENABLE
+// Prints the keys that bounced along with their chatter counters.
+void debounce_print_chatter(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
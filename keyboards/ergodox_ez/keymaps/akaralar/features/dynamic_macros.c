@@ -0,0 +1,378 @@
+#include "dynamic_macros.h"
+#include "stack_watch.h"
+
+#ifndef DYNAMIC_MACRO_BUFFER_BYTES
+#    define DYNAMIC_MACRO_BUFFER_BYTES 384
+#endif
+
+#ifndef DYNAMIC_MACRO_TIMING_UNIT
+#    define DYNAMIC_MACRO_TIMING_UNIT 8
+#endif
+
+// Event encoding, one byte per event:
+//
+//   bit 7    : pressed
+//   bits 6-4 : matrix column
+//   bits 3-0 : matrix row
+//
+// The ErgoDox EZ has 14 rows, which leaves rows 14 and 15 free to mark prefix
+// bytes that modify the next event:
+//
+//   row 15 : tap state, bit 7 is `interrupted` and bits 6-4 are `count`
+//   row 14 : delay, the next byte is the time since the previous event in
+//            units of DYNAMIC_MACRO_TIMING_UNIT ms
+#define EVENT_PRESSED 0x80
+#define EVENT_COL_SHIFT 4
+#define EVENT_COL_MASK 0x07
+#define EVENT_ROW_MASK 0x0F
+#define PREFIX_TAP 0x0F
+#define PREFIX_DELAY 0x0E
+#define TAP_INTERRUPTED 0x80
+#define TAP_COUNT_MAX EVENT_COL_MASK
+
+#if MATRIX_ROWS > PREFIX_DELAY
+#    error "dynamic_macros: the matrix has too many rows for the event encoding"
+#endif
+
+#define MACRO_COUNT 2
+#define EEPROM_MAGIC 0xD7
+
+// Recorded macros, laid out exactly as they are saved in EEPROM.
+typedef struct __attribute__((packed)) {
+    uint8_t  magic;
+    uint16_t length[MACRO_COUNT];
+    uint8_t  data[DYNAMIC_MACRO_BUFFER_BYTES];
+} dynamic_macros_t;
+
+_Static_assert(sizeof(dynamic_macros_t) == DYNAMIC_MACRO_EEPROM_HEADER_SIZE + DYNAMIC_MACRO_BUFFER_BYTES, "dynamic_macros: unexpected header size");
+#if defined(DYNAMIC_MACRO_EEPROM) && defined(DYNAMIC_MACRO_EEPROM_SIZE)
+_Static_assert(DYNAMIC_MACRO_EEPROM_SIZE >= sizeof(dynamic_macros_t), "dynamic_macros: DYNAMIC_MACRO_EEPROM_SIZE is too small");
+#endif
+
+static dynamic_macros_t macros = {.magic = EEPROM_MAGIC};
+
+// Slot being recorded, or -1.
+static int8_t   recording_slot = -1;
+// Length of the recording up to and including its last release event.
+static uint16_t recording_trim = 0;
+static bool     playing        = false;
+#ifdef DYNAMIC_MACRO_TIMING
+static uint16_t last_event_time = 0;
+#endif
+
+//------------------------------------------------------------------------------
+// Buffer access
+//------------------------------------------------------------------------------
+// Index of the `i`-th byte of a macro. Macro 2 is stored backwards from the
+// end of the buffer, so that both macros can share the free space.
+static uint16_t data_index(uint8_t slot, uint16_t i) {
+    return slot == 0 ? i : DYNAMIC_MACRO_BUFFER_BYTES - 1 - i;
+}
+
+static uint16_t free_bytes(void) {
+    return DYNAMIC_MACRO_BUFFER_BYTES - macros.length[0] - macros.length[1];
+}
+
+static void append_byte(uint8_t slot, uint8_t byte) {
+    macros.data[data_index(slot, macros.length[slot])] = byte;
+    macros.length[slot]++;
+}
+
+//------------------------------------------------------------------------------
+// EEPROM
+//------------------------------------------------------------------------------
+#ifdef DYNAMIC_MACRO_EEPROM
+// Next byte of `macros` to write to EEPROM. The header goes last so that an
+// interrupted save never exposes a header pointing at half-written data.
+static uint16_t save_pos     = 0;
+static bool     save_pending = false;
+
+static void save_byte(uint16_t pos) {
+    eeconfig_update_user_datablock((const uint8_t *)&macros + pos, DYNAMIC_MACRO_EEPROM_OFFSET + pos, 1);
+}
+
+static void start_save(void) {
+    // Invalidate the saved macros until the new ones are fully written.
+    const uint8_t invalid = 0;
+    eeconfig_update_user_datablock(&invalid, DYNAMIC_MACRO_EEPROM_OFFSET, 1);
+    save_pos     = DYNAMIC_MACRO_EEPROM_HEADER_SIZE;
+    save_pending = true;
+}
+
+void dynamic_macros_task(void) {
+    if (!save_pending || recording_slot >= 0) {
+        return;
+    }
+
+    // Skip the unused bytes between the two macros.
+    const uint16_t gap_start = DYNAMIC_MACRO_EEPROM_HEADER_SIZE + macros.length[0];
+    const uint16_t gap_end   = DYNAMIC_MACRO_EEPROM_HEADER_SIZE + DYNAMIC_MACRO_BUFFER_BYTES - macros.length[1];
+    if (save_pos >= gap_start && save_pos < gap_end) {
+        save_pos = gap_end;
+    }
+
+    if (save_pos < sizeof(macros)) {
+        save_byte(save_pos++);
+        return;
+    }
+
+    for (uint16_t pos = 0; pos < DYNAMIC_MACRO_EEPROM_HEADER_SIZE; pos++) {
+        save_byte(pos);
+    }
+    save_pending = false;
+    dprintln("dynamic macros: saved");
+}
+
+void dynamic_macros_init(void) {
+    eeconfig_read_user_datablock(&macros, DYNAMIC_MACRO_EEPROM_OFFSET, sizeof(macros));
+    if (macros.magic != EEPROM_MAGIC || macros.length[0] + macros.length[1] > DYNAMIC_MACRO_BUFFER_BYTES) {
+        macros.magic     = EEPROM_MAGIC;
+        macros.length[0] = 0;
+        macros.length[1] = 0;
+    }
+}
+#else
+void dynamic_macros_task(void) {}
+
+void dynamic_macros_init(void) {}
+#endif
+
+//------------------------------------------------------------------------------
+// Recording
+//------------------------------------------------------------------------------
+static void record_start(uint8_t slot) {
+    dprintf("dynamic macros: slot %u recording\n", slot + 1);
+    recording_slot      = slot;
+    recording_trim      = 0;
+    macros.length[slot] = 0;
+#ifdef DYNAMIC_MACRO_TIMING
+    last_event_time = timer_read();
+#endif
+}
+
+static void record_end(void) {
+    // Drop trailing presses, i.e. the keys held to reach the stop key.
+    macros.length[recording_slot] = recording_trim;
+    dprintf("dynamic macros: slot %u recorded %u bytes\n", recording_slot + 1, recording_trim);
+    recording_slot = -1;
+#ifdef DYNAMIC_MACRO_EEPROM
+    start_save();
+#endif
+}
+
+static void record_event(keyrecord_t *record) {
+    const keypos_t key  = record->event.key;
+    const uint8_t  slot = recording_slot;
+
+    uint8_t prefix[4];
+    uint8_t prefix_len = 0;
+
+#ifdef DYNAMIC_MACRO_TIMING
+    const uint16_t delay = timer_elapsed(last_event_time) / DYNAMIC_MACRO_TIMING_UNIT;
+    last_event_time      = timer_read();
+    if (delay > 0) {
+        prefix[prefix_len++] = PREFIX_DELAY;
+        prefix[prefix_len++] = delay > UINT8_MAX ? UINT8_MAX : delay;
+    }
+#endif
+
+    if (record->tap.count || record->tap.interrupted) {
+        const uint8_t count  = record->tap.count > TAP_COUNT_MAX ? TAP_COUNT_MAX : record->tap.count;
+        prefix[prefix_len++] = PREFIX_TAP | (count << EVENT_COL_SHIFT) | (record->tap.interrupted ? TAP_INTERRUPTED : 0);
+    }
+
+    if (free_bytes() < prefix_len + 1) {
+        dprintln("dynamic macros: buffer full");
+        return;
+    }
+
+    for (uint8_t i = 0; i < prefix_len; i++) {
+        append_byte(slot, prefix[i]);
+    }
+    append_byte(slot, (record->event.pressed ? EVENT_PRESSED : 0) | (key.col << EVENT_COL_SHIFT) | key.row);
+
+    if (!record->event.pressed) {
+        recording_trim = macros.length[slot];
+    }
+}
+
+//------------------------------------------------------------------------------
+// Batched output
+//------------------------------------------------------------------------------
+// During playback, the keyboard reports QMK sends are held back and merged by
+// standing in for the host driver. A held report only goes out once the next
+// one would change a key or modifier that already changed since the last
+// report sent, so every press and release still reaches the host in order.
+static host_driver_t    *host_driver = NULL;
+static host_driver_t     batch_driver;
+static report_keyboard_t sent_report;
+static report_keyboard_t held_report;
+static bool              report_held = false;
+
+static bool has_key(const report_keyboard_t *report, uint8_t key) {
+    for (uint8_t i = 0; i < KEYBOARD_REPORT_KEYS; i++) {
+        if (report->keys[i] == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Whether a key or modifier changes from `a` to `b`, and back from `b` to `c`.
+static bool changes_twice(const report_keyboard_t *a, const report_keyboard_t *b, const report_keyboard_t *c) {
+    if ((a->mods ^ b->mods) & (b->mods ^ c->mods)) {
+        return true;
+    }
+    // A key that changes twice is in `a` or `b`.
+    for (uint8_t i = 0; i < KEYBOARD_REPORT_KEYS; i++) {
+        const uint8_t keys[] = {a->keys[i], b->keys[i]};
+        for (uint8_t j = 0; j < 2; j++) {
+            const bool in_b = has_key(b, keys[j]);
+            if (keys[j] && has_key(a, keys[j]) != in_b && in_b != has_key(c, keys[j])) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static void batch_flush(void) {
+    if (!report_held) {
+        return;
+    }
+    report_held = false;
+    if (sent_report.mods != held_report.mods || memcmp(sent_report.keys, held_report.keys, KEYBOARD_REPORT_KEYS)) {
+        sent_report = held_report;
+        host_driver->send_keyboard(&sent_report);
+    }
+}
+
+static void batch_send_keyboard(report_keyboard_t *report) {
+    if (report_held && changes_twice(&sent_report, &held_report, report)) {
+        batch_flush();
+    }
+    held_report = *report;
+    report_held = true;
+}
+
+// Other reports can depend on the held one, a modifier for a click say.
+static void batch_send_mouse(report_mouse_t *report) {
+    batch_flush();
+    host_driver->send_mouse(report);
+}
+
+static void batch_send_extra(report_extra_t *report) {
+    batch_flush();
+    host_driver->send_extra(report);
+}
+
+// Starts holding back reports. The keyboard report last sent must be empty.
+static void batch_start(void) {
+    host_driver = host_get_driver();
+    if (!host_driver) {
+        return;
+    }
+    batch_driver               = *host_driver;
+    batch_driver.send_keyboard = batch_send_keyboard;
+    batch_driver.send_mouse    = batch_send_mouse;
+    batch_driver.send_extra    = batch_send_extra;
+    memset(&sent_report, 0, sizeof(sent_report));
+    report_held = false;
+    host_set_driver(&batch_driver);
+}
+
+static void batch_end(void) {
+    if (!host_driver) {
+        return;
+    }
+    batch_flush();
+    host_set_driver(host_driver);
+    host_driver = NULL;
+}
+
+//------------------------------------------------------------------------------
+// Playback
+//------------------------------------------------------------------------------
+static void play(uint8_t slot) {
+    dprintf("dynamic macros: slot %u playback\n", slot + 1);
+
+    const layer_state_t saved_layer_state = layer_state;
+    clear_keyboard();
+    layer_clear();
+    playing = true;
+    batch_start();
+
+    keyrecord_t record = {0};
+    for (uint16_t i = 0; i < macros.length[slot]; i++) {
+        const uint8_t byte = macros.data[data_index(slot, i)];
+
+        switch (byte & EVENT_ROW_MASK) {
+            case PREFIX_TAP:
+                record.tap.count       = (byte >> EVENT_COL_SHIFT) & EVENT_COL_MASK;
+                record.tap.interrupted = (byte & TAP_INTERRUPTED) != 0;
+                continue;
+            case PREFIX_DELAY:
+                if (++i < macros.length[slot]) {
+#ifdef DYNAMIC_MACRO_TIMING
+                    batch_flush();
+                    for (uint8_t delay = macros.data[data_index(slot, i)]; delay > 0; delay--) {
+                        wait_ms(DYNAMIC_MACRO_TIMING_UNIT);
+                    }
+#endif
+                }
+                continue;
+        }
+
+        record.event = MAKE_KEYEVENT(byte & EVENT_ROW_MASK, (byte >> EVENT_COL_SHIFT) & EVENT_COL_MASK, byte & EVENT_PRESSED);
+        stack_watch_mark(STACK_MARK_DYNAMIC_MACRO);
+        process_record(&record);
+        record = (keyrecord_t){0};
+    }
+
+    batch_end();
+    playing = false;
+    clear_keyboard();
+    layer_state_set(saved_layer_state);
+}
+
+//------------------------------------------------------------------------------
+// Keycode handling
+//------------------------------------------------------------------------------
+bool process_dynamic_macros(uint16_t keycode, keyrecord_t *record) {
+    if (playing) {
+        return true;
+    }
+
+    switch (keycode) {
+        case DM_REC1:
+        case DM_REC2:
+        case DM_RSTP:
+        case DM_PLY1:
+        case DM_PLY2:
+            if (!record->event.pressed) {
+                return false;
+            }
+            // Any dynamic macro key stops an ongoing recording.
+            if (recording_slot >= 0) {
+                record_end();
+                return false;
+            }
+            switch (keycode) {
+                case DM_REC1: record_start(0); break;
+                case DM_REC2: record_start(1); break;
+                case DM_PLY1: play(0); break;
+                case DM_PLY2: play(1); break;
+            }
+            return false;
+    }
+
+    if (recording_slot >= 0 && IS_KEYEVENT(record->event)) {
+        record_event(record);
+    }
+
+    return true;
+}
+
+bool is_dynamic_macro_playing(void) { return playing; }
+
+bool is_dynamic_macro_recording(void) { return recording_slot >= 0; }
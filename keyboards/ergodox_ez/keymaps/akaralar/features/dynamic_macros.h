@@ -0,0 +1,55 @@
+#pragma once
+
+#include "quantum.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//------------------------------------------------------------------------------
+// Dynamic macros
+//
+// Replacement for QMK's dynamic macros that handles the same `DM_*` keycodes
+// but stores recordings compactly. QMK keeps a full `keyrecord_t` per event,
+// while here an event is a single byte holding its matrix position and
+// press/release state. Tap state and (optionally) timing are only stored when
+// they matter, as prefix bytes before the event.
+//
+// Both macros share `DYNAMIC_MACRO_BUFFER_BYTES` bytes: macro 1 grows from the
+// start of the buffer and macro 2 from the end.
+//
+// Playback replays events back to back, without the recorded delays unless
+// `DYNAMIC_MACRO_TIMING` is defined. Keyboard reports are batched while it
+// plays: consecutive changes go out in one report as long as no key or
+// modifier changes twice in it, so typing takes about a report per key
+// instead of two, and rolls and shifted keys even less. Each report waits for
+// a USB poll, so fewer reports replay faster. NKRO reports aren't batched.
+//
+// With `DYNAMIC_MACRO_EEPROM` defined, macros are saved to the user EEPROM
+// datablock at `DYNAMIC_MACRO_EEPROM_OFFSET` and restored at boot. Saving only
+// writes the bytes that changed, one byte per task call, so that it doesn't
+// stall the scan loop.
+//------------------------------------------------------------------------------
+
+// Size of the EEPROM header written in front of the macro buffer.
+#define DYNAMIC_MACRO_EEPROM_HEADER_SIZE 5
+
+// Handles `DM_*` keycodes and records events. Call from
+// `process_record_user()` after tap-hold keys are settled.
+bool process_dynamic_macros(uint16_t keycode, keyrecord_t *record);
+
+// Loads macros saved in EEPROM. Call from `keyboard_post_init_user()`.
+void dynamic_macros_init(void);
+
+// Writes pending macro changes to EEPROM. Call from `matrix_scan_user()`.
+void dynamic_macros_task(void);
+
+// True while a macro is being played back.
+bool is_dynamic_macro_playing(void);
+
+// True while a macro is being recorded.
+bool is_dynamic_macro_recording(void);
+
+#ifdef __cplusplus
+}
+#endif
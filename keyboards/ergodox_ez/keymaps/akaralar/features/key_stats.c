@@ -0,0 +1,185 @@
+#include "key_stats.h"
+
+#define KEY_INDEX(row, col) ((row) * MATRIX_COLS + (col))
+#define PACK_KEY(key) ((key).row | ((key).col << 4))
+
+static uint16_t             presses[MATRIX_ROWS * MATRIX_COLS];
+static key_stats_tap_hold_t tap_holds[KEY_STATS_TAP_HOLD_SLOTS];
+static uint8_t              tap_hold_count = 0;
+
+// Press times of the tap-hold keys that are down, by slot.
+typedef struct {
+    uint8_t  slot;
+    uint16_t time;
+} held_key_t;
+
+static held_key_t held_keys[KEY_STATS_HELD_KEYS];
+static uint8_t    held_count = 0;
+
+__attribute__((weak)) bool key_stats_tap_hold_key(uint16_t keycode) {
+    return IS_QK_MOD_TAP(keycode) || IS_QK_LAYER_TAP(keycode);
+}
+
+// Half-octave bucket of a duration: the position of its highest set bit and
+// whether the bit below it is set.
+static uint8_t duration_bucket(uint16_t duration) {
+    uint8_t msb = 0;
+    for (uint16_t d = duration >> 1; d; d >>= 1) {
+        msb++;
+    }
+    const uint8_t half = msb > 0 && (duration & (1 << (msb - 1))) ? 1 : 0;
+    // The first bucket ends at 96 ms, i.e. msb 6 with the half bit set.
+    const int8_t bucket = 2 * msb + half - 12;
+    return bucket < 0 ? 0 : bucket >= KEY_STATS_BUCKETS ? KEY_STATS_BUCKETS - 1 : bucket;
+}
+
+static void add_duration(uint8_t *histogram, uint16_t duration) {
+    uint8_t *bucket = &histogram[duration_bucket(duration)];
+    if (*bucket == UINT8_MAX) {
+        for (uint8_t i = 0; i < KEY_STATS_BUCKETS; i++) {
+            histogram[i] >>= 1;
+        }
+    }
+    (*bucket)++;
+}
+
+static void increment(uint16_t *counter) {
+    if (*counter < UINT16_MAX) {
+        (*counter)++;
+    }
+}
+
+// Slot of a tap-hold key, taking a free one if the key has none yet. Returns
+// NULL when all slots are taken.
+static key_stats_tap_hold_t *tap_hold_slot(keypos_t key) {
+    const uint8_t packed = PACK_KEY(key);
+    for (uint8_t i = 0; i < tap_hold_count; i++) {
+        if (tap_holds[i].key == packed) {
+            return &tap_holds[i];
+        }
+    }
+    if (tap_hold_count == KEY_STATS_TAP_HOLD_SLOTS) {
+        return NULL;
+    }
+    key_stats_tap_hold_t *slot = &tap_holds[tap_hold_count++];
+    slot->key                  = packed;
+    return slot;
+}
+
+static held_key_t *find_held(uint8_t slot) {
+    for (uint8_t i = 0; i < held_count; i++) {
+        if (held_keys[i].slot == slot) {
+            return &held_keys[i];
+        }
+    }
+    return NULL;
+}
+
+static void hold_key(uint8_t slot, uint16_t time) {
+    // A press without a release before it, from a clear for example, takes
+    // over the entry it left behind.
+    held_key_t *held = find_held(slot);
+    if (held == NULL && held_count < KEY_STATS_HELD_KEYS) {
+        held = &held_keys[held_count++];
+    }
+    if (held) {
+        *held = (held_key_t){.slot = slot, .time = time};
+    }
+}
+
+// Removes a key from the held keys and returns how long it was held, or
+// UINT16_MAX if its press time wasn't kept.
+static uint16_t release_key(uint8_t slot, uint16_t time) {
+    held_key_t *held = find_held(slot);
+    if (held == NULL) {
+        return UINT16_MAX;
+    }
+    const uint16_t duration = TIMER_DIFF_16(time, held->time);
+    *held                   = held_keys[--held_count];
+    return duration;
+}
+
+void process_key_stats(uint16_t keycode, keyrecord_t *record) {
+    if (!IS_KEYEVENT(record->event)) {
+        return;
+    }
+
+    const keypos_t key = record->event.key;
+    if (record->event.pressed) {
+        increment(&presses[KEY_INDEX(key.row, key.col)]);
+    }
+
+    if (!key_stats_tap_hold_key(keycode)) {
+        return;
+    }
+
+    key_stats_tap_hold_t *slot = tap_hold_slot(key);
+    if (slot == NULL) {
+        return;
+    }
+
+    const uint8_t index = slot - tap_holds;
+    if (record->event.pressed) {
+        hold_key(index, record->event.time);
+        return;
+    }
+
+    const uint16_t duration = release_key(index, record->event.time);
+    if (record->tap.count) {
+        increment(&slot->taps);
+        if (duration != UINT16_MAX) {
+            add_duration(slot->tap_durations, duration);
+        }
+    } else {
+        increment(&slot->holds);
+        if (duration != UINT16_MAX) {
+            add_duration(slot->hold_durations, duration);
+        }
+    }
+}
+
+uint16_t key_stats_presses(uint8_t row, uint8_t col) {
+    if (row >= MATRIX_ROWS || col >= MATRIX_COLS) {
+        return 0;
+    }
+    return presses[KEY_INDEX(row, col)];
+}
+
+const key_stats_tap_hold_t *key_stats_tap_hold(uint8_t slot) {
+    return slot < tap_hold_count ? &tap_holds[slot] : NULL;
+}
+
+void key_stats_clear(void) {
+    memset(presses, 0, sizeof(presses));
+    memset(tap_holds, 0, sizeof(tap_holds));
+    tap_hold_count = 0;
+    held_count     = 0;
+}
+
+#ifdef CONSOLE_ENABLE
+static void print_histogram(const char *name, uint16_t count, const uint8_t *histogram) {
+    uprintf("  %s %5u:", name, count);
+    for (uint8_t i = 0; i < KEY_STATS_BUCKETS; i++) {
+        uprintf(" %3u", histogram[i]);
+    }
+    uprintf("\n");
+}
+
+void key_stats_print(void) {
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            const uint16_t count = presses[KEY_INDEX(row, col)];
+            if (count) {
+                uprintf("presses col: %1u, row: %2u, count: %5u\n", col, row, count);
+            }
+        }
+    }
+
+    for (uint8_t i = 0; i < tap_hold_count; i++) {
+        const key_stats_tap_hold_t *slot = &tap_holds[i];
+        uprintf("tap-hold col: %1u, row: %2u\n", slot->key >> 4, slot->key & 0x0F);
+        print_histogram("taps ", slot->taps, slot->tap_durations);
+        print_histogram("holds", slot->holds, slot->hold_durations);
+    }
+}
+#endif
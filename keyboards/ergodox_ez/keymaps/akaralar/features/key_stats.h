@@ -0,0 +1,74 @@
+#pragma once
+
+#include "quantum.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//------------------------------------------------------------------------------
+// Key statistics
+//
+// Counts key presses per matrix position, and for tap-hold keys how often they
+// were settled as tap or hold along with how long they were held down each
+// time. Hold durations go into half-octave buckets:
+//
+//   bucket   | 0     | 1      | 2       | 3       | 4       | 5
+//   duration | < 96  | 96-127 | 128-191 | 192-255 | 256-383 | >= 384 ms
+//
+// Comparing the tap and hold histograms of a key shows where its tapping term
+// should sit. Tap-hold keys are tracked by matrix position in
+// `KEY_STATS_TAP_HOLD_SLOTS` slots, taken in the order the keys are first
+// used. Press times are only kept while a key is down, for up to
+// `KEY_STATS_HELD_KEYS` tap-hold keys at once; a key released beyond that is
+// counted but left out of the histograms. Statistics are kept in RAM only and
+// start over at boot.
+//------------------------------------------------------------------------------
+
+#ifndef KEY_STATS_TAP_HOLD_SLOTS
+#    define KEY_STATS_TAP_HOLD_SLOTS 20
+#endif
+
+#ifndef KEY_STATS_HELD_KEYS
+#    define KEY_STATS_HELD_KEYS 6
+#endif
+
+#define KEY_STATS_BUCKETS 6
+
+typedef struct {
+    // Matrix position, row in the low and column in the high nibble.
+    uint8_t  key;
+    uint16_t taps;
+    uint16_t holds;
+    // Duration histograms. When a bucket fills up, the whole histogram is
+    // halved to keep its shape.
+    uint8_t tap_durations[KEY_STATS_BUCKETS];
+    uint8_t hold_durations[KEY_STATS_BUCKETS];
+} key_stats_tap_hold_t;
+
+// Optional callback deciding which keycodes are tracked as tap-hold keys. By
+// default these are all mod-tap and layer-tap keys.
+bool key_stats_tap_hold_key(uint16_t keycode);
+
+// Counts the key event. Call from `process_record_user()` after tap-hold keys
+// are settled.
+void process_key_stats(uint16_t keycode, keyrecord_t *record);
+
+// Number of presses of a key since boot or the last clear, saturating at
+// UINT16_MAX.
+uint16_t key_stats_presses(uint8_t row, uint8_t col);
+
+// Statistics of a tap-hold slot, or NULL if the slot is unused.
+const key_stats_tap_hold_t *key_stats_tap_hold(uint8_t slot);
+
+// Clears all statistics.
+void key_stats_clear(void);
+
+#ifdef CONSOLE_ENABLE
+// Prints the press counts and the tap-hold statistics.
+void key_stats_print(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
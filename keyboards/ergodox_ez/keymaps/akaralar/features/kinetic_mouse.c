@@ -0,0 +1,150 @@
+#include "kinetic_mouse.h"
+
+// 1/sqrt(2) in 0.8 fixed point, for diagonals.
+#define DIAGONAL 181
+
+// Most milliseconds simulated at once, after a slow scan.
+#define MAX_STEPS 16
+
+enum direction {
+    UP    = 1 << 0,
+    DOWN  = 1 << 1,
+    LEFT  = 1 << 2,
+    RIGHT = 1 << 3,
+};
+
+enum axis { X, Y };
+
+static struct {
+    uint8_t  directions;   // Held cursor keys
+    bool     moving;       // Held, or still gliding
+    uint16_t held_since;   // When the first of the held keys was pressed
+    uint16_t last_update;  // When velocities were last updated
+    int16_t  velocity[2];  // 8.8 fixed point pixels per millisecond
+    int16_t  remainder[2]; // Fraction of a pixel not sent yet, 8.8 fixed point
+} mouse;
+
+__attribute__((weak)) uint16_t kinetic_mouse_speed(uint16_t held) {
+    const uint16_t base = KINETIC_MOUSE_SPEED(KINETIC_MOUSE_BASE_SPEED);
+    const uint16_t max  = KINETIC_MOUSE_SPEED(KINETIC_MOUSE_MAX_SPEED);
+    if (held >= KINETIC_MOUSE_RAMP_TIME) {
+        return max;
+    }
+    // Square ease-in, slow for longer at the start for fine control.
+    const uint16_t ramp  = ((uint32_t)held << 8) / KINETIC_MOUSE_RAMP_TIME;
+    const uint16_t curve = ((uint32_t)ramp * ramp) >> 8;
+    return base + (((uint32_t)(max - base) * curve) >> 8);
+}
+
+//------------------------------------------------------------------------------
+// Helpers
+//------------------------------------------------------------------------------
+static uint8_t direction_of(uint16_t keycode) {
+    switch (keycode) {
+        case KC_MS_U: return UP;
+        case KC_MS_D: return DOWN;
+        case KC_MS_L: return LEFT;
+        case KC_MS_R: return RIGHT;
+        default:      return 0;
+    }
+}
+
+// Direction of an axis in 0.8 fixed point, the same length held diagonally.
+static int16_t heading(enum axis axis) {
+    const uint8_t forward  = axis == X ? RIGHT : DOWN;
+    const uint8_t backward = axis == X ? LEFT : UP;
+    const uint8_t other    = axis == X ? UP | DOWN : LEFT | RIGHT;
+
+    const int8_t sign = !!(mouse.directions & forward) - !!(mouse.directions & backward);
+    if (!sign) {
+        return 0;
+    }
+    // Opposite keys of the other axis cancel out, that is not a diagonal.
+    const uint8_t others   = mouse.directions & other;
+    const bool    diagonal = others && others != other;
+    return sign * (diagonal ? DIAGONAL : 256);
+}
+
+// Change of velocity in a millisecond, thrust minus friction. Rounded away
+// from zero so that the velocity always reaches its target, and 0 once
+// released.
+static int16_t acceleration(int16_t velocity, int16_t target) {
+    const int16_t difference = target - velocity;
+    return ((int32_t)difference * KINETIC_MOUSE_FRICTION + (difference > 0 ? 255 : -255)) / 256;
+}
+
+// Whole pixels to send on an axis, the fraction is kept for the next report.
+static int8_t take_pixels(enum axis axis) {
+    int16_t pixels = mouse.remainder[axis] >> 8;
+    if (pixels > 127) {
+        pixels = 127;
+    } else if (pixels < -127) {
+        pixels = -127;
+    }
+    mouse.remainder[axis] -= pixels * 256;
+    return pixels;
+}
+
+//------------------------------------------------------------------------------
+// Processing
+//------------------------------------------------------------------------------
+bool process_kinetic_mouse(uint16_t keycode, keyrecord_t *record) {
+    const uint8_t direction = direction_of(keycode);
+    if (!direction) {
+        return true;
+    }
+
+    if (record->event.pressed) {
+        if (!mouse.directions) {
+            mouse.held_since = timer_read();
+        }
+        if (!mouse.moving) {
+            mouse.moving      = true;
+            mouse.last_update = timer_read();
+        }
+        mouse.directions |= direction;
+    } else {
+        mouse.directions &= ~direction;
+    }
+    return false;
+}
+
+void kinetic_mouse_task(void) {
+    if (!mouse.moving) {
+        return;
+    }
+    const uint16_t now     = timer_read();
+    uint16_t       elapsed = TIMER_DIFF_16(now, mouse.last_update);
+    if (elapsed < KINETIC_MOUSE_INTERVAL) {
+        return;
+    }
+    mouse.last_update = now;
+    if (elapsed > MAX_STEPS) {
+        elapsed = MAX_STEPS;
+    }
+
+    // Velocity the thrust balances friction at.
+    const uint16_t speed = mouse.directions ? kinetic_mouse_speed(TIMER_DIFF_16(now, mouse.held_since)) : 0;
+    for (uint8_t axis = X; axis <= Y; axis++) {
+        const int16_t target = ((int32_t)speed * heading(axis)) / 256;
+        for (uint8_t i = 0; i < elapsed; i++) {
+            mouse.velocity[axis] += acceleration(mouse.velocity[axis], target);
+            mouse.remainder[axis] += mouse.velocity[axis];
+        }
+    }
+
+    report_mouse_t report = mousekey_get_report();
+    report.x              = take_pixels(X);
+    report.y              = take_pixels(Y);
+    report.v              = 0;
+    report.h              = 0;
+    if (report.x || report.y) {
+        host_mouse_send(&report);
+    }
+
+    if (!mouse.directions && !mouse.velocity[X] && !mouse.velocity[Y]) {
+        mouse.moving       = false;
+        mouse.remainder[X] = 0;
+        mouse.remainder[Y] = 0;
+    }
+}
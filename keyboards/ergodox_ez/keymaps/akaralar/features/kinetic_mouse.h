@@ -0,0 +1,77 @@
+#pragma once
+
+#include "quantum.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//------------------------------------------------------------------------------
+// Kinetic mouse
+//
+// Cursor movement of the mouse keys as a body with velocity and friction,
+// instead of QMK's steps of a fixed size at a fixed interval. The cursor keys
+// (KC_MS_U, KC_MS_D, KC_MS_L, KC_MS_R) push the cursor towards a target speed
+// that grows the longer they are held, from slow and precise to fast enough to
+// cross a large screen:
+//
+//     velocity += (direction * speed - velocity) * friction
+//
+// per millisecond, so the velocity eases into the target speed and, once the
+// keys are released, down to 0 over a few pixels. Held diagonally, each axis
+// gets 1/sqrt(2) of the speed so that diagonals aren't faster.
+//
+// Velocities are 8.8 fixed point pixels per millisecond, and the fraction of a
+// pixel that wasn't sent yet is carried over to the next report. Reports are
+// sent every KINETIC_MOUSE_INTERVAL ms, the USB polling interval by default,
+// with the buttons of QMK's mouse keys. Wheel and button keys are left to QMK.
+//
+// The target speed for how long the keys have been held is
+// `kinetic_mouse_speed()`. By default it eases in from KINETIC_MOUSE_BASE_SPEED
+// to KINETIC_MOUSE_MAX_SPEED, in pixels per second, along a square curve over
+// KINETIC_MOUSE_RAMP_TIME ms.
+//------------------------------------------------------------------------------
+
+#ifndef KINETIC_MOUSE_INTERVAL
+#    ifdef USB_POLLING_INTERVAL_MS
+#        define KINETIC_MOUSE_INTERVAL USB_POLLING_INTERVAL_MS
+#    else
+#        define KINETIC_MOUSE_INTERVAL 1
+#    endif
+#endif
+
+#ifndef KINETIC_MOUSE_BASE_SPEED
+#    define KINETIC_MOUSE_BASE_SPEED 200
+#endif
+
+#ifndef KINETIC_MOUSE_MAX_SPEED
+#    define KINETIC_MOUSE_MAX_SPEED 3000
+#endif
+
+#ifndef KINETIC_MOUSE_RAMP_TIME
+#    define KINETIC_MOUSE_RAMP_TIME 800
+#endif
+
+// Fraction of the velocity lost per millisecond, out of 256.
+#ifndef KINETIC_MOUSE_FRICTION
+#    define KINETIC_MOUSE_FRICTION 40
+#endif
+
+// Pixels per second in 8.8 fixed point pixels per millisecond.
+#define KINETIC_MOUSE_SPEED(pixels_per_second) ((uint16_t)((pixels_per_second) * 256UL / 1000))
+
+_Static_assert(KINETIC_MOUSE_MAX_SPEED <= 16000, "kinetic mouse velocities are 8.8 fixed point");
+
+// Call from `process_record_user()`. Returns false for the cursor keys.
+bool process_kinetic_mouse(uint16_t keycode, keyrecord_t *record);
+
+// Call from `matrix_scan_user()` to move the cursor.
+void kinetic_mouse_task(void);
+
+// Target speed after the cursor keys were held for `held` ms, in 8.8 fixed
+// point pixels per millisecond.
+uint16_t kinetic_mouse_speed(uint16_t held);
+
+#ifdef __cplusplus
+}
+#endif
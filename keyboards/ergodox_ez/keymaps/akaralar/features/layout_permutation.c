@@ -0,0 +1,54 @@
+#include "layout_permutation.h"
+#include "packed_keymap.h"
+
+// Table of the active layout in flash, NULL for the keymap's own.
+static const uint8_t (*active)[MATRIX_COLS] = NULL;
+static uint8_t active_layout                = LAYOUT_PERMUTATION_NONE;
+
+void layout_permutation_set(uint8_t layout) {
+    if (layout >= pgm_read_byte(&NUM_LAYOUT_PERMUTATIONS)) {
+        layout = LAYOUT_PERMUTATION_NONE;
+    }
+    active        = layout == LAYOUT_PERMUTATION_NONE ? NULL : layout_permutations[layout];
+    active_layout = layout;
+}
+
+uint8_t layout_permutation_get(void) {
+    return active_layout;
+}
+
+__attribute__((weak)) bool layout_permutation_layer(uint8_t layer) {
+    return layer == get_highest_layer(default_layer_state);
+}
+
+//------------------------------------------------------------------------------
+// Helpers
+//------------------------------------------------------------------------------
+// Basic keycodes from KC_A up and mod-taps have a letter in their low byte.
+static bool has_letter(uint16_t keycode) {
+    return (keycode >= KC_A && keycode <= 0xFF) || IS_QK_MOD_TAP(keycode);
+}
+
+//------------------------------------------------------------------------------
+// Keymap introspection
+//------------------------------------------------------------------------------
+uint16_t keycode_at_keymap_location(uint8_t layer_num, uint8_t row, uint8_t column) {
+    const uint16_t keycode = packed_keymap_keycode(layer_num, row, column);
+    if (!active || row >= MATRIX_ROWS || column >= MATRIX_COLS || !layout_permutation_layer(layer_num)) {
+        return keycode;
+    }
+
+    const uint8_t from = pgm_read_byte(&active[row][column]);
+    if (from == LAYOUT_PERMUTATION_SAME) {
+        return keycode;
+    }
+    const uint8_t from_row = (from - 1) >> 3;
+    const uint8_t from_col = (from - 1) & 7;
+
+    if (has_letter(keycode)) {
+        const uint8_t  base   = get_highest_layer(default_layer_state);
+        const uint16_t letter = packed_keymap_keycode(base, from_row, from_col);
+        return (keycode & 0xFF00) | (letter & 0xFF);
+    }
+    return packed_keymap_keycode(layer_num, from_row, from_col);
+}
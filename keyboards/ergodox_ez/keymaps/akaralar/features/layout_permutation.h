@@ -0,0 +1,62 @@
+#pragma once
+
+#include "quantum.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//------------------------------------------------------------------------------
+// Layout permutation
+//
+// Alternative letter layouts as a permutation of the keymap's positions
+// instead of their own layers. Qwerty and Colemak put the same letters and the
+// same home row mods on different keys, so a Qwerty copy of every letter layer
+// only repeats the Colemak one with the letters moved around.
+//
+// A permutation is a table in the shape of the matrix, written with the layout
+// macro, that gives each moved position the position it takes its letter from.
+// While a permutation is active, the keys of the permuted layers are looked up
+// as follows, with `from` the position a key takes its letter from:
+//  - a key with a letter, a basic keycode or a mod-tap, keeps its own mods and
+//    gets the letter of `from` on the default layer, so a home row mod stays
+//    under the same finger while its letter moves,
+//  - any other key is the key of the same layer at `from`, so keys that only
+//    make sense with a letter, like the Turkish letter macros, move with it.
+// Positions that are not moved, and layers that are not permuted, read as
+// they are.
+//
+// `keycode_at_keymap_location()` is overridden to apply the active
+// permutation on top of the packed keymap, see features/packed_keymap.h.
+// Switching layouts only swaps a pointer, but keymap caches such as the shadow
+// keymap have to be refreshed after it.
+//------------------------------------------------------------------------------
+
+#define LAYOUT_PERMUTATION_NONE 0xFF
+
+// Entries of a permutation table: the key stays, or takes its letter from the
+// key at `col`:`row` of the keymap's position diagram. The layout macro fills
+// matrix positions without a key with 0, which reads as staying.
+#define LAYOUT_PERMUTATION_SAME 0
+#define LAYOUT_PERMUTATION_FROM(col, row) ((((row) << 3) | (col)) + 1)
+
+_Static_assert(MATRIX_COLS <= 8 && MATRIX_ROWS <= 31, "permutation entries are positions in 8 bits");
+
+// Tables defined in keymap.c, indexed by layout.
+extern const uint8_t PROGMEM layout_permutations[][MATRIX_ROWS][MATRIX_COLS];
+extern const uint8_t PROGMEM NUM_LAYOUT_PERMUTATIONS;
+
+// Activates a layout, or goes back to the keymap's own with
+// LAYOUT_PERMUTATION_NONE.
+void layout_permutation_set(uint8_t layout);
+
+// Active layout, LAYOUT_PERMUTATION_NONE for the keymap's own.
+uint8_t layout_permutation_get(void);
+
+// Whether a layer is permuted. Defaults to the default layer only, override to
+// also permute layers built on top of it.
+bool layout_permutation_layer(uint8_t layer);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,199 @@
+#include "misfire.h"
+#include "achordion.h"
+
+#ifndef MISFIRE_WINDOW
+#    define MISFIRE_WINDOW 400
+#endif
+
+#ifndef MISFIRE_MAX_PRESSES
+#    define MISFIRE_MAX_PRESSES 3
+#endif
+
+#ifdef MISFIRE_NUDGE
+#    ifndef MISFIRE_NUDGE_STEP
+#        define MISFIRE_NUDGE_STEP 5
+#    endif
+#    ifndef MISFIRE_NUDGE_LIMIT
+#        define MISFIRE_NUDGE_LIMIT 30
+#    endif
+#endif
+
+#define PACK_KEY(key) ((key).row | ((key).col << 4))
+
+static misfire_key_t keys[MISFIRE_SLOTS];
+static uint8_t       key_count = 0;
+static misfire_log_t log_entries[MISFIRE_LOG_SIZE];
+static uint8_t       log_count = 0;
+static uint8_t       log_next  = 0;
+
+// The last settled key, while its outcome is being watched.
+static struct {
+    misfire_key_t *slot;
+    uint16_t       settle_time;
+    uint16_t       window_start;
+    uint8_t        reason;
+    uint8_t        presses;
+    bool           hold;
+    // A held key is watched from its release.
+    bool waiting_release;
+} watch;
+
+__attribute__((weak)) bool misfire_correction_key(uint16_t keycode) {
+    switch (keycode) {
+        case KC_BSPC:
+        case LGUI(KC_Z):
+        case LCTL(KC_Z):
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Slot of a key, taking a free one if the key has none yet. Returns NULL when
+// all slots are taken.
+static misfire_key_t *key_slot(keypos_t key) {
+    const uint8_t packed = PACK_KEY(key);
+    for (uint8_t i = 0; i < key_count; i++) {
+        if (keys[i].key == packed) {
+            return &keys[i];
+        }
+    }
+    if (key_count == MISFIRE_SLOTS) {
+        return NULL;
+    }
+    misfire_key_t *slot = &keys[key_count++];
+    slot->key           = packed;
+    return slot;
+}
+
+static void increment(uint16_t *counter) {
+    if (*counter < UINT16_MAX) {
+        (*counter)++;
+    }
+}
+
+#ifdef MISFIRE_NUDGE
+// Only decisions that depend on the tapping term are nudged. A wrong hold asks
+// for a longer term, a wrong tap for a shorter one.
+static void nudge(misfire_key_t *slot, bool hold, uint8_t reason) {
+    if (reason != ACHORDION_SETTLED_BY_QMK && reason != ACHORDION_SETTLED_BY_TIMEOUT) {
+        return;
+    }
+    if (hold && slot->term_offset <= MISFIRE_NUDGE_LIMIT - MISFIRE_NUDGE_STEP) {
+        slot->term_offset += MISFIRE_NUDGE_STEP;
+    } else if (!hold && slot->term_offset >= -MISFIRE_NUDGE_LIMIT + MISFIRE_NUDGE_STEP) {
+        slot->term_offset -= MISFIRE_NUDGE_STEP;
+    }
+}
+#endif
+
+static void record_misfire(uint16_t time) {
+    misfire_key_t *slot = watch.slot;
+    increment(watch.hold ? &slot->hold_misfires : &slot->tap_misfires);
+
+    misfire_log_t *entry   = &log_entries[log_next];
+    entry->key             = slot->key;
+    entry->reason          = watch.reason | (watch.hold ? MISFIRE_HOLD : 0);
+    entry->settle_time     = watch.settle_time;
+    entry->correction_time = TIMER_DIFF_16(time, watch.window_start);
+    log_next               = (log_next + 1) % MISFIRE_LOG_SIZE;
+    if (log_count < MISFIRE_LOG_SIZE) {
+        log_count++;
+    }
+
+    dprintf("misfire: col: %u, row: %u, %s, reason %u\n", slot->key >> 4, slot->key & 0x0F, watch.hold ? "hold" : "tap", watch.reason);
+
+#ifdef MISFIRE_NUDGE
+    nudge(slot, watch.hold, watch.reason);
+#endif
+}
+
+// Checks a key press against the watched decision.
+static void watch_press(uint16_t keycode, keypos_t key) {
+    if (watch.slot == NULL || watch.waiting_release) {
+        return;
+    }
+
+    const uint16_t now = timer_read();
+    if (TIMER_DIFF_16(now, watch.window_start) > MISFIRE_WINDOW) {
+        watch.slot = NULL;
+        return;
+    }
+
+    if (misfire_correction_key(keycode) || (watch.hold && PACK_KEY(key) == watch.slot->key)) {
+        record_misfire(now);
+        watch.slot = NULL;
+    } else if (++watch.presses >= MISFIRE_MAX_PRESSES) {
+        watch.slot = NULL;
+    }
+}
+
+void misfire_settled(uint16_t keycode, keyrecord_t *record, bool hold, uint8_t reason) {
+    // The press of this key may itself correct the previous decision.
+    watch_press(keycode, record->event.key);
+
+    misfire_key_t *slot = key_slot(record->event.key);
+    watch.slot          = slot;
+    if (slot == NULL) {
+        return;
+    }
+    increment(&slot->settles);
+
+    const uint16_t now    = timer_read();
+    watch.settle_time     = TIMER_DIFF_16(now, record->event.time);
+    watch.window_start    = now;
+    watch.reason          = reason;
+    watch.presses         = 0;
+    watch.hold            = hold;
+    watch.waiting_release = hold;
+}
+
+void process_misfire(uint16_t keycode, keyrecord_t *record) {
+    if (watch.slot == NULL || !IS_KEYEVENT(record->event)) {
+        return;
+    }
+
+    if (!record->event.pressed) {
+        if (watch.waiting_release && PACK_KEY(record->event.key) == watch.slot->key) {
+            watch.waiting_release = false;
+            watch.window_start    = timer_read();
+        }
+        return;
+    }
+
+    // Tap-hold key presses are seen through `misfire_settled()`.
+    if (!IS_QK_MOD_TAP(keycode) && !IS_QK_LAYER_TAP(keycode)) {
+        watch_press(keycode, record->event.key);
+    }
+}
+
+const misfire_key_t *misfire_key(uint8_t slot) {
+    return slot < key_count ? &keys[slot] : NULL;
+}
+
+const misfire_log_t *misfire_log(uint8_t index) {
+    if (index >= log_count) {
+        return NULL;
+    }
+    return &log_entries[(log_next + MISFIRE_LOG_SIZE - 1 - index) % MISFIRE_LOG_SIZE];
+}
+
+void misfire_clear(void) {
+    memset(keys, 0, sizeof(keys));
+    key_count  = 0;
+    log_count  = 0;
+    log_next   = 0;
+    watch.slot = NULL;
+}
+
+#ifdef MISFIRE_NUDGE
+int8_t misfire_term_offset(keypos_t key) {
+    const uint8_t packed = PACK_KEY(key);
+    for (uint8_t i = 0; i < key_count; i++) {
+        if (keys[i].key == packed) {
+            return keys[i].term_offset;
+        }
+    }
+    return 0;
+}
+#endif
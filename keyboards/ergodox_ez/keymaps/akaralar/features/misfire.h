@@ -0,0 +1,91 @@
+#pragma once
+
+#include "quantum.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//------------------------------------------------------------------------------
+// Misfire detector
+//
+// Watches what is typed right after a tap-hold key is settled, and flags the
+// decision as a likely misfire when it is corrected:
+//  - A hold is a likely misfire if, within `MISFIRE_WINDOW` ms of releasing the
+//    key, a correction key is pressed or the same key is pressed again to
+//    retype its tap.
+//  - A tap is a likely misfire if a correction key is pressed within
+//    `MISFIRE_WINDOW` ms of it.
+// Only the first `MISFIRE_MAX_PRESSES` presses after a decision are looked at,
+// later corrections are more likely to be ordinary typos.
+//
+// Settles and misfires are counted per key, tracked by matrix position in
+// `MISFIRE_SLOTS` slots. The last `MISFIRE_LOG_SIZE` misfires are logged with
+// the decision path reported by Achordion and their timing.
+//
+// With `MISFIRE_NUDGE` defined, a misfire whose decision depended on the
+// tapping term moves that key's tapping term offset by `MISFIRE_NUDGE_STEP`
+// ms, up to `MISFIRE_NUDGE_LIMIT` ms either way. Offsets are kept in RAM only.
+//------------------------------------------------------------------------------
+
+#ifndef MISFIRE_SLOTS
+#    define MISFIRE_SLOTS 20
+#endif
+
+#ifndef MISFIRE_LOG_SIZE
+#    define MISFIRE_LOG_SIZE 8
+#endif
+
+// Set in the reason of a misfire log entry if the key was settled as held.
+#define MISFIRE_HOLD 0x80
+
+typedef struct {
+    // Matrix position, row in the low and column in the high nibble.
+    uint8_t  key;
+    uint16_t settles;
+    uint16_t tap_misfires;
+    uint16_t hold_misfires;
+#ifdef MISFIRE_NUDGE
+    int8_t term_offset;
+#endif
+} misfire_key_t;
+
+typedef struct {
+    uint8_t key;
+    // Achordion's settle reason, with `MISFIRE_HOLD` set for holds.
+    uint8_t reason;
+    // Time from the key press to the decision.
+    uint16_t settle_time;
+    // Time from the start of the window to the correction.
+    uint16_t correction_time;
+} misfire_log_t;
+
+// Optional callback deciding which keycodes undo the previous input. By
+// default these are Backspace and Cmd+Z or Ctrl+Z.
+bool misfire_correction_key(uint16_t keycode);
+
+// Reports a settled tap-hold key. Call from `achordion_settled()` for the
+// tap-hold keys to watch.
+void misfire_settled(uint16_t keycode, keyrecord_t *record, bool hold, uint8_t reason);
+
+// Watches key events for corrections. Call from `process_record_user()` after
+// tap-hold keys are settled.
+void process_misfire(uint16_t keycode, keyrecord_t *record);
+
+// Counters of a slot, or NULL if the slot is unused.
+const misfire_key_t *misfire_key(uint8_t slot);
+
+// A logged misfire, 0 being the latest, or NULL if there is none.
+const misfire_log_t *misfire_log(uint8_t index);
+
+// Clears counters, the log and tapping term offsets.
+void misfire_clear(void);
+
+#ifdef MISFIRE_NUDGE
+// Tapping term offset of a key, to add to its tapping term.
+int8_t misfire_term_offset(keypos_t key);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,29 @@
+#include "packed_keymap.h"
+
+uint16_t packed_keymap_keycode(uint8_t layer, uint8_t row, uint8_t col) {
+    if (layer >= pgm_read_byte(&NUM_PACKED_KEYMAP_LAYERS) || row >= MATRIX_ROWS || col >= MATRIX_COLS) {
+        return KC_NO;
+    }
+
+    packed_keymap_layer_t info;
+    memcpy_P(&info, &packed_keymap_layers[layer], sizeof(info));
+    if (info.rows == PACKED_KEYMAP_DENSE) {
+        return pgm_read_word(&packed_keymap_keys[info.keys + row * MATRIX_COLS + col]);
+    }
+
+    const uint16_t bits   = pgm_read_word(&packed_keymap_rows[info.rows + row]);
+    const uint8_t  bitmap = bits & 0xFF;
+    const uint8_t  mask   = 1 << col;
+    if (!(bitmap & mask)) {
+        return info.fill;
+    }
+    const uint8_t index = (bits >> 8) + __builtin_popcount(bitmap & (mask - 1));
+    return pgm_read_word(&packed_keymap_keys[info.keys + index]);
+}
+
+//------------------------------------------------------------------------------
+// Keymap introspection
+//------------------------------------------------------------------------------
+uint8_t keymap_layer_count(void) {
+    return pgm_read_byte(&NUM_PACKED_KEYMAP_LAYERS);
+}
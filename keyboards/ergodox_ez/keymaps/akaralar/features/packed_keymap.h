@@ -0,0 +1,53 @@
+#pragma once
+
+#include "quantum.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//------------------------------------------------------------------------------
+// Packed keymap
+//
+// The keymap in flash without the transparent keys. Most layers only set a few
+// keys over the base layer, and `keymaps` spends 2 bytes on every matrix
+// position of every layer.
+//
+// tools/pack_keymap.py generates keymap_packed.h from `keymaps` in the build
+// directory, with each layer in the smaller of two forms:
+//  - dense: all the keycodes of the layer, as in `keymaps`,
+//  - sparse: a word per row with a bitmap of the keys that are not the layer's
+//    fill keycode (KC_TRNS or KC_NO) and the index of the row's first keycode,
+//    followed by only those keycodes.
+//
+// A sparse key is found with one read of its row and a popcount of the bits
+// before its column, no walk over the row or layer.
+//
+// `keymap_layer_count()` is overridden here and `keycode_at_keymap_location()`
+// in features/layout_permutation.c to read the packed keymap, so `keymaps` is
+// no longer referenced and is left out of the firmware by the linker. Matrix
+// positions without a key read as the fill keycode on sparse layers.
+//------------------------------------------------------------------------------
+
+#define PACKED_KEYMAP_DENSE 0xFF
+
+_Static_assert(MATRIX_COLS <= 8, "packed keymap rows are bitmaps of a byte");
+
+typedef struct {
+    uint16_t fill; // Keycode of the keys a sparse layer doesn't store
+    uint16_t keys; // Index of the layer's first keycode in `packed_keymap_keys`
+    uint8_t  rows; // Index of its first row in `packed_keymap_rows`, or PACKED_KEYMAP_DENSE
+} packed_keymap_layer_t;
+
+// Tables generated in keymap_packed.h, included by keymap.c, all in flash.
+extern const packed_keymap_layer_t PROGMEM packed_keymap_layers[];
+extern const uint8_t PROGMEM               NUM_PACKED_KEYMAP_LAYERS;
+extern const uint16_t PROGMEM              packed_keymap_rows[];
+extern const uint16_t PROGMEM              packed_keymap_keys[];
+
+// Keycode of a key on a layer, KC_NO outside of the keymap.
+uint16_t packed_keymap_keycode(uint8_t layer, uint8_t row, uint8_t col);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,204 @@
+#include "position_combos.h"
+#include "achordion.h"
+#include "stack_watch.h"
+
+#ifndef POSITION_COMBO_IDLE
+#    define POSITION_COMBO_IDLE 100
+#endif
+
+// Columns of each row that belong to a combo.
+static uint8_t combo_cols[MATRIX_ROWS];
+static uint8_t combo_count = 0;
+
+// Held back press events and the combos they can still complete.
+static keyevent_t buffer[POSITION_COMBO_MAX_KEYS];
+static uint8_t    buffer_size = 0;
+static uint16_t   candidates  = 0;
+static uint8_t    term        = 0;
+static bool       replaying   = false;
+
+// Fired combos whose keys are all still pressed, and the columns of each row
+// whose release belongs to a fired combo.
+static uint16_t active = 0;
+static uint8_t  consumed_cols[MATRIX_ROWS];
+
+static uint16_t last_press = 0;
+
+__attribute__((weak)) void position_combo_event(uint8_t index, bool pressed) {}
+
+//------------------------------------------------------------------------------
+// Helpers
+//------------------------------------------------------------------------------
+static position_combo_t read_combo(uint8_t index) {
+    position_combo_t combo;
+    memcpy_P(&combo, &position_combos[index], sizeof(combo));
+    return combo;
+}
+
+static bool in_combo(const position_combo_t *combo, keypos_t key) {
+    for (uint8_t i = 0; i < combo->size; i++) {
+        if (combo->keys[i].row == key.row && combo->keys[i].col == key.col) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Combos on an active layer that contain `key`, out of `mask`.
+static uint16_t combos_with(uint16_t mask, keypos_t key) {
+    uint16_t result = 0;
+    for (uint8_t i = 0; i < combo_count; i++) {
+        const uint16_t bit = (uint16_t)1 << i;
+        if (!(mask & bit)) {
+            continue;
+        }
+        const position_combo_t combo = read_combo(i);
+        if (layer_state_is(combo.layer) && in_combo(&combo, key)) {
+            result |= bit;
+        }
+    }
+    return result;
+}
+
+// The shortest term of the combos in `mask` applies while they are pending.
+static uint8_t shortest_term(uint16_t mask) {
+    uint8_t result = UINT8_MAX;
+    for (uint8_t i = 0; i < combo_count; i++) {
+        if (mask & ((uint16_t)1 << i)) {
+            const uint8_t combo_term = read_combo(i).term;
+            result                   = combo_term < result ? combo_term : result;
+        }
+    }
+    return result;
+}
+
+static void replay(void) {
+    // Replayed events go through `pre_process_record_user()` again, they are
+    // let through there.
+    replaying = true;
+    stack_watch_mark(STACK_MARK_POSITION_COMBO);
+    for (uint8_t i = 0; i < buffer_size; i++) {
+        action_exec(buffer[i]);
+    }
+    replaying   = false;
+    buffer_size = 0;
+    candidates  = 0;
+}
+
+// Fires the first candidate whose keys are all held back, if any.
+static void fire(void) {
+    for (uint8_t i = 0; i < combo_count; i++) {
+        if (!(candidates & ((uint16_t)1 << i))) {
+            continue;
+        }
+        const position_combo_t combo = read_combo(i);
+        if (combo.size != buffer_size) {
+            continue;
+        }
+        for (uint8_t j = 0; j < buffer_size; j++) {
+            consumed_cols[buffer[j].key.row] |= 1 << buffer[j].key.col;
+        }
+        active |= (uint16_t)1 << i;
+        buffer_size = 0;
+        candidates  = 0;
+        position_combo_event(i, true);
+        return;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Keycode handling
+//------------------------------------------------------------------------------
+void position_combos_init(void) {
+    const uint8_t count = pgm_read_byte(&NUM_POSITION_COMBOS);
+    combo_count         = count < POSITION_COMBO_MAX ? count : POSITION_COMBO_MAX;
+    for (uint8_t i = 0; i < combo_count; i++) {
+        const position_combo_t combo = read_combo(i);
+        for (uint8_t j = 0; j < combo.size; j++) {
+            combo_cols[combo.keys[j].row] |= 1 << combo.keys[j].col;
+        }
+    }
+}
+
+void position_combos_task(void) {
+    if (buffer_size && timer_elapsed(buffer[0].time) >= term) {
+        replay();
+    }
+}
+
+static bool process_release(keypos_t key) {
+    const uint8_t bit = 1 << key.col;
+    if (!(consumed_cols[key.row] & bit)) {
+        return true;
+    }
+    consumed_cols[key.row] &= ~bit;
+
+    // The first released key ends the combo, the others are still consumed.
+    for (uint8_t i = 0; i < combo_count; i++) {
+        if (active & ((uint16_t)1 << i)) {
+            const position_combo_t combo = read_combo(i);
+            if (in_combo(&combo, key)) {
+                active &= ~((uint16_t)1 << i);
+                position_combo_event(i, false);
+            }
+        }
+    }
+    return false;
+}
+
+bool process_position_combos(uint16_t keycode, keyrecord_t *record) {
+    if (replaying || !IS_KEYEVENT(record->event)) {
+        return true;
+    }
+
+    const keypos_t key       = record->event.key;
+    const bool     is_member = combo_cols[key.row] & (1 << key.col);
+
+    if (!record->event.pressed) {
+        // Releasing a held back key means it was not part of a combo.
+        if (buffer_size) {
+            replay();
+        }
+        return !is_member || process_release(key);
+    }
+
+    const uint16_t previous_press = last_press;
+    // Layer keys don't count as typing, so that a combo can follow them.
+    if (!IS_QK_MOMENTARY(keycode)) {
+        last_press = record->event.time;
+    }
+
+    if (!is_member) {
+        if (buffer_size) {
+            replay();
+        }
+        return true;
+    }
+
+    if (buffer_size) {
+        const uint16_t remaining = combos_with(candidates, key);
+        if (!remaining || buffer_size == POSITION_COMBO_MAX_KEYS) {
+            replay();
+            return true;
+        }
+        candidates            = remaining;
+        term                  = shortest_term(candidates);
+        buffer[buffer_size++] = record->event;
+        fire();
+        return false;
+    }
+
+    if (achordion_pending() || TIMER_DIFF_16(record->event.time, previous_press) < POSITION_COMBO_IDLE) {
+        return true;
+    }
+
+    candidates = combos_with(0xFFFF, key);
+    if (!candidates) {
+        return true;
+    }
+
+    term        = shortest_term(candidates);
+    buffer[0]   = record->event;
+    buffer_size = 1;
+    return false;
+}
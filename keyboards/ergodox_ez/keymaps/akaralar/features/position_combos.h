@@ -0,0 +1,78 @@
+#pragma once
+
+#include "quantum.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//------------------------------------------------------------------------------
+// Position combos
+//
+// Combos defined by matrix positions instead of keycodes. At init every
+// position used by a combo is marked in a per-row bitmask, so that a key that
+// is in no combo is passed on after a single bit test, without being delayed.
+//
+// A press of a combo key is held back while it can still start a combo on an
+// active layer. The combo fires as soon as all of its keys are pressed within
+// its own term. Otherwise the held back events are replayed, in order and with
+// their original times, when the term runs out, when one of them is released
+// or when a key outside the candidate combos is pressed.
+//
+// To keep ordinary typing unaffected, a combo is not started while Achordion
+// has an unsettled tap-hold key, whose decision would wait for the held back
+// press, nor within `POSITION_COMBO_IDLE` ms of another key press.
+//------------------------------------------------------------------------------
+
+#ifndef POSITION_COMBO_MAX_KEYS
+#    define POSITION_COMBO_MAX_KEYS 3
+#endif
+
+// Combos are tracked in a 16-bit mask, later entries are ignored.
+#define POSITION_COMBO_MAX 16
+
+typedef struct {
+    keypos_t keys[POSITION_COMBO_MAX_KEYS];
+    uint8_t  size;
+    // Layer that must be active for the combo to fire.
+    uint8_t layer;
+    // Time allowed between the first and the last key press, in ms.
+    uint8_t term;
+} position_combo_t;
+
+// A key by its `col:row` label in the keymap's position diagram.
+#define COMBO_KEY(col, row) {(col), (row)}
+
+// A combo of up to `POSITION_COMBO_MAX_KEYS` keys, for example
+//
+//     POSITION_COMBO(SYMB, 40, COMBO_KEY(2, 4), COMBO_KEY(2, 5))
+#define POSITION_COMBO(layer_, term_, ...)                                                  \
+    {                                                                                       \
+        .keys = {__VA_ARGS__}, .size = sizeof((keypos_t[]){__VA_ARGS__}) / sizeof(keypos_t), \
+        .layer = (layer_), .term = (term_),                                                 \
+    }
+
+// Table of combos, defined in keymap.c and kept in flash.
+extern const position_combo_t PROGMEM position_combos[];
+// Number of entries in the `position_combos` table, also in flash.
+extern const uint8_t PROGMEM NUM_POSITION_COMBOS;
+
+// Builds the position index. Call from `keyboard_post_init_user()`.
+void position_combos_init(void);
+
+// Replays held back keys when the term runs out. Call from
+// `matrix_scan_user()`.
+void position_combos_task(void);
+
+// Call first thing from `pre_process_record_user()`, which runs before QMK's
+// tap-hold handling. Returns false for events that are held back or consumed
+// by a combo.
+bool process_position_combos(uint16_t keycode, keyrecord_t *record);
+
+// Called when a combo fires and when the first of its keys is released.
+// `index` is the combo's entry in `position_combos`.
+void position_combo_event(uint8_t index, bool pressed);
+
+#ifdef __cplusplus
+}
+#endif
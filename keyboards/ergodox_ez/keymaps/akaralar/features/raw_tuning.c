@@ -0,0 +1,204 @@
+#include "raw_tuning.h"
+#include "raw_hid.h"
+#include "tuning.h"
+#include "debounce_per_key.h"
+#include "ergodox_matrix.h"
+#include "key_stats.h"
+#include "misfire.h"
+#include "speculative_tap.h"
+#include "stack_watch.h"
+
+// Offsets in a report.
+#define REPORT_COMMAND 0
+#define REPORT_STATUS 1
+#define REPORT_ARGS 1
+#define REPORT_RESULT 2
+
+// Shortest report that has room for every command except the ones returning a
+// list, which check the size themselves.
+#define REPORT_MIN_LENGTH 12
+
+static void put_u16(uint8_t *data, uint16_t value) {
+    data[0] = value & 0xFF;
+    data[1] = value >> 8;
+}
+
+static uint16_t get_u16(const uint8_t *data) {
+    return data[0] | (data[1] << 8);
+}
+
+// Runs the command with its arguments in `args` and writes its result to
+// `result`. Returns the reply status.
+static uint8_t run_command(uint8_t command, const uint8_t *args, uint8_t *result, uint8_t result_size) {
+    switch (command) {
+        case RAW_TUNING_VERSION:
+            result[0] = RAW_TUNING_PROTOCOL_VERSION;
+            result[1] = TUNING_VERSION;
+            result[2] = TUNING_PARAM_COUNT;
+            return RAW_TUNING_OK;
+
+        case RAW_TUNING_GET_PARAM: {
+            const uint8_t param = args[0];
+            if (param >= TUNING_PARAM_COUNT) {
+                return RAW_TUNING_INVALID_ARGUMENT;
+            }
+            result[0] = param;
+            put_u16(&result[1], tuning_get(param));
+            return RAW_TUNING_OK;
+        }
+
+        case RAW_TUNING_SET_PARAM: {
+            const uint8_t  param = args[0];
+            const uint16_t value = get_u16(&args[1]);
+            if (!tuning_set(param, value)) {
+                return RAW_TUNING_INVALID_ARGUMENT;
+            }
+            result[0] = param;
+            put_u16(&result[1], tuning_get(param));
+            return RAW_TUNING_OK;
+        }
+
+        case RAW_TUNING_GET_PARAMS:
+            if (result_size < 1 + TUNING_PARAM_COUNT * sizeof(uint16_t)) {
+                return RAW_TUNING_INVALID_ARGUMENT;
+            }
+            result[0] = TUNING_PARAM_COUNT;
+            for (uint8_t i = 0; i < TUNING_PARAM_COUNT; i++) {
+                put_u16(&result[1 + i * sizeof(uint16_t)], tuning_get(i));
+            }
+            return RAW_TUNING_OK;
+
+        case RAW_TUNING_RESET_PARAMS:
+            tuning_reset();
+            return RAW_TUNING_OK;
+
+        case RAW_TUNING_SAVE_PARAMS:
+            tuning_save();
+            return RAW_TUNING_OK;
+
+        case RAW_TUNING_GET_COUNTERS:
+            put_u16(&result[0], ergodox_matrix_scan_rate());
+            put_u16(&result[2], ergodox_matrix_i2c_errors());
+            result[4] = ergodox_matrix_left_connected();
+            return RAW_TUNING_OK;
+
+        case RAW_TUNING_GET_CHATTER: {
+            const uint8_t row = args[0];
+            if (row >= MATRIX_ROWS || result_size < 1 + MATRIX_COLS) {
+                return RAW_TUNING_INVALID_ARGUMENT;
+            }
+            result[0] = row;
+            for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+                result[1 + col] = debounce_chatter_count(row, col);
+            }
+            return RAW_TUNING_OK;
+        }
+
+        case RAW_TUNING_CLEAR_CHATTER:
+            debounce_clear_chatter();
+            return RAW_TUNING_OK;
+
+        case RAW_TUNING_GET_PRESSES: {
+            const uint8_t row = args[0];
+            if (row >= MATRIX_ROWS || result_size < 1 + MATRIX_COLS * sizeof(uint16_t)) {
+                return RAW_TUNING_INVALID_ARGUMENT;
+            }
+            result[0] = row;
+            for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+                put_u16(&result[1 + col * sizeof(uint16_t)], key_stats_presses(row, col));
+            }
+            return RAW_TUNING_OK;
+        }
+
+        case RAW_TUNING_GET_TAP_HOLD: {
+            const uint8_t               slot  = args[0];
+            const key_stats_tap_hold_t *stats = key_stats_tap_hold(slot);
+            if (stats == NULL || result_size < 6 + 2 * KEY_STATS_BUCKETS) {
+                return RAW_TUNING_INVALID_ARGUMENT;
+            }
+            result[0] = slot;
+            result[1] = stats->key;
+            put_u16(&result[2], stats->taps);
+            put_u16(&result[4], stats->holds);
+            memcpy(&result[6], stats->tap_durations, KEY_STATS_BUCKETS);
+            memcpy(&result[6 + KEY_STATS_BUCKETS], stats->hold_durations, KEY_STATS_BUCKETS);
+            return RAW_TUNING_OK;
+        }
+
+        case RAW_TUNING_CLEAR_STATS:
+            key_stats_clear();
+            misfire_clear();
+            speculative_tap_clear();
+            stack_watch_clear();
+            return RAW_TUNING_OK;
+
+        case RAW_TUNING_GET_MISFIRES: {
+            const uint8_t        slot  = args[0];
+            const misfire_key_t *stats = misfire_key(slot);
+            if (stats == NULL) {
+                return RAW_TUNING_INVALID_ARGUMENT;
+            }
+            result[0] = slot;
+            result[1] = stats->key;
+            put_u16(&result[2], stats->settles);
+            put_u16(&result[4], stats->tap_misfires);
+            put_u16(&result[6], stats->hold_misfires);
+#ifdef MISFIRE_NUDGE
+            result[8] = stats->term_offset;
+#endif
+            return RAW_TUNING_OK;
+        }
+
+        case RAW_TUNING_GET_MISFIRE: {
+            const uint8_t        index = args[0];
+            const misfire_log_t *entry = misfire_log(index);
+            if (entry == NULL) {
+                return RAW_TUNING_INVALID_ARGUMENT;
+            }
+            result[0] = index;
+            result[1] = entry->key;
+            result[2] = entry->reason;
+            put_u16(&result[3], entry->settle_time);
+            put_u16(&result[5], entry->correction_time);
+            return RAW_TUNING_OK;
+        }
+
+        case RAW_TUNING_GET_SPECULATION: {
+            const speculative_tap_counts_t *counts = speculative_tap_counts();
+            put_u16(&result[0], counts->speculations);
+            put_u16(&result[2], counts->rollbacks);
+            return RAW_TUNING_OK;
+        }
+
+        case RAW_TUNING_GET_STACK:
+            if (result_size < 5 + STACK_MARK_COUNT * sizeof(uint16_t)) {
+                return RAW_TUNING_INVALID_ARGUMENT;
+            }
+            put_u16(&result[0], stack_watch_size());
+            put_u16(&result[2], stack_watch_unused());
+            result[4] = STACK_MARK_COUNT;
+            for (uint8_t mark = 0; mark < STACK_MARK_COUNT; mark++) {
+                put_u16(&result[5 + mark * sizeof(uint16_t)], stack_watch_depth(mark));
+            }
+            return RAW_TUNING_OK;
+
+        default:
+            return RAW_TUNING_UNKNOWN_COMMAND;
+    }
+}
+
+bool process_raw_tuning(uint8_t *data, uint8_t length) {
+    const uint8_t command = data[REPORT_COMMAND];
+    if (length < REPORT_MIN_LENGTH) {
+        return false;
+    }
+
+    // Arguments are copied out, as the result overwrites them.
+    uint8_t args[3];
+    memcpy(args, &data[REPORT_ARGS], sizeof(args));
+    memset(&data[REPORT_STATUS], 0, length - REPORT_STATUS);
+
+    data[REPORT_STATUS] = run_command(command, args, &data[REPORT_RESULT], length - REPORT_RESULT);
+    raw_hid_send(data, length);
+    return true;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "quantum.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//------------------------------------------------------------------------------
+// Raw HID tuning protocol
+//
+// Reads and changes the tuning parameters (see `tuning.h`) and reads the
+// matrix, debounce, key statistics, misfire and speculative tap counters and
+// the stack usage over raw HID, so that timings can be tried out without
+// flashing. `tools/raw_tuning.py` is the host side. Oryx takes raw HID for
+// itself, so this is only in builds made with `RAW_TUNING=yes`, see rules.mk.
+//
+// Every report starts with a command byte. The reply echoes it, followed by a
+// status byte and the command's result. Multi-byte values are little endian.
+// Commands this version doesn't know are answered with UNKNOWN_COMMAND, so
+// that a newer host tool can tell them from a keyboard that doesn't reply.
+//
+//   command         | arguments           | result
+//   ----------------|---------------------|--------------------------------------
+//   VERSION         |                     | protocol version, tuning version,
+//                   |                     | parameter count
+//   GET_PARAM       | id                  | id, value (u16)
+//   SET_PARAM       | id, value (u16)     | id, value (u16)
+//   GET_PARAMS      |                     | parameter count, values (u16 each)
+//   RESET_PARAMS    |                     |
+//   SAVE_PARAMS     |                     |
+//   GET_COUNTERS    |                     | scan rate (u16), I2C errors (u16),
+//                   |                     | left half connected (u8)
+//   GET_CHATTER     | row                 | row, chatter counters of its columns
+//   CLEAR_CHATTER   |                     |
+//   GET_PRESSES     | row                 | row, press counts of its columns (u16)
+//   GET_TAP_HOLD    | slot                | slot, key (row | col << 4), taps (u16),
+//                   |                     | holds (u16), tap and hold duration
+//                   |                     | histograms (u8 each)
+//   CLEAR_STATS     |                     |
+//   GET_MISFIRES    | slot                | slot, key (row | col << 4), settles
+//                   |                     | (u16), tap misfires (u16), hold
+//                   |                     | misfires (u16), term offset (i8)
+//   GET_MISFIRE     | index (0 is latest) | index, key, reason, settle time (u16),
+//                   |                     | correction time (u16)
+//   GET_SPECULATION |                     | speculations (u16), rollbacks (u16)
+//   GET_STACK       |                     | free RAM at boot (u16), never used
+//                   |                     | (u16), mark count, deepest depth
+//                   |                     | at each mark (u16 each)
+//------------------------------------------------------------------------------
+
+#define RAW_TUNING_PROTOCOL_VERSION 1
+
+enum raw_tuning_command {
+    RAW_TUNING_VERSION = 0x01,
+    RAW_TUNING_GET_PARAM,
+    RAW_TUNING_SET_PARAM,
+    RAW_TUNING_GET_PARAMS,
+    RAW_TUNING_RESET_PARAMS,
+    RAW_TUNING_SAVE_PARAMS,
+    RAW_TUNING_GET_COUNTERS,
+    RAW_TUNING_GET_CHATTER,
+    RAW_TUNING_CLEAR_CHATTER,
+    RAW_TUNING_GET_PRESSES,
+    RAW_TUNING_GET_TAP_HOLD,
+    RAW_TUNING_CLEAR_STATS,
+    RAW_TUNING_GET_MISFIRES,
+    RAW_TUNING_GET_MISFIRE,
+    RAW_TUNING_GET_SPECULATION,
+    RAW_TUNING_GET_STACK,
+};
+
+enum raw_tuning_status {
+    RAW_TUNING_OK,
+    RAW_TUNING_UNKNOWN_COMMAND,
+    RAW_TUNING_INVALID_ARGUMENT,
+};
+
+// Handles a tuning command in `data` and replaces it with the reply. Returns
+// false if the report is too short to hold a reply.
+bool process_raw_tuning(uint8_t *data, uint8_t length);
+
+#ifdef __cplusplus
+}
+#endif
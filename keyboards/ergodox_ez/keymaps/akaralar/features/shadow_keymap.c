@@ -0,0 +1,87 @@
+#include "shadow_keymap.h"
+
+static uint16_t keycodes[MATRIX_ROWS][MATRIX_COLS];
+static uint8_t  layers_of[MATRIX_ROWS][MATRIX_COLS];
+
+// Layers the shadow was resolved for, with the default layer state.
+static layer_state_t shadow_layers = 0;
+static bool          ready         = false;
+
+//------------------------------------------------------------------------------
+// Helpers
+//------------------------------------------------------------------------------
+// Same walk as QMK's `layer_switch_get_layer()`.
+static void resolve(uint8_t row, uint8_t col, layer_state_t layers) {
+    const uint8_t count = keymap_layer_count();
+    for (int8_t layer = get_highest_layer(layers); layer >= 0; layer--) {
+        if (!(layers & ((layer_state_t)1 << layer)) || layer >= count) {
+            continue;
+        }
+        const uint16_t keycode = keycode_at_keymap_location(layer, row, col);
+        if (keycode != KC_TRNS) {
+            keycodes[row][col]  = keycode;
+            layers_of[row][col] = layer;
+            return;
+        }
+    }
+
+    // Transparent on all active layers, QMK falls back to the default layer.
+    const uint8_t layer = get_highest_layer(default_layer_state);
+    keycodes[row][col]  = keycode_at_keymap_location(layer, row, col);
+    layers_of[row][col] = layer;
+}
+
+//------------------------------------------------------------------------------
+// Shadow keymap
+//------------------------------------------------------------------------------
+void shadow_keymap_update(layer_state_t layers) {
+    const layer_state_t changed = ready ? layers ^ shadow_layers : (layer_state_t)~0;
+    if (!changed) {
+        return;
+    }
+    const uint8_t highest_changed = get_highest_layer(changed);
+
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            // A change above the resolved layer can uncover a keycode, and
+            // one at it can remove it. Changes below it are hidden.
+            if (!ready || layers_of[row][col] <= highest_changed) {
+                resolve(row, col, layers);
+            }
+        }
+    }
+
+    shadow_layers = layers;
+    ready         = true;
+}
+
+void shadow_keymap_refresh(void) {
+    ready = false;
+    shadow_keymap_update(layer_state | default_layer_state);
+}
+
+uint16_t shadow_keymap_keycode(keypos_t key) {
+    return keycodes[key.row][key.col];
+}
+
+uint8_t shadow_keymap_layer(keypos_t key) {
+    return layers_of[key.row][key.col];
+}
+
+// Replaces QMK's lookup, which reads the keymap in PROGMEM for every layer it
+// is asked about.
+uint16_t keymap_key_to_keycode(uint8_t layer, keypos_t key) {
+    if (key.row >= MATRIX_ROWS || key.col >= MATRIX_COLS) {
+        return KC_NO;
+    }
+    if (ready) {
+        const uint8_t resolved = layers_of[key.row][key.col];
+        if (layer == resolved) {
+            return keycodes[key.row][key.col];
+        }
+        if (layer > resolved && (shadow_layers & ((layer_state_t)1 << layer))) {
+            return KC_TRNS;
+        }
+    }
+    return keycode_at_keymap_location(layer, key.row, key.col);
+}
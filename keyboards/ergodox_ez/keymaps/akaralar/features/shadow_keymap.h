@@ -0,0 +1,46 @@
+#pragma once
+
+#include "quantum.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//------------------------------------------------------------------------------
+// Shadow keymap
+//
+// Copy of the keymap in RAM with the active layers already resolved: for each
+// key, the keycode of the highest active layer where it is not transparent and
+// that layer. QMK resolves a key by reading every active layer from the top
+// down in PROGMEM until it finds a keycode that is not KC_TRNS, which takes
+// several reads on a keymap with many transparent layers.
+//
+// `keymap_key_to_keycode()` is overridden to answer from the shadow: the
+// resolved layer of a key gets its keycode from RAM and the active layers above
+// it KC_TRNS, without reading PROGMEM. Other layers are still read from the
+// keymap.
+//
+// On a layer change only the keys whose resolved layer is at or below the
+// highest changed layer are resolved again.
+//
+// Takes 3 bytes of RAM per key.
+//------------------------------------------------------------------------------
+
+// Resolves the keys for `layers`, which should include the default layer
+// state. Call from `keyboard_post_init_user()`, `layer_state_set_user()` and
+// `default_layer_state_set_user()`.
+void shadow_keymap_update(layer_state_t layers);
+
+// Resolves all keys again for the current layers, after the keymap itself
+// changed, for example on a layout switch.
+void shadow_keymap_refresh(void);
+
+// Keycode of a key on the active layers, with one read from RAM.
+uint16_t shadow_keymap_keycode(keypos_t key);
+
+// Layer the keycode of a key comes from.
+uint8_t shadow_keymap_layer(keypos_t key);
+
+#ifdef __cplusplus
+}
+#endif
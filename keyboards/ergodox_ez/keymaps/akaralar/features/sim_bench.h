@@ -0,0 +1,41 @@
+#pragma once
+
+#include "quantum.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//------------------------------------------------------------------------------
+// Simulator benchmark hooks
+//
+// With `SIM_BENCH` defined (`make ... SIM_BENCH=yes`) the firmware is built to
+// run in simavr under tools/sim_bench, not on the keyboard. The matrix is read
+// from `sim_bench_matrix`, which the simulator writes from a key trace,
+// instead of from the pins and the MCP23018.
+//
+// Code is marked by writing to GPIOR0, which does nothing on the hardware and
+// costs one cycle. The simulator counts the cycles between marks. Without
+// `SIM_BENCH` the marks compile to nothing.
+//
+// Keep the marks in sync with `enum mark` in tools/sim_bench/sim_bench.c.
+//------------------------------------------------------------------------------
+
+enum sim_bench_mark {
+    SIM_BENCH_SCAN = 1,   // Start of a matrix scan
+    SIM_BENCH_RECORD,     // Start of `process_record_user()`
+    SIM_BENCH_RECORD_END, // End of `process_record_user()`
+};
+
+#ifdef SIM_BENCH
+// Matrix rows written by the simulator, found by its symbol name.
+extern volatile matrix_row_t sim_bench_matrix[MATRIX_ROWS];
+
+#    define SIM_BENCH_MARK(mark) (GPIOR0 = (mark))
+#else
+#    define SIM_BENCH_MARK(mark)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,144 @@
+#include "smooth_scroll.h"
+
+#ifdef WHEEL_EXTENDED_REPORT
+#    define MAX_UNITS INT16_MAX
+#else
+#    define MAX_UNITS INT8_MAX
+#endif
+
+enum direction {
+    UP    = 1 << 0,
+    DOWN  = 1 << 1,
+    LEFT  = 1 << 2,
+    RIGHT = 1 << 3,
+};
+
+enum axis { V, H };
+
+static struct {
+    uint8_t  directions;   // Held wheel keys
+    uint16_t held_since;   // When the first of the held keys was pressed
+    uint16_t last_report;  // When units were last added up and sent
+    int32_t  remainder[2]; // Units not sent yet, 8.8 fixed point
+} scroll;
+
+__attribute__((weak)) uint8_t smooth_scroll_speed(uint16_t held) {
+    if (held >= SMOOTH_SCROLL_RAMP_TIME) {
+        return SMOOTH_SCROLL_MAX_SPEED;
+    }
+    // Square ease-in, like the kinetic mouse.
+    const uint16_t ramp  = ((uint32_t)held << 8) / SMOOTH_SCROLL_RAMP_TIME;
+    const uint16_t curve = ((uint32_t)ramp * ramp) >> 8;
+    return SMOOTH_SCROLL_BASE_SPEED + (((SMOOTH_SCROLL_MAX_SPEED - SMOOTH_SCROLL_BASE_SPEED) * (uint32_t)curve) >> 8);
+}
+
+//------------------------------------------------------------------------------
+// Helpers
+//------------------------------------------------------------------------------
+static uint8_t direction_of(uint16_t keycode) {
+    switch (keycode) {
+        case KC_WH_U: return UP;
+        case KC_WH_D: return DOWN;
+        case KC_WH_L: return LEFT;
+        case KC_WH_R: return RIGHT;
+        default:      return 0;
+    }
+}
+
+// Wheel units sent for a detent, the multiplier of the report descriptor.
+static uint16_t resolution(void) {
+#ifdef POINTING_DEVICE_HIRES_SCROLL_ENABLE
+    return pointing_device_get_hires_scroll_resolution();
+#else
+    return 1;
+#endif
+}
+
+// Direction of an axis, positive is up and right.
+static int8_t sign(enum axis axis) {
+    const uint8_t forward  = axis == V ? UP : RIGHT;
+    const uint8_t backward = axis == V ? DOWN : LEFT;
+    return !!(scroll.directions & forward) - !!(scroll.directions & backward);
+}
+
+// Whole units to send on an axis, the fraction is kept for the next report.
+static int16_t take_units(enum axis axis) {
+    int32_t units = scroll.remainder[axis] >> 8;
+    if (units > MAX_UNITS) {
+        units = MAX_UNITS;
+    } else if (units < -MAX_UNITS) {
+        units = -MAX_UNITS;
+    }
+    scroll.remainder[axis] -= units * 256;
+    return units;
+}
+
+static void send(void) {
+    report_mouse_t report = mousekey_get_report();
+    report.x              = 0;
+    report.y              = 0;
+    report.v              = take_units(V);
+    report.h              = take_units(H);
+    if (report.v || report.h) {
+        host_mouse_send(&report);
+    }
+}
+
+//------------------------------------------------------------------------------
+// Processing
+//------------------------------------------------------------------------------
+bool process_smooth_scroll(uint16_t keycode, keyrecord_t *record) {
+    const uint8_t direction = direction_of(keycode);
+    if (!direction) {
+        return true;
+    }
+
+    if (!record->event.pressed) {
+        scroll.directions &= ~direction;
+        if (!scroll.directions) {
+            // Drop what is left of a unit, the next press starts afresh.
+            scroll.remainder[V] = 0;
+            scroll.remainder[H] = 0;
+        }
+        return false;
+    }
+
+    if (!scroll.directions) {
+        scroll.held_since  = timer_read();
+        scroll.last_report = scroll.held_since;
+    }
+    scroll.directions |= direction;
+
+    // One detent right away, so that a tap scrolls like a wheel notch.
+    const enum axis axis = direction & (UP | DOWN) ? V : H;
+    const int8_t    step = direction & (UP | RIGHT) ? 1 : -1;
+    scroll.remainder[axis] += (int32_t)step * resolution() * 256;
+    send();
+    return false;
+}
+
+void smooth_scroll_task(void) {
+    if (!scroll.directions) {
+        return;
+    }
+    const uint16_t now     = timer_read();
+    const uint16_t elapsed = TIMER_DIFF_16(now, scroll.last_report);
+    if (elapsed < SMOOTH_SCROLL_INTERVAL) {
+        return;
+    }
+    scroll.last_report = now;
+
+    const uint16_t held = TIMER_DIFF_16(now, scroll.held_since);
+    if (held < SMOOTH_SCROLL_DELAY) {
+        return;
+    }
+
+    // Units in 8.8 fixed point for the time since the last report, not before
+    // the delay and without catching up on a slow scan.
+    const uint16_t scrolled = MIN(MIN(elapsed, held - SMOOTH_SCROLL_DELAY), 4 * SMOOTH_SCROLL_INTERVAL);
+    const uint8_t  speed    = smooth_scroll_speed(held - SMOOTH_SCROLL_DELAY);
+    const uint32_t units    = (uint32_t)speed * resolution() * scrolled * 256 / 1000;
+    scroll.remainder[V] += sign(V) * (int32_t)units;
+    scroll.remainder[H] += sign(H) * (int32_t)units;
+    send();
+}
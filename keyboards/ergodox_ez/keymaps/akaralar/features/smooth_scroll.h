@@ -0,0 +1,68 @@
+#pragma once
+
+#include "quantum.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//------------------------------------------------------------------------------
+// Smooth scroll
+//
+// Scrolling of the mouse wheel keys at a speed that eases in, instead of QMK's
+// fixed steps.
+//
+// A press scrolls one detent right away. Held for SMOOTH_SCROLL_DELAY ms, the
+// key scrolls on at a speed that eases in from SMOOTH_SCROLL_BASE_SPEED to
+// SMOOTH_SCROLL_MAX_SPEED detents per second along a square curve over
+// SMOOTH_SCROLL_RAMP_TIME ms, see `smooth_scroll_speed()`.
+//
+// Units to scroll are added up in 8.8 fixed point, and whole units are sent at
+// most every SMOOTH_SCROLL_INTERVAL ms, 40 times a second. Fractions of a unit
+// are carried over to the next report.
+//
+// The keymap's build sends a unit per detent, so scrolling eases in but still
+// moves in whole detents, one report each up to 40 detents per second.
+// Scrolling in fractions of a detent is opt-in, see config.h: with
+// POINTING_DEVICE_HIRES_SCROLL_ENABLE, QMK's mouse report descriptor has a
+// resolution multiplier for the wheel and a detent is sent as that many units.
+// Hosts with high resolution scrolling, like Windows and Linux, take each unit
+// as a fraction of a detent. macOS ignores the multiplier and takes each unit
+// as a detent, so the same code scrolls as many times faster there. A report
+// of several detents then needs WHEEL_EXTENDED_REPORT, as a wheel report of a
+// byte holds about one.
+//------------------------------------------------------------------------------
+
+#ifndef SMOOTH_SCROLL_INTERVAL
+#    define SMOOTH_SCROLL_INTERVAL 25
+#endif
+
+#ifndef SMOOTH_SCROLL_DELAY
+#    define SMOOTH_SCROLL_DELAY 150
+#endif
+
+#ifndef SMOOTH_SCROLL_BASE_SPEED
+#    define SMOOTH_SCROLL_BASE_SPEED 8
+#endif
+
+#ifndef SMOOTH_SCROLL_MAX_SPEED
+#    define SMOOTH_SCROLL_MAX_SPEED 60
+#endif
+
+#ifndef SMOOTH_SCROLL_RAMP_TIME
+#    define SMOOTH_SCROLL_RAMP_TIME 1000
+#endif
+
+// Call from `process_record_user()`. Returns false for the wheel keys.
+bool process_smooth_scroll(uint16_t keycode, keyrecord_t *record);
+
+// Call from `matrix_scan_user()` to send the scroll.
+void smooth_scroll_task(void);
+
+// Scroll speed after the wheel keys were held for `held` ms past the delay, in
+// detents per second.
+uint8_t smooth_scroll_speed(uint16_t held);
+
+#ifdef __cplusplus
+}
+#endif
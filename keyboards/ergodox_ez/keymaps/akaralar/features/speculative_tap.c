@@ -0,0 +1,76 @@
+#include "speculative_tap.h"
+
+// Columns of each row whose press was speculated and is not settled yet, and
+// whose tap was settled and already typed, so that its release is dropped too.
+static uint8_t pending_cols[MATRIX_ROWS];
+static uint8_t tapped_cols[MATRIX_ROWS];
+
+static speculative_tap_counts_t counts = {0};
+
+__attribute__((weak)) bool speculative_tap_key(uint16_t keycode, keyrecord_t *record) {
+    return false;
+}
+
+static void count(uint16_t *counter) {
+    if (*counter < UINT16_MAX) {
+        (*counter)++;
+    }
+}
+
+void pre_process_speculative_tap(uint16_t keycode, keyrecord_t *record) {
+    if (!record->event.pressed || !IS_KEYEVENT(record->event) || !IS_QK_MOD_TAP(keycode)) {
+        return;
+    }
+    if (((get_mods() | get_oneshot_mods()) & ~MOD_MASK_SHIFT) || !speculative_tap_key(keycode, record)) {
+        return;
+    }
+
+    const keypos_t key = record->event.key;
+    pending_cols[key.row] |= 1 << key.col;
+    count(&counts.speculations);
+    tap_code(QK_MOD_TAP_GET_TAP_KEYCODE(keycode));
+}
+
+bool process_speculative_tap(uint16_t keycode, keyrecord_t *record) {
+    if (!IS_KEYEVENT(record->event)) {
+        return true;
+    }
+
+    const keypos_t key = record->event.key;
+    const uint8_t  bit = 1 << key.col;
+
+    if (!record->event.pressed) {
+        if (tapped_cols[key.row] & bit) {
+            tapped_cols[key.row] &= ~bit;
+            return false;
+        }
+        return true;
+    }
+
+    if (!(pending_cols[key.row] & bit)) {
+        return true;
+    }
+    pending_cols[key.row] &= ~bit;
+
+    if (record->tap.count > 0) {
+        tapped_cols[key.row] |= bit;
+        return false;
+    }
+
+    // Settled as held. Retract the character without the mods applied so far,
+    // such as eager mods, so that the backspace is a plain one.
+    count(&counts.rollbacks);
+    const uint8_t mods = get_mods();
+    clear_mods();
+    tap_code(KC_BSPC);
+    set_mods(mods);
+    return true;
+}
+
+const speculative_tap_counts_t *speculative_tap_counts(void) {
+    return &counts;
+}
+
+void speculative_tap_clear(void) {
+    counts = (speculative_tap_counts_t){0};
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "quantum.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//------------------------------------------------------------------------------
+// Speculative taps
+//
+// Types the tap keycode of a mod-tap key as soon as it is pressed, instead of
+// after the tap-hold decision. If the key is later settled as tapped, the tap
+// is dropped as it was already typed. If it is settled as held, the typed
+// character is retracted with a backspace before the hold press goes on to
+// apply the mods.
+//
+// Which keys are speculated is decided per press by `speculative_tap_key()`,
+// which is false by default. A key is never speculated while mods other than
+// Shift are active, as the tap would then be a shortcut that a backspace can't
+// undo.
+//
+// Speculated presses and rollbacks are counted in RAM, to see how often the
+// speculation is wrong.
+//------------------------------------------------------------------------------
+
+typedef struct {
+    uint16_t speculations;
+    uint16_t rollbacks;
+} speculative_tap_counts_t;
+
+// Call from `pre_process_record_user()`, which runs before QMK's tap-hold
+// handling, to type the tap right away.
+void pre_process_speculative_tap(uint16_t keycode, keyrecord_t *record);
+
+// Call from `process_record_user()` after tap-hold keys are settled, i.e.
+// after Achordion. Returns false for taps that were already typed.
+bool process_speculative_tap(uint16_t keycode, keyrecord_t *record);
+
+// Whether to speculate the tap of a mod-tap key press.
+bool speculative_tap_key(uint16_t keycode, keyrecord_t *record);
+
+const speculative_tap_counts_t *speculative_tap_counts(void);
+
+void speculative_tap_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
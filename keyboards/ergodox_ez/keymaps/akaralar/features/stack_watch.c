@@ -0,0 +1,75 @@
+#include "stack_watch.h"
+
+#define STACK_PAINT 0xC5
+
+static uint16_t depths[STACK_MARK_COUNT];
+
+#ifdef __AVR__
+// From the avr-libc linker script: end of `.bss` and top of RAM.
+extern uint8_t _end;
+extern uint8_t __stack;
+
+#define STRINGIFY(x) #x
+#define TO_STRING(x) STRINGIFY(x)
+
+// Runs in `.init3`, after the stack pointer is set up and before `.data` and
+// `.bss` are initialized. The stack is empty at this point, so everything from
+// the end of `.bss` up to and including the top of RAM is painted.
+//
+// A naked function only reliably holds basic asm, so this is the usual avr-libc
+// stack paint loop rather than C, which the compiler may give a frame, spills
+// or a call to memset. Only Z (r30:r31), r24 and r25 are used, which the
+// startup code that follows doesn't expect to be preserved.
+__attribute__((naked, used, section(".init3"))) void stack_watch_paint(void) {
+    __asm__ volatile(
+        "    ldi r30, lo8(_end)\n"
+        "    ldi r31, hi8(_end)\n"
+        "    ldi r24, " TO_STRING(STACK_PAINT) "\n"
+        "    ldi r25, hi8(__stack)\n"
+        "    rjmp 2f\n"
+        "1:  st Z+, r24\n"
+        "2:  cpi r30, lo8(__stack)\n"
+        "    cpc r31, r25\n"
+        "    brlo 1b\n"
+        "    breq 1b\n");
+}
+
+void stack_watch_mark(uint8_t mark) {
+    const uint16_t depth = (uintptr_t)&__stack - SP;
+    if (mark < STACK_MARK_COUNT && depth > depths[mark]) {
+        depths[mark] = depth;
+    }
+}
+
+uint16_t stack_watch_size(void) {
+    return &__stack - &_end + 1;
+}
+
+uint16_t stack_watch_unused(void) {
+    // The stack only ever reaches down to the lowest byte it touched, so the
+    // paint is intact from the end of `.bss` up to there.
+    const uint8_t *p = &_end;
+    while (p <= &__stack && *p == STACK_PAINT) {
+        p++;
+    }
+    return p - &_end;
+}
+#else
+void stack_watch_mark(uint8_t mark) {}
+
+uint16_t stack_watch_size(void) {
+    return 0;
+}
+
+uint16_t stack_watch_unused(void) {
+    return 0;
+}
+#endif
+
+uint16_t stack_watch_depth(uint8_t mark) {
+    return mark < STACK_MARK_COUNT ? depths[mark] : 0;
+}
+
+void stack_watch_clear(void) {
+    memset(depths, 0, sizeof(depths));
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "quantum.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//------------------------------------------------------------------------------
+// Stack watch
+//
+// Measures how much of the stack is used, to size buffers against the real
+// headroom. The ATmega32U4 has 2.5 KB of SRAM and the stack grows down from
+// its top towards `.bss`, with nothing to stop it.
+//
+// At boot, before `main()`, the free RAM between the end of `.bss` and the top
+// of RAM is painted with a fixed byte. The bytes that still hold it were never
+// reached by the stack, so the high-water mark is the rest.
+//
+// Marks record the stack depth at the places where the record pipeline
+// re-enters itself or sends keys: Achordion's `process_record()` replays, key
+// sequences of macros and case modes, and combo and dynamic macro replays. The
+// deepest depth seen at each mark is kept.
+//
+// Only measured on AVR, elsewhere everything reads as 0.
+//------------------------------------------------------------------------------
+
+enum stack_mark {
+    STACK_MARK_RECORD_USER,    // Entry of `process_record_user()`
+    STACK_MARK_ACHORDION,      // Achordion replaying a tap-hold record
+    STACK_MARK_CASEMODES,      // Case modes typing a delimiter
+    STACK_MARK_SYMBOL_MACRO,   // Symbol layer macro typing its keys
+    STACK_MARK_DYNAMIC_MACRO,  // Dynamic macro replaying an event
+    STACK_MARK_POSITION_COMBO, // Position combos replaying held back presses
+    STACK_MARK_COUNT,
+};
+
+// Records the current stack depth for `mark` if it is the deepest yet.
+void stack_watch_mark(uint8_t mark);
+
+// Bytes from the end of `.bss` to the top of RAM, shared by heap and stack.
+uint16_t stack_watch_size(void);
+
+// Painted bytes the stack never reached since boot.
+uint16_t stack_watch_unused(void);
+
+// Deepest stack depth seen at `mark`, in bytes from the top of RAM.
+uint16_t stack_watch_depth(uint8_t mark);
+
+// Forgets the depths of the marks. The paint is kept.
+void stack_watch_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
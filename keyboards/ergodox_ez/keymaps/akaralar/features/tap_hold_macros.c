@@ -0,0 +1,80 @@
+#include "tap_hold_macros.h"
+
+#define NO_KEY 0xFF
+
+// The undecided key, its table index and when it was pressed.
+static uint8_t  pending      = NO_KEY;
+static uint16_t pending_time = 0;
+static uint16_t pending_term = 0;
+
+__attribute__((weak)) uint16_t tap_hold_macro_term(uint16_t keycode, keyrecord_t *record) {
+    return TAPPING_TERM;
+}
+
+__attribute__((weak)) void tap_hold_macro_hold(uint16_t macro) {}
+
+//------------------------------------------------------------------------------
+// Helpers
+//------------------------------------------------------------------------------
+static uint8_t find(uint16_t keycode) {
+    // Table keycodes are custom keycodes, everything below them is let
+    // through without a look at the table.
+    if (keycode < QK_KB) {
+        return NO_KEY;
+    }
+    const uint8_t count = pgm_read_byte(&NUM_TAP_HOLD_MACROS);
+    for (uint8_t i = 0; i < count; i++) {
+        if (pgm_read_word(&tap_hold_macros[i].keycode) == keycode) {
+            return i;
+        }
+    }
+    return NO_KEY;
+}
+
+static void tap(void) {
+    tap_code16(pgm_read_word(&tap_hold_macros[pending].tap_keycode));
+    pending = NO_KEY;
+}
+
+static void hold(void) {
+    tap_hold_macro_hold(pgm_read_word(&tap_hold_macros[pending].macro));
+    pending = NO_KEY;
+}
+
+//------------------------------------------------------------------------------
+// Processing
+//------------------------------------------------------------------------------
+bool process_tap_hold_macros(uint16_t keycode, keyrecord_t *record) {
+    const uint8_t index = find(keycode);
+
+    if (record->event.pressed) {
+        // Any press decides the pending key as a tap, before the new press
+        // goes on.
+        if (pending != NO_KEY) {
+            tap();
+        }
+        if (index == NO_KEY) {
+            return true;
+        }
+        pending      = index;
+        pending_time = record->event.time;
+        pending_term = tap_hold_macro_term(keycode, record);
+        return false;
+    }
+
+    if (index == NO_KEY) {
+        return true;
+    }
+    // Released before its term. Releases of keys that were already decided
+    // are dropped.
+    if (index == pending) {
+        tap();
+    }
+    return false;
+}
+
+void tap_hold_macros_task(void) {
+    if (pending != NO_KEY && timer_elapsed(pending_time) >= pending_term) {
+        hold();
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "quantum.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//------------------------------------------------------------------------------
+// Tap-hold macros
+//
+// Keys that type a keycode when tapped and run a macro when held, declared in
+// the `tap_hold_macros` table by custom keycode. They are not QMK tap-hold
+// keys, so they don't go through QMK's tapping or Achordion and they don't need
+// to be placed on a layer-tap.
+//
+// A press is held back until it is decided, only one key at a time:
+//  - released before its term: tapped,
+//  - held for its term: the macro runs and the release is dropped,
+//  - another key pressed before its term: tapped right away, before the other
+//    press, so that fast typing keeps its order.
+//
+// The term is `tap_hold_macro_term()`, TAPPING_TERM by default.
+//------------------------------------------------------------------------------
+
+typedef struct {
+    uint16_t keycode;     // Custom keycode placed in the keymap
+    uint16_t tap_keycode; // Sent with `tap_code16()` on tap
+    uint16_t macro;       // Passed to `tap_hold_macro_hold()` on hold
+} tap_hold_macro_t;
+
+extern const tap_hold_macro_t PROGMEM tap_hold_macros[];
+extern const uint8_t PROGMEM NUM_TAP_HOLD_MACROS;
+
+// Call from `process_record_user()` after tap-hold keys are settled and
+// dynamic macros are recorded. Returns false for tap-hold macro keys.
+bool process_tap_hold_macros(uint16_t keycode, keyrecord_t *record);
+
+// Call from `matrix_scan_user()` to run macros of keys held for their term.
+void tap_hold_macros_task(void);
+
+// Time a key must be held to run its macro.
+uint16_t tap_hold_macro_term(uint16_t keycode, keyrecord_t *record);
+
+// Runs the macro of a held key.
+void tap_hold_macro_hold(uint16_t macro);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,229 @@
+#include "tuning.h"
+
+#ifndef TUNING_EEPROM_OFFSET
+#    define TUNING_EEPROM_OFFSET 0
+#endif
+
+#ifndef TUNING_EEPROM_SLOTS
+#    define TUNING_EEPROM_SLOTS 8
+#endif
+
+#ifndef TUNING_EEPROM_SLOT_SIZE
+#    define TUNING_EEPROM_SLOT_SIZE sizeof(tuning_slot_t)
+#endif
+
+// Time to wait after the last change before saving, so that a series of
+// adjustments is written once.
+#ifndef TUNING_SAVE_DELAY
+#    define TUNING_SAVE_DELAY 5000
+#endif
+
+// Defaults can be overridden in config.h, for example with a header written by
+// tools/sweep_tuning.py.
+#ifndef TUNING_DEFAULT_TAPPING_TERM
+#    define TUNING_DEFAULT_TAPPING_TERM TAPPING_TERM
+#endif
+#ifndef TUNING_DEFAULT_INDEX_TAP_TERM_DIFF
+#    define TUNING_DEFAULT_INDEX_TAP_TERM_DIFF 25
+#endif
+#ifndef TUNING_DEFAULT_RING_PINKY_TAP_TERM_DIFF
+#    define TUNING_DEFAULT_RING_PINKY_TAP_TERM_DIFF 15
+#endif
+#ifndef TUNING_DEFAULT_SPACE_TAP_TERM_DIFF
+#    define TUNING_DEFAULT_SPACE_TAP_TERM_DIFF 25
+#endif
+#ifndef TUNING_DEFAULT_ACHORDION_TIMEOUT_DIFF
+#    define TUNING_DEFAULT_ACHORDION_TIMEOUT_DIFF 100
+#endif
+#ifndef TUNING_DEFAULT_STREAK_TIMEOUT
+#    define TUNING_DEFAULT_STREAK_TIMEOUT 100
+#endif
+#ifndef TUNING_DEFAULT_SPACE_STREAK_TIMEOUT
+#    define TUNING_DEFAULT_SPACE_STREAK_TIMEOUT 50
+#endif
+#ifndef TUNING_DEFAULT_EAGER_MODS
+#    define TUNING_DEFAULT_EAGER_MODS (MOD_MASK_SHIFT | MOD_MASK_GUI | MOD_MASK_ALT)
+#endif
+
+// A saved copy of the parameters, laid out exactly as it is in EEPROM. Slots
+// are written in turn, the one with the newest sequence number wins.
+typedef struct __attribute__((packed)) {
+    uint8_t         version;
+    uint8_t         sequence;
+    tuning_params_t params;
+    uint8_t         crc;
+} tuning_slot_t;
+
+_Static_assert(TUNING_EEPROM_SLOT_SIZE >= sizeof(tuning_slot_t), "tuning: TUNING_EEPROM_SLOT_SIZE is too small");
+#ifdef TUNING_EEPROM_SIZE
+_Static_assert(TUNING_EEPROM_SIZE >= TUNING_EEPROM_SLOTS * TUNING_EEPROM_SLOT_SIZE, "tuning: TUNING_EEPROM_SIZE is too small");
+#endif
+
+// In flash, copied to `tuning` by load_defaults().
+static const tuning_params_t PROGMEM defaults = {
+    .tapping_term             = TUNING_DEFAULT_TAPPING_TERM,
+    .index_tap_term_diff      = TUNING_DEFAULT_INDEX_TAP_TERM_DIFF,
+    .ring_pinky_tap_term_diff = TUNING_DEFAULT_RING_PINKY_TAP_TERM_DIFF,
+    .space_tap_term_diff      = TUNING_DEFAULT_SPACE_TAP_TERM_DIFF,
+    .achordion_timeout_diff   = TUNING_DEFAULT_ACHORDION_TIMEOUT_DIFF,
+    .streak_timeout           = TUNING_DEFAULT_STREAK_TIMEOUT,
+    .space_streak_timeout     = TUNING_DEFAULT_SPACE_STREAK_TIMEOUT,
+    .eager_mods               = TUNING_DEFAULT_EAGER_MODS,
+};
+
+tuning_params_t tuning;
+
+// Last slot loaded or written, and a copy of what it holds.
+static uint8_t       current_slot = TUNING_EEPROM_SLOTS - 1;
+static tuning_slot_t saved        = {0};
+
+// Slot being written and the next byte of it to write, see `tuning_task()`.
+static tuning_slot_t pending      = {0};
+static uint8_t       pending_pos  = 0;
+static bool          save_running = false;
+
+static bool     dirty       = false;
+static uint16_t dirty_timer = 0;
+
+//------------------------------------------------------------------------------
+// Helpers
+//------------------------------------------------------------------------------
+static uint8_t crc8(const uint8_t *data, uint8_t length) {
+    uint8_t crc = 0;
+    while (length--) {
+        crc ^= *data++;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static uint8_t slot_crc(const tuning_slot_t *slot) {
+    return crc8((const uint8_t *)slot, offsetof(tuning_slot_t, crc));
+}
+
+static uint16_t slot_offset(uint8_t slot) {
+    return TUNING_EEPROM_OFFSET + slot * TUNING_EEPROM_SLOT_SIZE;
+}
+
+// Parameters that would make `get_tapping_term()` underflow are rejected.
+static bool params_valid(tuning_params_t params) {
+    return params.tapping_term > params.index_tap_term_diff;
+}
+
+static void mark_dirty(void) {
+    dirty       = true;
+    dirty_timer = timer_read();
+}
+
+static void load_defaults(void) {
+    memcpy_P(&tuning, &defaults, sizeof(tuning));
+}
+
+//------------------------------------------------------------------------------
+// EEPROM
+//------------------------------------------------------------------------------
+void tuning_init(void) {
+    load_defaults();
+
+    bool found = false;
+    for (uint8_t i = 0; i < TUNING_EEPROM_SLOTS; i++) {
+        tuning_slot_t slot;
+        eeconfig_read_user_datablock(&slot, slot_offset(i), sizeof(slot));
+        if (slot.version != TUNING_VERSION || slot.crc != slot_crc(&slot) || !params_valid(slot.params)) {
+            continue;
+        }
+        // Sequence numbers wrap around, compare them by their distance.
+        if (!found || (int8_t)(slot.sequence - saved.sequence) > 0) {
+            found        = true;
+            current_slot = i;
+            saved        = slot;
+        }
+    }
+
+    if (found) {
+        tuning = saved.params;
+        dprintf("tuning: loaded slot %u, sequence %u\n", current_slot, saved.sequence);
+    }
+}
+
+static void save_byte(uint8_t pos) {
+    eeconfig_update_user_datablock((const uint8_t *)&pending + pos, slot_offset(current_slot) + pos, 1);
+}
+
+static void start_save(void) {
+    pending.version  = TUNING_VERSION;
+    pending.sequence = saved.sequence + 1;
+    pending.params   = tuning;
+    pending.crc      = slot_crc(&pending);
+
+    // Overwrite the oldest slot. Its version byte is cleared first and written
+    // last, so that a slot is never valid while half written.
+    current_slot = (current_slot + 1) % TUNING_EEPROM_SLOTS;
+
+    const uint8_t invalid = 0;
+    eeconfig_update_user_datablock(&invalid, slot_offset(current_slot), 1);
+    pending_pos  = 1;
+    save_running = true;
+}
+
+void tuning_task(void) {
+    // Write one byte per call so that the scan loop doesn't stall.
+    if (save_running) {
+        if (pending_pos < sizeof(pending)) {
+            save_byte(pending_pos++);
+        } else {
+            save_byte(0);
+            saved        = pending;
+            save_running = false;
+            dprintf("tuning: saved slot %u, sequence %u\n", current_slot, saved.sequence);
+        }
+        return;
+    }
+
+    if (!dirty || timer_elapsed(dirty_timer) < TUNING_SAVE_DELAY) {
+        return;
+    }
+    dirty = false;
+
+    if (memcmp(&tuning, &saved.params, sizeof(tuning)) != 0 || saved.version != TUNING_VERSION) {
+        start_save();
+    }
+}
+
+//------------------------------------------------------------------------------
+// Parameter access
+//------------------------------------------------------------------------------
+uint16_t tuning_get(uint8_t param) {
+    if (param >= TUNING_PARAM_COUNT) {
+        return 0;
+    }
+    return tuning.values[param];
+}
+
+bool tuning_set(uint8_t param, uint16_t value) {
+    if (param >= TUNING_PARAM_COUNT) {
+        return false;
+    }
+
+    tuning_params_t params = tuning;
+    params.values[param]   = value;
+    if (!params_valid(params)) {
+        return false;
+    }
+
+    tuning = params;
+    mark_dirty();
+    return true;
+}
+
+void tuning_reset(void) {
+    load_defaults();
+    mark_dirty();
+}
+
+void tuning_save(void) {
+    dirty       = true;
+    dirty_timer = timer_read() - TUNING_SAVE_DELAY;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "quantum.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//------------------------------------------------------------------------------
+// Tuning parameters
+//
+// Tap-hold timings that can be changed at runtime. They live in RAM while the
+// keyboard runs, so reading them costs nothing more than reading a variable.
+//
+// Changes are saved to the user EEPROM datablock some time after the last
+// change, so that a burst of adjustments results in a single write. Saved
+// blocks carry a version and a CRC and rotate through `TUNING_EEPROM_SLOTS`
+// slots to spread EEPROM wear. At boot the newest valid slot is loaded, or the
+// defaults if there is none.
+//------------------------------------------------------------------------------
+
+// Parameter ids. Append new parameters at the end and bump
+// `TUNING_VERSION` so that older saved blocks are ignored.
+enum tuning_param {
+    TUNING_TAPPING_TERM,
+    TUNING_INDEX_TAP_TERM_DIFF,
+    TUNING_RING_PINKY_TAP_TERM_DIFF,
+    TUNING_SPACE_TAP_TERM_DIFF,
+    TUNING_ACHORDION_TIMEOUT_DIFF,
+    TUNING_STREAK_TIMEOUT,
+    TUNING_SPACE_STREAK_TIMEOUT,
+    TUNING_EAGER_MODS,
+    TUNING_PARAM_COUNT,
+};
+
+#define TUNING_VERSION 2
+
+typedef union {
+    struct {
+        // Base tapping term
+        uint16_t tapping_term;
+        // Tapping term is shorter by this much for Shift mod-taps on index
+        // fingers
+        uint16_t index_tap_term_diff;
+        // Tapping term is longer by this much for ring and pinky fingers
+        uint16_t ring_pinky_tap_term_diff;
+        // Tapping term is longer by this much for the Space layer-tap key
+        uint16_t space_tap_term_diff;
+        // Achordion timeout is the tapping term plus this much
+        uint16_t achordion_timeout_diff;
+        // Typing streak timeout
+        uint16_t streak_timeout;
+        // Typing streak timeout for the Space layer-tap key
+        uint16_t space_streak_timeout;
+        // Mod-taps with any of these mods are applied eagerly by Achordion,
+        // as an 8-bit mod mask
+        uint16_t eager_mods;
+    };
+    uint16_t values[TUNING_PARAM_COUNT];
+} tuning_params_t;
+
+_Static_assert(sizeof(tuning_params_t) == TUNING_PARAM_COUNT * sizeof(uint16_t), "tuning: every parameter must be a uint16_t");
+
+// Current parameters. Read freely, but change them with `tuning_set()` so
+// that they are saved.
+extern tuning_params_t tuning;
+
+// Loads the parameters from EEPROM. Call from `keyboard_post_init_user()`.
+void tuning_init(void);
+
+// Saves pending changes when due. Call from `matrix_scan_user()`.
+void tuning_task(void);
+
+// Returns a parameter by id, or 0 for an unknown id.
+uint16_t tuning_get(uint8_t param);
+
+// Changes a parameter by id and schedules a save. Returns false for an
+// unknown id.
+bool tuning_set(uint8_t param, uint16_t value);
+
+// Restores the default parameters and schedules a save.
+void tuning_reset(void);
+
+// Saves changed parameters at the next task call instead of waiting.
+void tuning_save(void);
+
+#ifdef __cplusplus
+}
+#endif
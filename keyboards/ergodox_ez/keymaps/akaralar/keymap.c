@@ -15,11 +15,14 @@
  */
 
 #include QMK_KEYBOARD_H
+#include "keymap.h"
 #include "version.h"
 
 // For more info about achordion, see https://getreuer.info/posts/keyboards/achordion/index.html
 #include "features/achordion.h"
 
+#include "features/accel_repeat.h"
+
 // For more info about custom shift keys, see https://getreuer.info/posts/keyboards/custom-shift-keys/index.html
 #include "features/custom_shift_keys.h"
 
@@ -28,10 +31,47 @@
 
 #include "features/custom_caps_lock.h"
 
+#include "features/debounce_per_key.h"
+
+#include "features/dynamic_macros.h"
+
+#include "features/tuning.h"
+
+#include "features/key_stats.h"
+
+#include "features/kinetic_mouse.h"
+
+#include "features/layout_permutation.h"
+
+#include "features/misfire.h"
+
+#include "features/packed_keymap.h"
+
+#include "features/position_combos.h"
+
+#include "features/shadow_keymap.h"
+
+#include "features/sim_bench.h"
+
+#include "features/smooth_scroll.h"
+
+#include "features/speculative_tap.h"
+
+#include "features/stack_watch.h"
+
+#include "features/tap_hold_macros.h"
+
+#ifdef RAW_TUNING
+#include "features/raw_tuning.h"
+#endif
+
 #ifdef CONSOLE_ENABLE
 #include "features/debug_helper.h"
 #endif
 
+// Flags of the keymap, see keymap.h
+keymap_state_t keymap_state;
+
 //------------------------------------------------------------------------------
 // Keycodes
 //------------------------------------------------------------------------------
@@ -47,6 +87,8 @@ enum C_keycodes {
     // Keycode for caps lock.
     // Regular caps lock is assigned as a macOS globe (fn) key in macOS
     CPS_LCK,
+    // Keycode for switching between the Colemak and Qwerty layouts
+    TG_QWER,
     // Macro keycodes
     // Turkish letter macros
     TC_C,
@@ -67,7 +109,21 @@ enum C_keycodes {
     M_ASTRSKS,
     M_GRAVES,
     M_CBLOCK,
-    M_CBLOCK_S
+    M_CBLOCK_S,
+    // Symbol layer keys, see `tap_hold_macros`. Tapping sends a key and
+    // holding performs one of the symbol macros above
+    SM_SLSH,
+    SM_LBRC,
+    SM_LPRN,
+    SM_LABK,
+    SM_LCBR,
+    SM_DQUO,
+    SM_QUOT,
+    SM_UNDS,
+    SM_ASTR,
+    SM_GRV,
+    SM_CBL,
+    SM_CBLS
 };
 
 // Custom modifiers in single key
@@ -77,21 +133,8 @@ enum C_keycodes {
 #define MT_A MT(MOD_LCTL, KC_A)
 #define MT_W MT(MOD_LSFT | MOD_LCTL | MOD_LGUI, KC_W)
 
-// mod-tap keys for qwerty
-#define MT_Q_E MEH_T(KC_E)
-#define MT_Q_R ALL_T(KC_R)
-#define MT_Q_U ALL_T(KC_U)
-#define MT_Q_I MEH_T(KC_I)
-#define MT_Q_O MT(MOD_RSFT | MOD_RCTL | MOD_RGUI, KC_O)
-#define MT_Q_F MT(MOD_LSFT, KC_F)
-#define MT_Q_D MT(MOD_LGUI, KC_D)
-#define MT_Q_S MT(MOD_LALT, KC_S)
-#define MT_Q_J MT(MOD_RSFT, KC_J)
-#define MT_Q_K MT(MOD_RGUI, KC_K)
-#define MT_Q_L MT(MOD_LALT, KC_L)
-#define MT_Q_QT MT(MOD_RCTL, KC_QUOTE)
-
-// mod-tap keys for colemak-dh
+// mod-tap keys for colemak-dh, qwerty moves their letters with
+// `layout_permutations`
 #define MT_C_F MEH_T(KC_F)
 #define MT_C_P ALL_T(KC_P)
 #define MT_C_L ALL_T(KC_L)
@@ -138,244 +181,132 @@ enum C_keycodes {
 
 
 //------------------------------------------------------------------------------
-// Layers and layer keycodes
+// Layouts
 //------------------------------------------------------------------------------
-enum layers {
-    COLE, // default colemak layer
-    CLET, // Only letters without modtaps for colemak
-    CTUR, // Only letters without modtaps for colemak
-    QWER, // default qwerty layer
-    QLET, // Only letters without modtaps for qwerty
-    QTUR, // Turkish letters with diacritics
-    NAVI, // navigation layer
-    MOUS, // mouse layer
-    MDIA, // media keys layer
-    NUMB, // numbers layer
-    SYMB, // code symbols layer
-    SNUM, // numbers from symbols layer
-    FUNC, // Function keys layer
+// Layouts made from the colemak layers, see `layout_permutations`
+enum layouts {
+    QWERTY,
 };
 
-// Layer switching keys
-// Layer-taps
-#define LS_NAVI LT(NAVI, KC_SPACE)
-#define LS_MOUS LT(MOUS, KC_TAB)
-#define LS_MDIA LT(MDIA, KC_ESCAPE)
-#define LS_NUMB LT(NUMB, KC_BSPC)
-#define LS_SNUM LT(SNUM, KC_3) // The tap is intercepted later to send "}"
-#define LS_FUNC LT(FUNC, KC_ENTER)
-// Momentary
-#define LS_SYMB MO(SYMB)
-// One shots
-#define LS_QTUR OSL(QTUR) // For Turkish characters layer on Qwerty
-#define LS_CTUR OSL(CTUR) // For Turkish characters layer on Colemak
-// Toggling layers where mod-taps are removed from letter keys
-#define LS_QLET TT(QLET)
-#define LS_CLET TT(CLET)
-// Toggling Colemak on / off
-#define LS_QWER TG(QWER)
-
-// Helper for "real" layer switching keys. Since a bunch of fake layer switching
-// keys are used for macros, we can't use QK_LAYER_TAP_MAX and we want to be
-// able to test against real layer switching keys when checking if a keycode is
-// a layer tap.
-#define IS_LAYER_TAP(code) ((code) == LS_NAVI \
-                            || (code) == LS_MOUS \
-                            || (code) == LS_MDIA \
-                            || (code) == LS_NUMB \
-                            || (code) == LS_SYMB \
-                            || (code) == LS_SNUM \
-                            || (code) == LS_FUNC \
-                            || (code) == LS_QLET \
-                            || (code) == LS_QTUR \
-                            || (code) == LS_QWER \
-                            || (code) == LS_CLET \
-                            || (code) == LS_CTUR)
-
-// Fake layer-tap keys. These keys are used in macros and since some of them
-// are not basic keycodes, both tap and hold action is handled in the macros,
-// which means they don't send the keycode defined here.
-// See https://getreuer.info/posts/keyboards/triggers/index.html
-// Tapping sends a key and holding performs the macro
-#define FT_SLSH LT(SYMB, KC_0)
-#define FT_LBRC LT(SYMB, KC_1)
-#define FT_LPRN LT(SYMB, KC_2)
-#define FT_LABK LT(SYMB, KC_3)
-#define FT_LCBR LT(SYMB, KC_4)
-#define FT_DQUO LT(SYMB, KC_5)
-#define FT_QUOT LT(SYMB, KC_6)
-#define FT_UNDS LT(SYMB, KC_7)
-#define FT_ASTR LT(SYMB, KC_8)
-#define FT_GRV LT(SYMB, KC_9)
-#define FT_CBL LT(SYMB, KC_A)
-#define FT_CBLS LT(SYMB, KC_B)
-
-#define IS_FAKE_LAYER_TAP(code) ((code) == FT_SLSH \
-                              || (code) == FT_LBRC \
-                              || (code) == FT_LPRN \
-                              || (code) == FT_LABK \
-                              || (code) == FT_LCBR \
-                              || (code) == FT_DQUO \
-                              || (code) == FT_QUOT \
-                              || (code) == FT_UNDS \
-                              || (code) == FT_ASTR \
-                              || (code) == FT_GRV \
-                              || (code) == FT_CBL \
-                              || (code) == FT_CBLS)
 //------------------------------------------------------------------------------
-// Custom shift keys
+// Layer state cache
 //------------------------------------------------------------------------------
-const custom_shift_key_t custom_shift_keys[] = {
-  {LS_NUMB , KC_DEL}, // Shift + LT Backspace is delete
-  {KC_BSPC , KC_DEL}, // Shift + Normal backspace is delete
+// Right hand LEDs, as bits of `layer_cache.leds`
+#define LED_1 (1 << 0)
+#define LED_2 (1 << 1)
+#define LED_3 (1 << 2)
+
+#define NO_RGB_PALETTE 0xFF
+
+// Rows of `rgb_on` and `rgb_colors` for the letter layers on Qwerty, after the
+// rows of the layers
+enum qwerty_rgb_palettes {
+    QWER_RGB = FUNC + 1,
+    QLET_RGB,
+    QTUR_RGB,
 };
 
-uint8_t NUM_CUSTOM_SHIFT_KEYS =
-    sizeof(custom_shift_keys) / sizeof(custom_shift_key_t);
-
-//------------------------------------------------------------------------------
-// Mod-tap settings
-//------------------------------------------------------------------------------
-#ifndef DYNAMIC_TAPPING_TERM_ENABLE
-#define DYNAMIC_TAPPING_TERM_INCREMENT 0
-static uint16_t g_tapping_term = TAPPING_TERM;
-#endif
-static uint16_t index_tap_term_diff = 25;
-static uint16_t ring_pinky_tap_term_diff = 15;
-
-uint16_t get_tapping_term(uint16_t keycode, keyrecord_t *record) {
-    // Give a little bit of time to the thumb space key
-    if (keycode == LS_NAVI) {
-        return g_tapping_term + 25;
-    }
-
-    // Make tapping term much shorter for shift mod tap keys
-    switch (keycode) {
-        case MT_Q_F:
-        case MT_Q_J:
-        case MT_C_T:
-        case MT_C_N:
-            return g_tapping_term - index_tap_term_diff;
-    }
+// Facts that only depend on the layer state, worked out once per layer change
+// in `layer_state_set_user` instead of on every event or scan. The tap-hold
+// callbacks keep their own, see tap_hold.c.
+typedef struct {
+    uint8_t leds;        // LEDs lit for the highest layer
+    uint8_t rgb_palette; // Row of `rgb_on` and `rgb_colors` or NO_RGB_PALETTE
+} layer_cache_t;
 
-    // Otherwise, only consider alpha keys block
-    if (record->event.key.col > 3) {
-        return g_tapping_term;
-    }
+static layer_cache_t layer_cache;
 
-    switch (record->event.key.row) {
-        // Increase tapping term for ring and pinky fingers
-        case 0 ... 2:
-        case 11 ... 13:
-            return g_tapping_term + ring_pinky_tap_term_diff;
-        default:
-            return g_tapping_term;
+static uint8_t layer_leds(uint8_t layer) {
+    switch (layer) {
+        case NAVI: return LED_1;
+        case MOUS: return LED_2;
+        case MDIA: return LED_3;
+        case NUMB: return LED_1 | LED_2;
+        case SYMB: return LED_1 | LED_3;
+        case SNUM: return LED_2 | LED_3;
+        case CLET:
+        case CTUR:
+        case FUNC: return LED_1 | LED_2 | LED_3;
+        default:   return 0;
     }
 }
 
-bool get_permissive_hold(uint16_t keycode, keyrecord_t *record) {
-    // Apply permissive hold to layer switching keys
-    if (IS_LAYER_TAP(keycode)) { return true; }
+static void layer_cache_update(layer_state_t state) {
+    const uint8_t highest = get_highest_layer(state);
 
-    switch (keycode) {
-        // Apply permissive hold to shift and cmd
-        // Qwerty shift and cmd mod-taps
-        case MT_Q_D:
-        case MT_Q_F:
-        case MT_Q_J:
-        case MT_Q_K:
-        // Colemak shift and cmd mod-taps
-        case MT_C_S:
-        case MT_C_T:
-        case MT_C_N:
-        case MT_C_E:
-            return true;
-        default:
-            return false;
-    }
-};
+    // The letter layers have an RGB palette on Qwerty only.
+    layer_cache.leds        = layer_leds(highest);
+    layer_cache.rgb_palette = highest >= NAVI && highest <= FUNC ? highest
+                            : layout_permutation_get() == QWERTY ? QWER_RGB + highest
+                            : NO_RGB_PALETTE;
+    tap_hold_layer_state_set(state);
+}
 
 //------------------------------------------------------------------------------
-// Achordion
+// Custom shift keys
 //------------------------------------------------------------------------------
-bool achordion_chord(uint16_t tap_hold_keycode,
-                     keyrecord_t *tap_hold_record,
-                     uint16_t other_keycode,
-                     keyrecord_t *other_record) {
-    // Allow same hand holds with layer switching keys
-    if (IS_LAYER_TAP(tap_hold_keycode)) {
-        return true;
-    }
+const custom_shift_key_t PROGMEM custom_shift_keys[] = {
+  {LS_NUMB , KC_DEL}, // Shift + LT Backspace is delete
+  {KC_BSPC , KC_DEL}, // Shift + Normal backspace is delete
+};
 
-    // Allow same-hand holds for thumb keys
-    if (other_record->event.key.col >= 4) {
-        return true;
-    }
+const uint8_t PROGMEM NUM_CUSTOM_SHIFT_KEYS =
+    sizeof(custom_shift_keys) / sizeof(custom_shift_key_t);
 
-    // Otherwise, follow the opposite hands rule.
-    return achordion_opposite_hands(tap_hold_record, other_record);
+//------------------------------------------------------------------------------
+// Debounce
+//------------------------------------------------------------------------------
+bool debounce_eager_key(uint8_t row, uint8_t col) {
+    // Report alpha block presses (cols 0-3) immediately, but wait for the
+    // bottom row (col 4) and the thumb cluster (col 5) to settle, as they are
+    // mostly tap-hold keys that are held for a while anyway.
+    return col < 4;
 }
 
-uint16_t achordion_timeout(uint16_t tap_hold_keycode) {
-    // Disable achordion when we are in the symbol layer.
-    if (get_highest_layer(layer_state) == SYMB) {
-        return 0;
-    }
-
-    // Disable Achordion for number layer switch keys, mainly to get
-    // around streak timeout during fast typing.
-    switch (tap_hold_keycode) {
-        case LS_NUMB:
-        case LS_SNUM:
-            return 0;
-    }
-    return g_tapping_term + 100;
+//------------------------------------------------------------------------------
+// Key statistics
+//------------------------------------------------------------------------------
+bool key_stats_tap_hold_key(uint16_t keycode) {
+    return IS_QK_MOD_TAP(keycode) || IS_LAYER_TAP(keycode);
 }
 
-bool achordion_eager_mod(uint8_t mod) {
-  switch (mod) {
-    // Eagerly apply Shift, Cmd and Alt mods.
-    case MOD_LSFT:
-    case MOD_RSFT:
-    case MOD_LGUI:
-    case MOD_RGUI:
-    case MOD_LALT:
-    case MOD_RALT:
-      return true;
-    default:
-      return false;
-  }
-};
-
-uint16_t achordion_streak_timeout(uint16_t tap_hold_keycode) {
-    // A short streak detection timeout for Space layer-tap key
-    if (tap_hold_keycode == LS_NAVI) {
-        return 50;
-    }
-
-    // Disable streak detection for Shift mod-tap keys or other layer-tap keys.
-    if (tap_hold_keycode == MT_Q_F
-        || tap_hold_keycode == MT_Q_J
-        || tap_hold_keycode == MT_C_T
-        || tap_hold_keycode == MT_C_N
-        || IS_LAYER_TAP(tap_hold_keycode)
-    ) {
-        return 0;
-    }
-
-    // A longer timeout otherwise.
-    return 100;
+//------------------------------------------------------------------------------
+// Speculative taps
+//------------------------------------------------------------------------------
+#ifdef SPECULATIVE_TAP
+bool speculative_tap_key(uint16_t keycode, keyrecord_t *record) {
+    // Speculate home row mod-taps. Not while Caps Word or case modes are on,
+    // as they change what a letter types and the speculative tap bypasses them.
+    return record->event.key.col == 2
+        && !is_caps_word_on()
+        && get_xcase_state() == XCASE_OFF;
 }
+#endif
 
-bool achordion_check_streak(uint16_t keycode, uint16_t tap_hold_keycode) {
-    // Disable check for Cmd + C and Cmd + V
-    if ((tap_hold_keycode == MT_Q_K || tap_hold_keycode == MT_C_E)
-        && (keycode == KC_V || keycode == KC_C)
-    ) {
-        return false;
+//------------------------------------------------------------------------------
+// Accelerated repeat
+//------------------------------------------------------------------------------
+#ifdef ACCEL_REPEAT
+uint16_t accel_repeat_keycode(uint16_t keycode, keyrecord_t *record) {
+    switch (keycode) {
+        case KC_LEFT:
+        case KC_RGHT:
+        case KC_UP:
+        case KC_DOWN:
+        case KC_PGUP:
+        case KC_PGDN:
+        case KC_DEL:
+            return keycode;
+        case KC_BSPC:
+            // Shift + Backspace is Delete, as in the custom shift keys
+            return (get_mods() | get_weak_mods() | get_oneshot_mods()) & MOD_MASK_SHIFT
+                 ? KC_DEL
+                 : KC_BSPC;
+        default:
+            return KC_NO;
     }
-    return true;
 }
+#endif
 
 //------------------------------------------------------------------------------
 // Caps Word
@@ -393,6 +324,7 @@ bool caps_word_press_user(uint16_t keycode) {
         case KC_BSPC:
         case KC_DEL:
         case KC_UNDS:
+        case SM_UNDS:
             // When caps lock is enabled, we stop caps word on any key other
             // than A-Z, to be re-enabled later when another A-Z key is pressed
             return !is_caps_lock_on();
@@ -406,13 +338,12 @@ bool caps_word_press_user(uint16_t keycode) {
 // Casemodes
 //------------------------------------------------------------------------------
 enum case_mode {
+    CASE_NONE,
     CASE_SNAKE,
     CASE_KEBAB,
     CASE_CAMEL,
 };
 
-static enum case_mode case_mode = -1;
-
 bool terminate_case_modes(uint16_t keycode, const keyrecord_t *record) {
     switch (keycode) {
         // Keycodes to ignore (don't disable case modes)
@@ -467,21 +398,21 @@ static bool process_casemodes_keycode(uint16_t keycode, keyrecord_t *record) {
                     del_oneshot_mods(MOD_MASK_GUI);
                     enable_xcase_with(KC_UNDS);
                     register_mods(mods);
-                    case_mode = CASE_SNAKE;
+                    keymap_state.case_mode = CASE_SNAKE;
                 } else if ((mods | oneshot_mods) & MOD_MASK_GUI) {
                     // CMD held, activate kebab case
                     unregister_mods(MOD_MASK_ALT);
                     del_oneshot_mods(MOD_MASK_ALT);
                     enable_xcase_with(KC_MINS);
                     register_mods(mods);
-                    case_mode = CASE_KEBAB;
+                    keymap_state.case_mode = CASE_KEBAB;
                 } else {
                     // No mod or other mods held, activate camel case
                     unregister_mods(MOD_MASK_SHIFT);
                     del_oneshot_mods(MOD_MASK_SHIFT);
                     enable_xcase_with(OS_LSFT);
                     register_mods(mods);
-                    case_mode = CASE_CAMEL;
+                    keymap_state.case_mode = CASE_CAMEL;
                 }
             }
             return false;
@@ -495,7 +426,7 @@ typedef struct {
     uint16_t key_to_add_diacritic;
 } turkish_diacritic_key;
 
-static const turkish_diacritic_key turkish_diacritic_keys[] = {
+static const turkish_diacritic_key PROGMEM turkish_diacritic_keys[] = {
     {KC_C, KC_C},
     {KC_B, KC_G},
     {KC_W, KC_I},
@@ -504,6 +435,12 @@ static const turkish_diacritic_key turkish_diacritic_keys[] = {
     {KC_U, KC_U},
 };
 
+static turkish_diacritic_key turkish_diacritic_key_get(uint16_t keycode) {
+    turkish_diacritic_key keys;
+    memcpy_P(&keys, &turkish_diacritic_keys[keycode - TC_C], sizeof(keys));
+    return keys;
+}
+
 static bool process_tr_letter_keycodes(uint16_t keycode, keyrecord_t *record) {
     if (keycode < TC_C || keycode > TC_U) {
         return true;
@@ -518,7 +455,7 @@ static bool process_tr_letter_keycodes(uint16_t keycode, keyrecord_t *record) {
         clear_oneshot_mods();
         clear_weak_mods();
 
-        turkish_diacritic_key keys = turkish_diacritic_keys[keycode - TC_C];
+        const turkish_diacritic_key keys = turkish_diacritic_key_get(keycode);
         tap_code16(LALT(keys.diacritic_dead_key));
 
         if (((mods | oneshot_mods | weak_mods) & MOD_MASK_SHIFT)
@@ -534,7 +471,6 @@ static bool process_tr_letter_keycodes(uint16_t keycode, keyrecord_t *record) {
     return false;
 }
 
-static bool should_swallow_esc_release = false;
 static bool process_swallowed_esc(uint16_t keycode, keyrecord_t *record) {
     switch (keycode) {
         case LS_MDIA:
@@ -549,14 +485,14 @@ static bool process_swallowed_esc(uint16_t keycode, keyrecord_t *record) {
                 ) {
                     caps_word_off();
                     disable_xcase();
-                    should_swallow_esc_release = true;
+                    keymap_state.swallow_esc_release = true;
                     return false; // skip default handling
                 }
             }
 
             // We should also swallow key release record
-            if (should_swallow_esc_release && !record->event.pressed) {
-                should_swallow_esc_release = false;
+            if (keymap_state.swallow_esc_release && !record->event.pressed) {
+                keymap_state.swallow_esc_release = false;
                 return false; // skip default handling
             }
     }
@@ -608,6 +544,12 @@ static bool process_other_keycodes(uint16_t keycode, keyrecord_t *record) {
 #endif
 
     switch (keycode) {
+        case LS_SNUM:
+            if (record->event.pressed && record->tap.count != 0) {
+                tap_code16(KC_RCBR);
+                return false;
+            }
+            return true;
         case VRSN:
             if (record->event.pressed) {
                 const char* str = QMK_KEYBOARD "/" QMK_KEYMAP " @ " QMK_VERSION;
@@ -625,6 +567,16 @@ static bool process_other_keycodes(uint16_t keycode, keyrecord_t *record) {
 
             }
             return false;
+        case TG_QWER:
+            if (record->event.pressed) {
+                layout_permutation_set(layout_permutation_get() == QWERTY
+                                       ? LAYOUT_PERMUTATION_NONE
+                                       : QWERTY);
+                // Keycodes on the letter layers changed, not the layer state
+                shadow_keymap_refresh();
+                layer_cache_update(layer_state);
+            }
+            return false;
         default:
             return true;
     }
@@ -633,6 +585,8 @@ static bool process_other_keycodes(uint16_t keycode, keyrecord_t *record) {
 };
 
 static void execute_symbol_macro(uint16_t keycode) {
+    stack_watch_mark(STACK_MARK_SYMBOL_MACRO);
+
     switch (keycode) {
         // Holding down ampersand sends markdown code block
         case M_CBLOCK:
@@ -680,183 +634,55 @@ static void execute_symbol_macro(uint16_t keycode) {
     return;
 }
 
-static bool process_tap_or_long_press_key(
-    keyrecord_t *record,
-    uint16_t tap_keycode,
-    uint16_t long_press_keycode
-) {
-    if (record->tap.count == 0) { // Key is being held.
-        if (record->event.pressed) {
-            execute_symbol_macro(long_press_keycode);
-        }
-        return false; // Skip default handling.
-    } else {
-        if (record->event.pressed) {
-            tap_code16(tap_keycode);
-        }
-        return false; // Skip default handling.
-    }
-}
-
-static bool process_macro_keycodes(uint16_t keycode, keyrecord_t *record) {
-    // We send the tap keycode for these macros prematurely in
-    // `pre_process_record_user`, so if the event is later resolved to a hold,
-    // delete the tap keycode.
-    if (record->event.pressed && record->tap.count == 0) {
-        tap_code16(KC_BACKSPACE);
-    }
-
-    // Tap-hold macros in symbol layer
-    switch (keycode) {
-        case FT_SLSH:
-            return process_tap_or_long_press_key(record, KC_SLASH, M_UPDIR);
-        case FT_LBRC:
-            return process_tap_or_long_press_key(record, KC_LBRC, M_BRACKETS);
-        case FT_LPRN:
-            return process_tap_or_long_press_key(record, KC_LPRN, M_PARENS);
-        case FT_LABK:
-            return process_tap_or_long_press_key(record, KC_LABK, M_ABRACES);
-        case FT_LCBR:
-            return process_tap_or_long_press_key(record, KC_LCBR, M_CBRACES);
-        case FT_DQUO:
-            return process_tap_or_long_press_key(record, KC_DQUO, M_DQUOTES);
-        case FT_QUOT:
-            return process_tap_or_long_press_key(record, KC_QUOT, M_QUOTES);
-        case FT_UNDS:
-            return process_tap_or_long_press_key(record, KC_UNDS, M_UNDERS);
-        case FT_ASTR:
-            return process_tap_or_long_press_key(record, KC_ASTR, M_ASTRSKS);
-        case FT_GRV:
-            return process_tap_or_long_press_key(record, KC_GRV, M_GRAVES);
-        case FT_CBL:
-            return process_tap_or_long_press_key(record, KC_AMPR, M_CBLOCK);
-        case FT_CBLS:
-            return process_tap_or_long_press_key(record, KC_HASH, M_CBLOCK_S);
-        case LS_SNUM:
-            if (record->event.pressed && record->tap.count != 0) {
-                tap_code16(KC_RCBR);
-                return false;
-            }
-            return true;
-    }
-
-    return true;
-}
-
-static keyrecord_t modified_fake_lt_record;
-static bool should_ignore_next_tap = false;
-static bool did_release_symbol_layer_key = false;
-
-static bool pre_process_symbol_layer_fake_lt_keys(
-    uint16_t keycode,
-    keyrecord_t *record
-) {
-    // Only process the LT keys in the symbol layer, which are:
-    //  - Fake LT keys to trigger macros,
-    //  - Layer switching key for switching to SNUM layer.
-    if (!(IS_FAKE_LAYER_TAP(keycode) || keycode == LS_SNUM)) { return true; }
-
-    // Tap count is 0 when a record is received in `pre_process_record_user`, to
-    // trigger macro with the tap action, we copy the record and set the tap
-    // count.
-    modified_fake_lt_record = *record;
-    modified_fake_lt_record.tap.count = 1;
-
-    // Trigger the macro for the tap action with the modified record.
-    if (!process_macro_keycodes(keycode, &modified_fake_lt_record)) {
-        // If we receive a key up event immediately after the `MO` layer was
-        // released, the key was pressed when the `MO` layer was active, hence
-        // we should ignore the key up/down that QMK sends as if the `MO` layer
-        // was inactive.
-        should_ignore_next_tap = (
-            !record->event.pressed
-            && did_release_symbol_layer_key
-        );
-
-        // This flag should only be `true` immediately after releasing the `MO`
-        // layer key, so set it to false if it is true at this point as it is
-        // already processed in the expression directly above.
-        if (did_release_symbol_layer_key) {
-            did_release_symbol_layer_key = false;
-        }
-    };
-
-    return true;
-}
-
-static bool process_symbol_layer_fake_lt_keys(
-    uint16_t keycode,
-    keyrecord_t *record
-) {
-    // The modified record contains the last key pressed in the `MO` layer. If,
-    //   - the newly received record has the same key row and column,
-    //   - the newly received record is for tap,
-    //   - we decided that next tap should be ignored,
-    // we intercept this event and stop processing.
-    if (record->event.key.row == modified_fake_lt_record.event.key.row
-        && record->event.key.col == modified_fake_lt_record.event.key.col
-        && record->tap.count == 1
-        && should_ignore_next_tap
-    ) {
-        // After ignoring the key up event, we clear the variables so that they
-        // don't interfere with future processing.
-        if (!record->event.pressed) {
-            should_ignore_next_tap = false;
-            // Set the row and column to a key position that is unused.
-            modified_fake_lt_record.event.key.row = 0;
-            modified_fake_lt_record.event.key.col = 0;
-        }
-        return false;
-    }
-
-    if (IS_FAKE_LAYER_TAP(keycode) || keycode == LS_SNUM) {
-        // For fake `LT` keys that trigger macros with a tap action in the
-        // symbol layer, ignore the tap action because the tap action is alredy
-        // triggered in `pre_process_record_user`.
-        if (record->tap.count == 1) {
-            return false;
-        }
-
-        // Process the hold action and if it is handled, stop processing.
-        if (record->tap.count == 0
-            && !process_macro_keycodes(keycode, record)
-        ) {
-            return false;
-        }
-    }
+//------------------------------------------------------------------------------
+// Tap-hold macros
+//------------------------------------------------------------------------------
+const tap_hold_macro_t PROGMEM tap_hold_macros[] = {
+    {SM_SLSH, KC_SLASH, M_UPDIR},
+    {SM_LBRC, KC_LBRC , M_BRACKETS},
+    {SM_LPRN, KC_LPRN , M_PARENS},
+    {SM_LABK, KC_LABK , M_ABRACES},
+    {SM_LCBR, KC_LCBR , M_CBRACES},
+    {SM_DQUO, KC_DQUO , M_DQUOTES},
+    {SM_QUOT, KC_QUOT , M_QUOTES},
+    {SM_UNDS, KC_UNDS , M_UNDERS},
+    {SM_ASTR, KC_ASTR , M_ASTRSKS},
+    {SM_GRV , KC_GRV  , M_GRAVES},
+    {SM_CBL , KC_AMPR , M_CBLOCK},
+    {SM_CBLS, KC_HASH , M_CBLOCK_S},
+};
+const uint8_t PROGMEM NUM_TAP_HOLD_MACROS =
+    sizeof(tap_hold_macros) / sizeof(tap_hold_macro_t);
 
-    // Otherwise, continue processing as it is not a fake layer tap key. The
-    // only case that falls here is when the layer tap key for switching to the
-    // number layer from the symbol layer is held down.
-    return true;
+uint16_t tap_hold_macro_term(uint16_t keycode, keyrecord_t *record) {
+    return get_tapping_term(keycode, record);
 }
 
-static void post_process_symbol_layer_fake_lt_keys(
-    uint16_t keycode,
-    keyrecord_t *record
-) {
-    // Set this flag only when the symbol layer switch key is released.
-    did_release_symbol_layer_key = keycode == LS_SYMB && !record->event.pressed;
+void tap_hold_macro_hold(uint16_t macro) {
+    execute_symbol_macro(macro);
 }
 
 //------------------------------------------------------------------------------
 // Combos
 //------------------------------------------------------------------------------
-#ifdef COMBO_ENABLE
 enum combo_events {
-  M_CODE_BLOCK,
-  M_CODE_BLOCK_SWIFT
+    M_CODE_BLOCK,
+    M_CODE_BLOCK_SWIFT
 };
 
-const uint16_t PROGMEM code_block_combo[] = {KC_RABK, FT_GRV, COMBO_END};
-const uint16_t PROGMEM swift_code_block_combo[] = {KC_RPRN, FT_CBL, COMBO_END};
-combo_t key_combos[] = {
-  [M_CODE_BLOCK] = COMBO_ACTION(code_block_combo),
-  [M_CODE_BLOCK_SWIFT] = COMBO_ACTION(swift_code_block_combo),
+// Combos of adjacent keys on the symbol layer, by position. See the position
+// diagram above the keymap.
+const position_combo_t PROGMEM position_combos[] = {
+    // KC_RABK and SM_GRV
+    [M_CODE_BLOCK]       = POSITION_COMBO(SYMB, 40, COMBO_KEY(3, 4), COMBO_KEY(3, 5)),
+    // KC_RPRN and SM_CBL
+    [M_CODE_BLOCK_SWIFT] = POSITION_COMBO(SYMB, 40, COMBO_KEY(2, 4), COMBO_KEY(2, 5)),
 };
+const uint8_t PROGMEM NUM_POSITION_COMBOS =
+    sizeof(position_combos) / sizeof(position_combo_t);
 
-void process_combo_event(uint16_t combo_index, bool pressed) {
-    switch (combo_index) {
+void position_combo_event(uint8_t index, bool pressed) {
+    switch (index) {
         case M_CODE_BLOCK:
             if (pressed) {
                 execute_symbol_macro(M_CBLOCK);
@@ -869,89 +695,92 @@ void process_combo_event(uint16_t combo_index, bool pressed) {
             break;
     }
 }
-#endif
 //------------------------------------------------------------------------------
-// LED lights
+// Layout permutation
 //------------------------------------------------------------------------------
-static void led_state_set(layer_state_t state) {
-    ergodox_board_led_off();
-    ergodox_right_led_1_off();
-    ergodox_right_led_2_off();
-    ergodox_right_led_3_off();
+#define FROM(col, row) LAYOUT_PERMUTATION_FROM(col, row)
+#define SAME           LAYOUT_PERMUTATION_SAME
 
-    uint8_t layer = get_highest_layer(layer_state);
-    switch (layer) {
-        case NAVI: {
-            ergodox_right_led_1_on();
-            break;
-        }
-        case MOUS: {
-            ergodox_right_led_2_on();
-            break;
-        }
-        case MDIA: {
-            ergodox_right_led_3_on();
-            break;
-        }
-        case NUMB: {
-            ergodox_right_led_1_on();
-            ergodox_right_led_2_on();
-            break;
-        }
-        case SYMB: {
-            ergodox_right_led_1_on();
-            ergodox_right_led_3_on();
-            break;
-        }
-        case SNUM: {
-            ergodox_right_led_2_on();
-            ergodox_right_led_3_on();
-            break;
-        }
-        case CLET:
-        case QLET:
-        case CTUR:
-        case QTUR:
-        case FUNC: {
-            ergodox_right_led_1_on();
-            ergodox_right_led_2_on();
-            ergodox_right_led_3_on();
-            break;
-        }
-        default:
-            break;
-    }
+// clang-format off
+
+// Qwerty on the colemak layers: each moved key takes the letter of the key at
+// `FROM`, by position. See the position diagram above the keymap.
+const uint8_t PROGMEM layout_permutations[][MATRIX_ROWS][MATRIX_COLS] = {
+    [QWERTY] = LAYOUT_ergodox(
+        SAME      , SAME      , SAME      , SAME      , SAME      , SAME      , SAME,
+        SAME      , SAME      , SAME      , FROM(2,10), FROM(2,2) , FROM(2,4) , SAME,
+        SAME      , SAME      , FROM(2,3) , FROM(3,4) , FROM(1,3) , SAME,
+        SAME      , SAME      , SAME      , SAME      , FROM(3,5) , FROM(1,5) , SAME,
+        SAME      , SAME      , SAME      , SAME      , SAME,
+                                                                    SAME      , SAME,
+                                                                                SAME,
+                                                        SAME      , SAME      , SAME,
+
+        SAME      , SAME      , SAME      , SAME      , SAME      , SAME      , SAME,
+        SAME      , FROM(1,11), FROM(1,10), FROM(2,11), FROM(2,12), FROM(1,4) , SAME,
+                    FROM(3,9) , FROM(1,8) , FROM(3,8) , FROM(1,9) , FROM(1,12), SAME,
+        SAME      , FROM(2,9) , FROM(2,8) , SAME      , SAME      , SAME      , SAME,
+                                SAME      , SAME      , SAME      , SAME      , SAME,
+        SAME      , SAME,
+        SAME,
+        SAME      , SAME      , SAME
+    ),
+};
+
+// clang-format on
+
+const uint8_t PROGMEM NUM_LAYOUT_PERMUTATIONS =
+    sizeof(layout_permutations) / sizeof(layout_permutations[0]);
+
+bool layout_permutation_layer(uint8_t layer) {
+    // The letter layers, their other keys stay where they are on both layouts
+    return layer == COLE || layer == CLET || layer == CTUR;
+}
+
+//------------------------------------------------------------------------------
+// LED lights
+//------------------------------------------------------------------------------
+static void led_state_set(void) {
+    uint8_t leds = layer_cache.leds;
 
     // Fix LED lights behaviour for Caps Lock and Caps Word
     // led_t led_state = host_keyboard_led_state();
     if (is_caps_lock_on()) {
-        ergodox_right_led_3_on();
+        leds |= LED_3;
     } else if (is_caps_word_on()) {
-        ergodox_right_led_2_on();
+        leds |= LED_2;
     }
 
     // Fix LED lights behaviour for case modes
     if (get_xcase_state() != XCASE_OFF) {
-        switch (case_mode) {
+        switch (keymap_state.case_mode) {
             case CASE_CAMEL:
-                ergodox_right_led_1_on();
+                leds |= LED_1;
                 break;
             case CASE_SNAKE:
-                ergodox_right_led_2_on();
+                leds |= LED_2;
                 break;
             case CASE_KEBAB:
-                ergodox_right_led_3_on();
+                leds |= LED_3;
                 break;
             default:
                 break;
         }
     }
+
+    // Written on every scan, even when unchanged: the keyboard code sets the
+    // same LEDs in layer_state_set_kb() and led_update_kb(), after the _user
+    // hooks, so a write skipped here would leave its state showing.
+    ergodox_board_led_off();
+    if (leds & LED_1) { ergodox_right_led_1_on(); } else { ergodox_right_led_1_off(); }
+    if (leds & LED_2) { ergodox_right_led_2_on(); } else { ergodox_right_led_2_off(); }
+    if (leds & LED_3) { ergodox_right_led_3_on(); } else { ergodox_right_led_3_off(); }
 };
 
 // Fix LED lights behaviour for when other things affect LEDs (like Caps Lock &
 // Caps Word and case modes)
 void fix_leds_task(void) {
-    led_state_set(layer_state);
+    led_state_set();
 };
 
 //------------------------------------------------------------------------------
@@ -961,27 +790,65 @@ void keyboard_post_init_user(void) {
 #if CONSOLE_ENABLE
     enable_debug_user();
 #endif
+    dynamic_macros_init();
+    position_combos_init();
+    shadow_keymap_update(layer_state | default_layer_state);
+    layer_cache_update(layer_state);
+    tuning_init();
 };
 
 void matrix_scan_user() {
     achordion_task();
+    dynamic_macros_task();
+    position_combos_task();
+    tap_hold_macros_task();
+#ifdef ACCEL_REPEAT
+    accel_repeat_task();
+#endif
+#ifdef KINETIC_MOUSE
+    kinetic_mouse_task();
+#endif
+#ifdef SMOOTH_SCROLL
+    smooth_scroll_task();
+#endif
+    tuning_task();
     fix_leds_task();
 };
 
 bool pre_process_record_user(uint16_t keycode, keyrecord_t *record) {
-    if (!pre_process_symbol_layer_fake_lt_keys(keycode, record)) {
+    // Combos come first, held back keys are processed when they are replayed.
+    if (!process_position_combos(keycode, record)) {
         return false;
     }
 
+    pre_process_speculative_tap(keycode, record);
+
     return true;
 }
 
-bool process_record_user(uint16_t keycode, keyrecord_t *record) {
-    // First process the symbol layer fake lt keys as they might be ignored.
-    if (!process_symbol_layer_fake_lt_keys(keycode, record)) { return false; }
+static bool process_record_features(uint16_t keycode, keyrecord_t *record) {
+    // Pass the keycode and record to achordion for tap-hold decision. Played
+    // back macro events were already settled when they were recorded.
+    if (!is_dynamic_macro_playing() && !process_achordion(keycode, record)) {
+        return false;
+    }
+
+    // Count keys and watch for misfires once tap-hold keys are settled, but
+    // leave out played back keys.
+    if (!is_dynamic_macro_playing()) {
+        process_key_stats(keycode, record);
+        process_misfire(keycode, record);
+    }
+
+    // Record dynamic macros after tap-hold keys are settled
+    if (!process_dynamic_macros(keycode, record)) { return false; }
+
+    // Drop taps that were typed speculatively, or retract them for holds.
+    if (!process_speculative_tap(keycode, record)) { return false; }
 
-    // Pass the keycode and record to achordion for tap-hold decision
-    if (!process_achordion(keycode, record)) { return false; }
+    // Decide symbol layer tap-hold macro keys. An undecided one is tapped
+    // before any other press goes on.
+    if (!process_tap_hold_macros(keycode, record)) { return false; }
 
 #ifdef CONSOLE_ENABLE
     prefixed_print(keycode, record, "process_record_user");
@@ -995,6 +862,22 @@ bool process_record_user(uint16_t keycode, keyrecord_t *record) {
     // Pass the keycode and record to custom caps lock
     if (!process_custom_caps_lock(keycode, record)) { return false; }
 
+#ifdef KINETIC_MOUSE
+    // Move the cursor for the mouse cursor keys instead of QMK's mouse keys.
+    if (!process_kinetic_mouse(keycode, record)) { return false; }
+#endif
+
+#ifdef SMOOTH_SCROLL
+    // Scroll in fractions of a detent for the mouse wheel keys.
+    if (!process_smooth_scroll(keycode, record)) { return false; }
+#endif
+
+#ifdef ACCEL_REPEAT
+    // Repeat held navigation keys from the firmware. Comes before custom shift
+    // keys, which would otherwise hold Delete down for the host to repeat.
+    if (!process_accel_repeat(keycode, record)) { return false; }
+#endif
+
     // Pass the keycode and record to custom shift keys
     if (!process_custom_shift_keys(keycode, record)) { return false; }
 
@@ -1007,15 +890,32 @@ bool process_record_user(uint16_t keycode, keyrecord_t *record) {
     return true;
 };
 
-void post_process_record_user(uint16_t keycode, keyrecord_t *record) {
-    post_process_symbol_layer_fake_lt_keys(keycode, record);
+bool process_record_user(uint16_t keycode, keyrecord_t *record) {
+    SIM_BENCH_MARK(SIM_BENCH_RECORD);
+    stack_watch_mark(STACK_MARK_RECORD_USER);
+    const bool result = process_record_features(keycode, record);
+    SIM_BENCH_MARK(SIM_BENCH_RECORD_END);
+    return result;
 }
 
 layer_state_t layer_state_set_user(layer_state_t state) {
-    led_state_set(state);
+    shadow_keymap_update(state | default_layer_state);
+    layer_cache_update(state);
+    led_state_set();
     return state;
 };
 
+layer_state_t default_layer_state_set_user(layer_state_t state) {
+    shadow_keymap_update(layer_state | state);
+    return state;
+};
+
+#ifdef RAW_TUNING
+void raw_hid_receive(uint8_t *data, uint8_t length) {
+    process_raw_tuning(data, length);
+}
+#endif
+
 //------------------------------------------------------------------------------
 // Add empty functions for Magic Keycodes to save some space
 // see https://docs.qmk.fm/#/squeezing_avr?id=magic-functions
@@ -1080,7 +980,7 @@ const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
         _______, MT_A   , MT_C_R , MT_C_S , MT_C_T , KC_G   ,
         _______, KC_Z   , KC_X   , KC_C   , KC_D   , KC_V   , _______,
         _______, _______, _______, _______, LS_MDIA,
-                                                     _______, LS_QWER,
+                                                     _______, TG_QWER,
                                                               CM_TOGL,
                                             LS_NAVI, LS_MOUS, OS_LSFT,
 
@@ -1134,66 +1034,6 @@ const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
         XXXXXXX, _______, _______
     ),
 
-    [QWER] = LAYOUT_ergodox(
-        _______, _______, _______, _______, _______, _______, _______,
-        _______, KC_Q   , MT_W   , MT_Q_E , MT_Q_R , KC_T   , _______,
-        _______, MT_A   , MT_Q_S , MT_Q_D , MT_Q_F , KC_G   ,
-        _______, KC_Z   , KC_X   , KC_C   , KC_V   , KC_B   , _______,
-        _______, _______, _______, _______, LS_MDIA,
-                                                     _______, _______,
-                                                              CM_TOGL,
-                                            LS_NAVI, LS_MOUS, OS_LSFT,
-
-        _______, _______, _______, _______, _______, _______, _______,
-        _______, KC_Y   , MT_Q_U , MT_Q_I , MT_Q_O , KC_P   , _______,
-                 KC_H   , MT_Q_J , MT_Q_K , MT_Q_L , MT_Q_QT, _______,
-        _______, KC_N   , KC_M   , KC_COMM, KC_DOT , KC_SLSH, _______,
-                          LS_SYMB, _______, _______, _______, _______,
-        LS_QLET, _______,
-        KC_FN  ,
-        LS_QTUR, LS_FUNC, LS_NUMB
-    ),
-
-    [QLET] = LAYOUT_ergodox(
-        _______, _______, _______, _______, _______, _______, _______,
-        _______, _______, KC_W   , KC_E   , KC_R   , _______, _______,
-        _______, KC_A   , KC_S   , KC_D   , KC_F   , _______,
-        _______, _______, _______, _______, _______, _______, _______,
-        _______, _______, _______, _______, _______,
-                                                     _______, _______,
-                                                              _______,
-                                            _______, _______, _______,
-
-        _______, _______, _______, _______, _______, _______, _______,
-        _______, _______, KC_U   , KC_I   , KC_O   , _______, _______,
-                 _______, KC_J   , KC_K   , KC_L   , KC_QUOT, _______,
-        _______, _______, _______, _______, _______, _______, _______,
-                          _______, _______, _______, _______, _______,
-        _______, _______,
-        _______,
-        _______, _______, _______
-    ),
-
-    [QTUR] = LAYOUT_ergodox(
-        _______, _______, _______, _______, _______, _______, _______,
-        _______, _______, _______, _______, _______, _______, _______,
-        _______, _______, TC_S   , _______, _______, TC_G   ,
-        _______, _______, _______, TC_C   , _______, _______, _______,
-        _______, _______, _______, _______, _______,
-                                                     _______, _______,
-                                                              _______,
-                                            _______, _______, _______,
-
-        _______, _______, _______, _______, _______, _______, _______,
-        _______, _______, TC_U   , TC_I   , TC_O   , _______, _______,
-                 _______, _______, _______, _______, _______, _______,
-        _______, _______, _______, _______, _______, _______, _______,
-                          _______, _______, _______, _______, _______,
-        _______, _______,
-        _______,
-        XXXXXXX, _______, _______
-    ),
-
     [NAVI] = LAYOUT_ergodox(
         _______, _______, _______, _______, _______, _______, _______,
         _______, XXXXXXX, KC_CSG , KC_MEH , KC_HYPR, XXXXXXX, _______,
@@ -1276,18 +1116,18 @@ const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
 
     [SYMB] = LAYOUT_ergodox(
         _______, _______, _______, _______, _______, _______, _______,
-        _______, KC_TILD, KC_PLUS, FT_LBRC, KC_RBRC, FT_CBLS, _______,
-        _______, FT_UNDS, FT_SLSH, FT_LPRN, KC_RPRN, FT_CBL ,
-        _______, KC_DLR , KC_QUES, FT_LABK, KC_RABK, FT_GRV , _______,
+        _______, KC_TILD, KC_PLUS, SM_LBRC, KC_RBRC, SM_CBLS, _______,
+        _______, SM_UNDS, SM_SLSH, SM_LPRN, KC_RPRN, SM_CBL ,
+        _______, KC_DLR , KC_QUES, SM_LABK, KC_RABK, SM_GRV , _______,
         _______, _______, _______, _______, KC_AT  ,
                                                      _______, _______,
                                                               _______,
                                             _______, KC_DOT , _______,
 
         _______, _______, _______, _______, _______, _______, _______,
-        _______, KC_CIRC, KC_BSLS, FT_DQUO, FT_ASTR, KC_PERC, _______,
-                 KC_PIPE, LS_SNUM, FT_LCBR, KC_COLN, KC_COMM, _______,
-        _______, FT_QUOT, KC_EQL , KC_MINS, KC_EXLM, KC_SCLN, _______,
+        _______, KC_CIRC, KC_BSLS, SM_DQUO, SM_ASTR, KC_PERC, _______,
+                 KC_PIPE, LS_SNUM, SM_LCBR, KC_COLN, KC_COMM, _______,
+        _______, SM_QUOT, KC_EQL , KC_MINS, KC_EXLM, KC_SCLN, _______,
                           XXXXXXX, _______, _______, _______, _______,
         _______, _______,
         _______,
@@ -1337,6 +1177,9 @@ const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
 
 // clang-format on
 
+// `keymaps` packed without its transparent keys, read in its place.
+#include "keymap_packed.h"
+
 //------------------------------------------------------------------------------
 // RGB Matrix
 //------------------------------------------------------------------------------
@@ -1366,21 +1209,21 @@ const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
 
 
 const bool PROGMEM rgb_on[][RGB_MATRIX_LED_COUNT] = {
-    [QWER] = LED_LAYOUT_ergodox_pretty(
+    [QWER_RGB] = LED_LAYOUT_ergodox_pretty(
         false, false, false, false, false,    false, false, false, false, false,
         true , true , true , true , true ,    true , true , true , true , true ,
         true , true , true , true , true ,    true , true , true , true , true ,
         true , true , true , true , true ,    true , true , true , true , true ,
         false, false, false, true ,                  true , false, false, false
     ),
-    [QLET] = LED_LAYOUT_ergodox_pretty(
+    [QLET_RGB] = LED_LAYOUT_ergodox_pretty(
         false, false, false, false, false,    false, false, false, false, false,
         false, true , true , true , false,    false, true , true , true , false,
         true , true , true , true , false,    false, true , true , true , true ,
         false, false, false, false, false,    false, false, false, false, false,
         false, false, false, false ,                false , false, false, false
     ),
-    [QTUR] = LED_LAYOUT_ergodox_pretty(
+    [QTUR_RGB] = LED_LAYOUT_ergodox_pretty(
         false, false, false, false, false,    false, false, false, false, false,
         false, false, false, false, false,    false, true , true , true , false,
         false, true , false, false, true ,    false, false, false, false, false,
@@ -1461,9 +1304,9 @@ const bool PROGMEM rgb_on[][RGB_MATRIX_LED_COUNT] = {
 };
 
 const uint8_t PROGMEM rgb_colors[][3] = {
-    [QWER] = {8, 255, 255},
-    [QLET] = {8, 255, 255},
-    [QTUR] = {8, 255, 255},
+    [QWER_RGB] = {8, 255, 255},
+    [QLET_RGB] = {8, 255, 255},
+    [QTUR_RGB] = {8, 255, 255},
     [COLE] = {8, 255, 255},
     [CLET] = {8, 255, 255},
     [CTUR] = {8, 255, 255},
@@ -1502,15 +1345,10 @@ bool rgb_matrix_indicators_user(void) {
     if (keyboard_config.disable_layer_led) {
         return false;
     }
-    switch (biton32(layer_state)) {
-        case QWER ... FUNC:
-            set_layer_rgb_colors(biton32(layer_state));
-            break;
-        default:
-            if (rgb_matrix_get_flags() == LED_FLAG_NONE) {
-                rgb_matrix_set_color_all(0, 0, 0);
-            }
-            break;
+    if (layer_cache.rgb_palette != NO_RGB_PALETTE) {
+        set_layer_rgb_colors(layer_cache.rgb_palette);
+    } else if (rgb_matrix_get_flags() == LED_FLAG_NONE) {
+        rgb_matrix_set_color_all(0, 0, 0);
     }
 
     return false;
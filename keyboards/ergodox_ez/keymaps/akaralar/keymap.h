@@ -0,0 +1,94 @@
+/* Copyright 2022 Ahmet Karalar (@akaralar)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include QMK_KEYBOARD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Definitions shared by keymap.c and tap_hold.c. The tap-hold callbacks live in
+// tap_hold.c so that tools/host can build them with features/achordion.c, for
+// the tap-hold model in tools/tap_hold_model.py.
+
+//------------------------------------------------------------------------------
+// Layers and layer keycodes
+//------------------------------------------------------------------------------
+enum layers {
+    COLE, // default colemak layer
+    CLET, // Only letters without modtaps for colemak
+    CTUR, // Turkish letters with diacritics for colemak
+    NAVI, // navigation layer
+    MOUS, // mouse layer
+    MDIA, // media keys layer
+    NUMB, // numbers layer
+    SYMB, // code symbols layer
+    SNUM, // numbers from symbols layer
+    FUNC, // Function keys layer
+};
+
+// Layer switching keys
+// Layer-taps
+#define LS_NAVI LT(NAVI, KC_SPACE)
+#define LS_MOUS LT(MOUS, KC_TAB)
+#define LS_MDIA LT(MDIA, KC_ESCAPE)
+#define LS_NUMB LT(NUMB, KC_BSPC)
+#define LS_SNUM LT(SNUM, KC_3) // The tap is intercepted later to send "}"
+#define LS_FUNC LT(FUNC, KC_ENTER)
+// Momentary
+#define LS_SYMB MO(SYMB)
+// One shots
+#define LS_CTUR OSL(CTUR) // For Turkish characters layer
+// Toggling layers where mod-taps are removed from letter keys
+#define LS_CLET TT(CLET)
+
+// Helper for layer switching keys, to test against all of them when checking if
+// a keycode is a layer tap, not only the `LT` ones.
+#define IS_LAYER_TAP(code) ((code) == LS_NAVI \
+                            || (code) == LS_MOUS \
+                            || (code) == LS_MDIA \
+                            || (code) == LS_NUMB \
+                            || (code) == LS_SYMB \
+                            || (code) == LS_SNUM \
+                            || (code) == LS_FUNC \
+                            || (code) == LS_CLET \
+                            || (code) == LS_CTUR)
+
+//------------------------------------------------------------------------------
+// Keymap state
+//------------------------------------------------------------------------------
+// Flags of keymap.c and tap_hold.c, packed into one byte. All of them start
+// out as 0.
+typedef struct {
+    uint8_t case_mode           : 2; // Case mode last enabled by CM_TOGL
+    bool    swallow_esc_release : 1; // Esc press ended caps word or case modes
+    bool    achordion_off       : 1; // Achordion is off on the current layers
+} keymap_state_t;
+
+extern keymap_state_t keymap_state;
+
+//------------------------------------------------------------------------------
+// Tap-hold callbacks, see tap_hold.c
+//------------------------------------------------------------------------------
+// Updates what the callbacks derive from the layer state. Call on every layer
+// change.
+void tap_hold_layer_state_set(layer_state_t state);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,277 @@
+/* Copyright 2026 Ahmet Karalar (@akaralar)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include QMK_KEYBOARD_H
+#include "matrix.h"
+#include "i2c_master.h"
+#include "ergodox_matrix.h"
+#include "features/sim_bench.h"
+
+// The ErgoDox EZ uses the "lite" custom matrix, so QMK still owns debouncing
+// and the cooked matrix. We only fill in the raw matrix here.
+//
+// Left half (rows 0-6): MCP23018, rows on GPIOA (active low), columns on GPIOB
+// with pull-ups.
+// Right half (rows 7-13): rows on B0-B3, D2, D3, C6, columns on F0, F1, F4-F7
+// with pull-ups.
+//
+// Compared to the stock scanner, selecting a left-hand row writes the whole
+// GPIOA port, which also deselects the previous row. That drops the separate
+// "unselect" transaction the stock scanner sends after every row, so a left
+// row costs one register write and one register read.
+
+#define ROWS_PER_HAND (MATRIX_ROWS / 2)
+
+#ifndef MCP23018_I2C_ADDR
+#    define MCP23018_I2C_ADDR (0b0100000 << 1)
+#endif
+
+// MCP23018 registers with IOCON.BANK = 0 (power-on default).
+#define MCP_IODIRA 0x00
+#define MCP_GPPUA 0x0C
+#define MCP_GPIOA 0x12
+#define MCP_GPIOB 0x13
+
+// I2C timeout for a single transaction during scanning. A transaction takes
+// well under a millisecond at 400 kHz, so anything longer means the left half
+// is gone. The stock scanner waits 100 ms per transaction instead.
+#ifndef MATRIX_I2C_TIMEOUT
+#    define MATRIX_I2C_TIMEOUT 3
+#endif
+
+// Backoff for reconnecting the left half, doubled after every failed attempt.
+#ifndef MATRIX_I2C_RETRY_MIN
+#    define MATRIX_I2C_RETRY_MIN 32
+#endif
+#ifndef MATRIX_I2C_RETRY_MAX
+#    define MATRIX_I2C_RETRY_MAX 2048
+#endif
+
+static bool     left_connected  = false;
+static uint16_t retry_timer     = 0;
+static uint16_t retry_interval  = MATRIX_I2C_RETRY_MIN;
+static uint16_t i2c_error_count = 0;
+static uint16_t scan_count      = 0;
+static uint16_t scan_rate       = 0;
+static uint16_t scan_rate_timer = 0;
+
+#ifdef SIM_BENCH
+// Kept under its name with LTO, the simulator looks it up in the ELF file.
+__attribute__((used, externally_visible)) volatile matrix_row_t sim_bench_matrix[MATRIX_ROWS];
+#endif
+
+//------------------------------------------------------------------------------
+// Left half (MCP23018)
+//------------------------------------------------------------------------------
+static bool mcp_write(uint8_t reg, uint8_t *data, uint16_t length) {
+    return i2c_write_register(MCP23018_I2C_ADDR, reg, data, length, MATRIX_I2C_TIMEOUT) == I2C_STATUS_SUCCESS;
+}
+
+static bool mcp_read(uint8_t reg, uint8_t *data, uint16_t length) {
+    return i2c_read_register(MCP23018_I2C_ADDR, reg, data, length, MATRIX_I2C_TIMEOUT) == I2C_STATUS_SUCCESS;
+}
+
+static bool left_init(void) {
+    // Rows are outputs, columns are inputs. Both port A and port B registers
+    // are adjacent, so each pair is written in a single burst.
+    uint8_t iodir[2] = {0b00000000, 0b00111111};
+    uint8_t gppu[2]  = {0b00000000, 0b00111111};
+    uint8_t idle     = 0xFF;
+
+    return mcp_write(MCP_IODIRA, iodir, sizeof(iodir))
+        && mcp_write(MCP_GPPUA, gppu, sizeof(gppu))
+        && mcp_write(MCP_GPIOA, &idle, 1);
+}
+
+static void left_disconnect(void) {
+    if (i2c_error_count < UINT16_MAX) {
+        i2c_error_count++;
+    }
+    left_connected  = false;
+    mcp23018_status = I2C_STATUS_ERROR;
+    retry_timer     = timer_read();
+    dprintln("matrix: left half not responding");
+}
+
+static void left_reconnect_task(void) {
+    if (timer_elapsed(retry_timer) < retry_interval) {
+        return;
+    }
+
+    if (left_init()) {
+        left_connected  = true;
+        mcp23018_status = I2C_STATUS_SUCCESS;
+        retry_interval  = MATRIX_I2C_RETRY_MIN;
+        dprintln("matrix: left half attached");
+    } else {
+        retry_timer = timer_read();
+        if (retry_interval < MATRIX_I2C_RETRY_MAX) {
+            retry_interval <<= 1;
+        }
+    }
+}
+
+static bool left_select_row(uint8_t row) {
+    uint8_t data = (uint8_t)~(1 << row);
+    return mcp_write(MCP_GPIOA, &data, 1);
+}
+
+static bool left_read_cols(matrix_row_t *cols) {
+    uint8_t data = 0xFF;
+    if (!mcp_read(MCP_GPIOB, &data, 1)) {
+        return false;
+    }
+    *cols = ~data & 0b00111111;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Right half (ATmega32U4)
+//------------------------------------------------------------------------------
+static void right_init(void) {
+    // Columns: input with pull-up (DDR:0, PORT:1).
+    DDRF &= ~(1 << 7 | 1 << 6 | 1 << 5 | 1 << 4 | 1 << 1 | 1 << 0);
+    PORTF |= (1 << 7 | 1 << 6 | 1 << 5 | 1 << 4 | 1 << 1 | 1 << 0);
+}
+
+static void right_unselect_rows(void) {
+    // Hi-Z (DDR:0, PORT:0).
+    DDRB &= ~(1 << 0 | 1 << 1 | 1 << 2 | 1 << 3);
+    PORTB &= ~(1 << 0 | 1 << 1 | 1 << 2 | 1 << 3);
+    DDRD &= ~(1 << 2 | 1 << 3);
+    PORTD &= ~(1 << 2 | 1 << 3);
+    DDRC &= ~(1 << 6);
+    PORTC &= ~(1 << 6);
+}
+
+static void right_select_row(uint8_t row) {
+    // Output low (DDR:1, PORT:0).
+    switch (row) {
+        case 0: DDRB |= (1 << 0); PORTB &= ~(1 << 0); break;
+        case 1: DDRB |= (1 << 1); PORTB &= ~(1 << 1); break;
+        case 2: DDRB |= (1 << 2); PORTB &= ~(1 << 2); break;
+        case 3: DDRB |= (1 << 3); PORTB &= ~(1 << 3); break;
+        case 4: DDRD |= (1 << 2); PORTD &= ~(1 << 2); break;
+        case 5: DDRD |= (1 << 3); PORTD &= ~(1 << 3); break;
+        case 6: DDRC |= (1 << 6); PORTC &= ~(1 << 6); break;
+    }
+}
+
+static matrix_row_t right_read_cols(void) {
+    // The whole column port is read at once. Columns live on F0, F1 and F4-F7,
+    // so squeeze them into the lower six bits.
+    const uint8_t pins = PINF;
+    return ~((pins & 0x03) | ((pins & 0xF0) >> 2)) & 0b00111111;
+}
+
+//------------------------------------------------------------------------------
+// Scan rate
+//------------------------------------------------------------------------------
+static void scan_rate_task(void) {
+    scan_count++;
+    if (timer_elapsed(scan_rate_timer) >= 1000) {
+        scan_rate       = scan_count;
+        scan_count      = 0;
+        scan_rate_timer = timer_read();
+        if (debug_matrix) {
+            dprintf("matrix: %u scans/s, %u i2c errors\n", scan_rate, i2c_error_count);
+        }
+    }
+}
+
+uint16_t ergodox_matrix_scan_rate(void) { return scan_rate; }
+
+uint16_t ergodox_matrix_i2c_errors(void) { return i2c_error_count; }
+
+bool ergodox_matrix_left_connected(void) { return left_connected; }
+
+//------------------------------------------------------------------------------
+// Custom matrix
+//------------------------------------------------------------------------------
+void matrix_init_custom(void) {
+#ifdef SIM_BENCH
+    // Nothing answers on I2C in the simulator.
+    scan_rate_timer = timer_read();
+    return;
+#endif
+    i2c_init();
+    right_init();
+    right_unselect_rows();
+
+    left_connected  = left_init();
+    mcp23018_status = left_connected ? I2C_STATUS_SUCCESS : I2C_STATUS_ERROR;
+    retry_timer     = timer_read();
+    scan_rate_timer = timer_read();
+}
+
+bool matrix_scan_custom(matrix_row_t current_matrix[]) {
+    bool changed = false;
+
+#ifdef SIM_BENCH
+    SIM_BENCH_MARK(SIM_BENCH_SCAN);
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        if (current_matrix[row] != sim_bench_matrix[row]) {
+            current_matrix[row] = sim_bench_matrix[row];
+            changed             = true;
+        }
+    }
+    scan_rate_task();
+    return changed;
+#endif
+
+    if (!left_connected) {
+        left_reconnect_task();
+    }
+
+    for (uint8_t i = 0; i < ROWS_PER_HAND; i++) {
+        const uint8_t left_row  = i;
+        const uint8_t right_row = i + ROWS_PER_HAND;
+
+        // Select the right row first. The I2C write that selects the left row
+        // takes longer than the settle time the right row needs, so no extra
+        // delay is required before reading it. Without the left half there is
+        // no write to wait on, so wait for the row instead.
+        right_select_row(i);
+        if (left_connected && !left_select_row(i)) {
+            left_disconnect();
+        }
+        if (!left_connected) {
+            matrix_io_delay();
+        }
+
+        matrix_row_t right_cols = right_read_cols();
+        right_unselect_rows();
+
+        // The left row has been settling while the right half was read.
+        matrix_row_t left_cols = 0;
+        if (left_connected && !left_read_cols(&left_cols)) {
+            left_disconnect();
+            left_cols = 0;
+        }
+
+        if (current_matrix[left_row] != left_cols) {
+            current_matrix[left_row] = left_cols;
+            changed                  = true;
+        }
+        if (current_matrix[right_row] != right_cols) {
+            current_matrix[right_row] = right_cols;
+            changed                   = true;
+        }
+    }
+
+    scan_rate_task();
+    return changed;
+}
@@ -4,7 +4,8 @@ CAPS_WORD_ENABLE = yes
 COMBO_ENABLE = no
 COMMAND_ENABLE = no
 CONSOLE_ENABLE = yes
-DYNAMIC_MACRO_ENABLE = yes
+DEBOUNCE_TYPE = custom
+DYNAMIC_MACRO_ENABLE = no
 DYNAMIC_TAPPING_TERM_ENABLE = no
 KEY_OVERRIDE_ENABLE = no
 LTO_ENABLE = yes
@@ -14,12 +15,65 @@ RGB_MATRIX_ENABLE = no
 UNICODE_ENABLE = no
 WEBUSB_ENABLE = no
 
+# Only for the high resolution wheel of the mouse report, together with
+# POINTING_DEVICE_HIRES_SCROLL_ENABLE in config.h, see features/smooth_scroll.h
+# POINTING_DEVICE_ENABLE = yes
+# POINTING_DEVICE_DRIVER = custom
+
 SRC = matrix.c
+SRC += tap_hold.c
+SRC += features/accel_repeat.c
 SRC += features/achordion.c
 SRC += features/casemodes.c
 SRC += features/custom_caps_lock.c
 SRC += features/custom_shift_keys.c
+SRC += features/debounce_per_key.c
 SRC += features/debug_helper.c
+SRC += features/dynamic_macros.c
+SRC += features/key_stats.c
+SRC += features/kinetic_mouse.c
+SRC += features/layout_permutation.c
+SRC += features/misfire.c
+SRC += features/packed_keymap.c
+SRC += features/position_combos.c
+SRC += features/shadow_keymap.c
+SRC += features/smooth_scroll.c
+SRC += features/speculative_tap.c
+SRC += features/stack_watch.c
+SRC += features/tap_hold_macros.c
+SRC += features/tuning.c
+
+# Live tuning over raw HID, see features/raw_tuning.h. Oryx has its own
+# raw_hid_receive(), so this build drops Oryx live training and layer sync:
+#   make ergodox_ez/glow:akaralar RAW_TUNING=yes
+ifeq ($(strip $(RAW_TUNING)), yes)
+    ORYX_ENABLE = no
+    RAW_ENABLE = yes
+    OPT_DEFS += -DRAW_TUNING
+    SRC += features/raw_tuning.c
+endif
+
+# Generate keymap_packed.h from the keymap into the build directory, see
+# features/packed_keymap.h. keymap.c includes it, so its object waits for it.
+# The rules below must not become QMK's default goal.
+KEYMAP_PACKED_DIR  := $(INTERMEDIATE_OUTPUT)/src
+KEYMAP_PACKED_H    := $(KEYMAP_PACKED_DIR)/keymap_packed.h
+KEYMAP_PACKED_GOAL := $(.DEFAULT_GOAL)
+EXTRAINCDIRS       += $(KEYMAP_PACKED_DIR)
+
+$(KEYMAP_PACKED_H): $(KEYMAP_PATH)/keymap.c $(KEYMAP_PATH)/keymap.h $(KEYMAP_PATH)/tools/pack_keymap.py $(KEYMAP_PATH)/tools/tap_hold_model.py
+	@mkdir -p $(@D)
+	python3 $(KEYMAP_PATH)/tools/pack_keymap.py --keymap $< --output $@
+
+$(INTERMEDIATE_OUTPUT)/$(patsubst %.c,%.o,$(KEYMAP_C)): $(KEYMAP_PACKED_H)
+
+.DEFAULT_GOAL := $(KEYMAP_PACKED_GOAL)
+
+# Build for the simavr benchmark instead of the keyboard, see
+# features/sim_bench.h and `make sim-bench` in the userspace Makefile.
+ifeq ($(strip $(SIM_BENCH)), yes)
+    OPT_DEFS += -DSIM_BENCH
+endif
 
 # Disable the following to save space
 SPACE_CADET_ENABLE = no
@@ -0,0 +1,182 @@
+/* Copyright 2022 Ahmet Karalar (@akaralar)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "keymap.h"
+#include "features/achordion.h"
+#include "features/misfire.h"
+#include "features/tuning.h"
+
+// Tapping term and Achordion callbacks of the keymap. tools/host builds this
+// file with features/achordion.c, see tools/host/tap_hold_host.c.
+
+void tap_hold_layer_state_set(layer_state_t state) {
+    // Achordion is off in the symbol layer.
+    keymap_state.achordion_off = get_highest_layer(state) == SYMB;
+}
+
+//------------------------------------------------------------------------------
+// Mod-tap settings
+//------------------------------------------------------------------------------
+// Timings can be changed at runtime, see features/tuning.h.
+
+// Mod-taps are told apart by their mods rather than their keycodes, which
+// Qwerty derives from the Colemak ones.
+static bool is_mod_tap_of(uint16_t keycode, uint8_t left, uint8_t right) {
+    if (!IS_QK_MOD_TAP(keycode)) {
+        return false;
+    }
+    const uint8_t mods = QK_MOD_TAP_GET_MODS(keycode);
+    return mods == left || mods == right;
+}
+
+static bool is_shift_mod_tap(uint16_t keycode) {
+    return is_mod_tap_of(keycode, MOD_LSFT, MOD_RSFT);
+}
+
+static bool is_cmd_mod_tap(uint16_t keycode) {
+    return is_mod_tap_of(keycode, MOD_LGUI, MOD_RGUI);
+}
+
+static uint16_t tapping_term(uint16_t keycode, keyrecord_t *record) {
+    // Give a little bit of time to the thumb space key
+    if (keycode == LS_NAVI) {
+        return tuning.tapping_term + tuning.space_tap_term_diff;
+    }
+
+    // Make tapping term much shorter for shift mod tap keys
+    if (is_shift_mod_tap(keycode)) {
+        return tuning.tapping_term - tuning.index_tap_term_diff;
+    }
+
+    // Otherwise, only consider alpha keys block
+    if (record->event.key.col > 3) {
+        return tuning.tapping_term;
+    }
+
+    switch (record->event.key.row) {
+        // Increase tapping term for ring and pinky fingers
+        case 0 ... 2:
+        case 11 ... 13:
+            return tuning.tapping_term + tuning.ring_pinky_tap_term_diff;
+        default:
+            return tuning.tapping_term;
+    }
+}
+
+uint16_t get_tapping_term(uint16_t keycode, keyrecord_t *record) {
+#ifdef MISFIRE_NUDGE
+    // Keys that misfired get their tapping term nudged
+    return tapping_term(keycode, record) + misfire_term_offset(record->event.key);
+#else
+    return tapping_term(keycode, record);
+#endif
+}
+
+bool get_permissive_hold(uint16_t keycode, keyrecord_t *record) {
+    // Apply permissive hold to layer switching keys
+    if (IS_LAYER_TAP(keycode)) { return true; }
+
+    // Apply permissive hold to shift and cmd
+    return is_shift_mod_tap(keycode) || is_cmd_mod_tap(keycode);
+};
+
+//------------------------------------------------------------------------------
+// Achordion
+//------------------------------------------------------------------------------
+bool achordion_chord(uint16_t tap_hold_keycode,
+                     keyrecord_t *tap_hold_record,
+                     uint16_t other_keycode,
+                     keyrecord_t *other_record) {
+    // Allow same hand holds with layer switching keys
+    if (IS_LAYER_TAP(tap_hold_keycode)) {
+        return true;
+    }
+
+    // Allow same-hand holds for thumb keys
+    if (other_record->event.key.col >= 4) {
+        return true;
+    }
+
+    // Otherwise, follow the opposite hands rule.
+    return achordion_opposite_hands(tap_hold_record, other_record);
+}
+
+uint16_t achordion_timeout(uint16_t tap_hold_keycode) {
+    // Disable achordion when we are in the symbol layer.
+    if (keymap_state.achordion_off) {
+        return 0;
+    }
+
+    // Disable Achordion for number layer switch keys, mainly to get
+    // around streak timeout during fast typing.
+    switch (tap_hold_keycode) {
+        case LS_NUMB:
+        case LS_SNUM:
+            return 0;
+    }
+    return tuning.tapping_term + tuning.achordion_timeout_diff;
+}
+
+bool achordion_eager_mods(uint16_t tap_hold_keycode, uint8_t mods) {
+    // Eagerly apply mod-taps with a mod in the tuned mask, which has Shift,
+    // Cmd and Alt by default. This covers the Hyper and Meh keys and the
+    // Shift + Ctrl + Cmd keys, so that mod + click starts right away, while
+    // Ctrl alone waits.
+    return (mods & tuning.eager_mods) != 0;
+};
+
+uint16_t achordion_streak_timeout(uint16_t tap_hold_keycode) {
+    // A short streak detection timeout for Space layer-tap key
+    if (tap_hold_keycode == LS_NAVI) {
+        return tuning.space_streak_timeout;
+    }
+
+    // Disable streak detection for Shift mod-tap keys or other layer-tap keys.
+    if (is_shift_mod_tap(tap_hold_keycode) || IS_LAYER_TAP(tap_hold_keycode)) {
+        return 0;
+    }
+
+    // A longer timeout otherwise.
+    return tuning.streak_timeout;
+}
+
+bool achordion_check_streak(uint16_t keycode, uint16_t tap_hold_keycode) {
+    // Disable check for Cmd + C and Cmd + V with the right hand cmd, on
+    // either layout.
+    if (is_mod_tap_of(tap_hold_keycode, MOD_RGUI, MOD_RGUI)
+        && (keycode == KC_V || keycode == KC_C)
+    ) {
+        return false;
+    }
+    return true;
+}
+
+void achordion_settled(uint16_t tap_hold_keycode,
+                       keyrecord_t *tap_hold_record,
+                       bool hold,
+                       uint8_t reason) {
+    // Watch for misfires of mod-tap keys and real layer-tap keys.
+    if (IS_QK_MOD_TAP(tap_hold_keycode) || IS_LAYER_TAP(tap_hold_keycode)) {
+        misfire_settled(tap_hold_keycode, tap_hold_record, hold, reason);
+    }
+}
+
+bool achordion_nested_hold(uint16_t tap_hold_keycode) {
+    // Hold shift and cmd when a key is tapped within them, so that same-hand
+    // shortcuts like Cmd + C work. Streaks still tap them, see
+    // achordion_check_streak() above.
+    return is_shift_mod_tap(tap_hold_keycode) || is_cmd_mod_tap(tap_hold_keycode);
+}
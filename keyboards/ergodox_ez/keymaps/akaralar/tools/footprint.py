@@ -0,0 +1,298 @@
+#!/usr/bin/env python3
+"""Reports the flash and RAM each part of the firmware takes, from its ELF file.
+
+Lists the bytes of each userspace module, keymap.c by section, matrix.c and
+each features/*.c file. The rest is grouped by the top directory of
+qmk_firmware it comes from (quantum, tmk_core, lib, ...):
+
+  - flash: code, PROGMEM tables and the initial values of `.data`,
+  - data, bss: RAM taken at boot, before the stack.
+
+    footprint.py .build/ergodox_ez_glow_akaralar.elf
+    footprint.py --budget footprint.budget --history footprint.history firmware.elf
+
+The firmware is built with LTO, so object files and the linker map only show
+the merged link units. Symbols are attributed by the source file and line their
+debug information points to instead, with `avr-nm --line-numbers`. Functions
+that LTO inlined count for the function they were inlined into. Symbols without
+debug information, such as libgcc and the vector table, are listed as
+"unknown". keymap.c is split at its `//---` section banners.
+
+With --history, the change since the last entry of a history file is shown,
+and the totals of each module are appended to it together with the commit.
+Builds of a tree with uncommitted changes are only compared, so that each entry
+stands for a commit.
+
+With --budget, the report fails when a module goes over its budget. Each line
+of the budget file is a module name, a shell pattern of module names or
+"total", then its flash and RAM budgets in bytes, or "-" for no budget. A
+pattern is checked against the sum of the modules it matches, so
+"features/*" is the budget of all features together.
+"""
+
+import argparse
+import collections
+import datetime
+import fnmatch
+import os
+import re
+import subprocess
+import sys
+
+# Data addresses in AVR ELF files are offset by 0x800000.
+RAM_START = 0x800000
+
+# avr-nm symbol types, lower case for local symbols.
+DATA_TYPES = "dDvV"
+BSS_TYPES = "bB"
+
+NM_LINE = re.compile(r"^([0-9a-f]+) ([0-9a-f]+) (\w) (\S+)(?:\t(.+):(\d+))?$")
+BANNER = re.compile(r"^//-{10,}$")
+BANNER_TITLE = re.compile(r"^// (\S.*)$")
+
+
+class Footprint:
+    def __init__(self):
+        self.flash = collections.Counter()
+        self.data = collections.Counter()
+        self.bss = collections.Counter()
+        self.symbols = collections.defaultdict(list)
+
+    def modules(self):
+        return self.flash.keys() | self.data.keys() | self.bss.keys()
+
+    def ram(self, module):
+        return self.data[module] + self.bss[module]
+
+    def add(self, module, name, address, size, kind):
+        if address >= RAM_START:
+            if kind in BSS_TYPES:
+                self.bss[module] += size
+            else:
+                self.data[module] += size
+                # Initial values are copied from flash at boot.
+                self.flash[module] += size
+        else:
+            self.flash[module] += size
+        self.symbols[module].append((size, name))
+
+
+class Sections:
+    """Section of keymap.c each line belongs to, from its banners."""
+
+    def __init__(self):
+        self.files = {}
+
+    def find(self, path, line):
+        if path not in self.files:
+            self.files[path] = self.read(path)
+        title = None
+        for start, name in self.files[path]:
+            if start > line:
+                break
+            title = name
+        return title
+
+    @staticmethod
+    def read(path):
+        starts = []
+        try:
+            with open(path) as f:
+                lines = f.read().splitlines()
+        except OSError:
+            return starts
+        # A banner is a title of one or more comment lines between two dashed
+        # lines.
+        for i in range(len(lines) - 2):
+            title = BANNER_TITLE.match(lines[i + 1])
+            if not BANNER.match(lines[i]) or not title:
+                continue
+            end = i + 2
+            while end < len(lines) and BANNER_TITLE.match(lines[end]):
+                end += 1
+            if end < len(lines) and BANNER.match(lines[end]):
+                starts.append((i + 1, title.group(1)))
+        return starts
+
+
+def module(path, line, sections):
+    """Name of the part of the firmware a source file and line belong to."""
+    if not path:
+        return "unknown"
+    path = os.path.normpath(path)
+    if "/keymaps/akaralar/" in path:
+        name = os.path.splitext(os.path.basename(path))[0]
+        if "/features/" in path:
+            return "features/" + name
+        if name == "keymap":
+            section = sections.find(path, line)
+            return "keymap: " + section if section else "keymap"
+        return name
+    parts = path.split(os.sep)
+    for top in ("quantum", "tmk_core", "platforms", "drivers", "lib", "keyboards"):
+        if top in parts:
+            return top
+    return "other"
+
+
+def read_footprint(elf, nm):
+    try:
+        output = subprocess.run([nm, "--print-size", "--line-numbers", elf],
+                                check=True, capture_output=True, text=True).stdout
+    except FileNotFoundError:
+        raise OSError("%s not found, is the AVR toolchain installed?" % nm)
+    except subprocess.CalledProcessError as e:
+        raise OSError(e.stderr.strip() or "%s failed" % nm)
+
+    footprint = Footprint()
+    sections = Sections()
+    for line in output.splitlines():
+        match = NM_LINE.match(line)
+        if not match:
+            continue
+        address, size, kind, name, path, number = match.groups()
+        if kind in "aAuUN":
+            continue
+        footprint.add(module(path, int(number or 0), sections), name, int(address, 16), int(size, 16), kind)
+    return footprint
+
+
+#------------------------------------------------------------------------------
+# History
+#------------------------------------------------------------------------------
+def commit():
+    try:
+        return subprocess.run(["git", "describe", "--always", "--dirty"], check=True, capture_output=True,
+                              text=True, cwd=os.path.dirname(os.path.abspath(__file__))).stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return "unknown"
+
+
+def read_history(path):
+    """Flash and RAM of each module at the last entry of the history file."""
+    last = {}
+    try:
+        with open(path) as f:
+            rows = [line.rstrip("\n").split("\t") for line in f if not line.startswith("#")]
+    except FileNotFoundError:
+        return last
+    rows = [row for row in rows if len(row) == 5]
+    if rows:
+        key = rows[-1][:2]
+        for row in rows:
+            if row[:2] == key:
+                last[row[2]] = (int(row[3]), int(row[4]))
+    return last
+
+
+def write_history(path, footprint, version):
+    date = datetime.datetime.now().strftime("%Y-%m-%dT%H:%M:%S")
+    new = not os.path.exists(path)
+    with open(path, "a") as f:
+        if new:
+            f.write("# date\tcommit\tmodule\tflash\tram\n")
+        for name in sorted(footprint.modules()):
+            f.write("%s\t%s\t%s\t%d\t%d\n" % (date, version, name, footprint.flash[name], footprint.ram(name)))
+        f.write("%s\t%s\ttotal\t%d\t%d\n" % (date, version, sum(footprint.flash.values()),
+                                             sum(footprint.data.values()) + sum(footprint.bss.values())))
+
+
+#------------------------------------------------------------------------------
+# Budget
+#------------------------------------------------------------------------------
+class BudgetError(Exception):
+    pass
+
+
+def read_budget(path):
+    budget = []
+    with open(path) as f:
+        for number, line in enumerate(f, 1):
+            # Module names of keymap.c sections have spaces.
+            fields = line.split("#")[0].rsplit(None, 2)
+            if not fields:
+                continue
+            if len(fields) != 3:
+                raise BudgetError("%s:%d: expected a module, flash and RAM" % (path, number))
+            try:
+                flash, ram = [None if value == "-" else int(value) for value in fields[1:]]
+            except ValueError:
+                raise BudgetError("%s:%d: budgets are bytes or -" % (path, number))
+            budget.append((fields[0], flash, ram))
+    return budget
+
+
+def check_budget(budget, footprint):
+    """Lines describing each budget that is exceeded."""
+    failures = []
+    for pattern, flash_budget, ram_budget in budget:
+        if pattern == "total":
+            matched = footprint.modules()
+        else:
+            matched = [name for name in footprint.modules() if fnmatch.fnmatchcase(name, pattern)]
+        flash = sum(footprint.flash[name] for name in matched)
+        ram = sum(footprint.ram(name) for name in matched)
+        if flash_budget is not None and flash > flash_budget:
+            failures.append("%s: flash %d bytes, budget %d" % (pattern, flash, flash_budget))
+        if ram_budget is not None and ram > ram_budget:
+            failures.append("%s: RAM %d bytes, budget %d" % (pattern, ram, ram_budget))
+    return failures
+
+
+#------------------------------------------------------------------------------
+# Report
+#------------------------------------------------------------------------------
+def delta(now, before):
+    return "%+6d" % (now - before) if before is not None and now != before else ""
+
+
+def print_row(name, flash, data, bss, last):
+    flash_before, ram_before = last.get(name, (None, None))
+    print("%-36s %6d %6s %6d %6d %6d %6s" % (name, flash, delta(flash, flash_before), data, bss, data + bss,
+                                            delta(data + bss, ram_before)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf", help="linked firmware")
+    parser.add_argument("--nm", default="avr-nm", help="nm of the AVR toolchain")
+    parser.add_argument("--symbols", action="store_true", help="also list the symbols of each module")
+    parser.add_argument("--history", metavar="FILE", help="compare with and append to this history file")
+    parser.add_argument("--budget", metavar="FILE", help="fail when a budget of this file is exceeded")
+    args = parser.parse_args()
+
+    try:
+        footprint = read_footprint(args.elf, args.nm)
+        budget = read_budget(args.budget) if args.budget else []
+        last = read_history(args.history) if args.history else {}
+    except (OSError, BudgetError) as e:
+        print("footprint: %s" % e, file=sys.stderr)
+        return 1
+
+    print("%-36s %6s %6s %6s %6s %6s %6s" % ("module", "flash", "", "data", "bss", "ram", ""))
+    for name in sorted(footprint.modules(), key=lambda m: (-footprint.flash[m] - footprint.ram(m), m)):
+        print_row(name, footprint.flash[name], footprint.data[name], footprint.bss[name], last)
+        if args.symbols:
+            for size, symbol in sorted(footprint.symbols[name], reverse=True):
+                print("    %-32s %6d" % (symbol, size))
+    print_row("total", sum(footprint.flash.values()), sum(footprint.data.values()), sum(footprint.bss.values()),
+              last)
+
+    version = commit()
+    if args.history and (version == "unknown" or version.endswith("-dirty")):
+        print("footprint: not added to %s, %s isn't a clean commit" % (args.history, version), file=sys.stderr)
+    elif args.history:
+        try:
+            write_history(args.history, footprint, version)
+        except OSError as e:
+            print("footprint: %s" % e, file=sys.stderr)
+            return 1
+
+    failures = check_budget(budget, footprint)
+    for failure in failures:
+        print("footprint: over budget, %s" % failure, file=sys.stderr)
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,235 @@
+// Replays bounce waveforms through features/debounce_per_key.c, once with the
+// key eager and once deferred, and compares them.
+//
+//     debounce_replay [-s scan_us] waveform...
+//
+// A waveform is the raw level of one key over time, one change per line as
+// `<us> <0|1>`. `press <us> <us>` lines give when the key was meant to be
+// down, and `expect <eager|deferred> <false|missed> <count>` lines what the
+// replay has to find, 0 for what isn't listed. `#` starts a comment.
+//
+// The matrix is scanned every `scan_us` and the key's raw level sampled at
+// the scan. For each algorithm it prints:
+//  - press and release latency from the intended edges, mean and max in us
+//  - false presses: cooked presses with no intended press left to match
+//  - missed presses: intended presses that never got a cooked press
+//  - bounces counted by the chatter counter
+//
+// Exits with 1 when a waveform doesn't meet its expectations.
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "host.h"
+#include "debounce.h"
+#include "debounce_per_key.h"
+
+#define MAX_EDGES 256
+#define MAX_PRESSES 32
+
+// Time after the last change the replay carries on for, to settle.
+#define TAIL_US 200000
+
+enum algorithm { EAGER, DEFERRED };
+
+static const char *const algorithm_names[] = {"eager", "deferred"};
+
+typedef struct {
+    uint32_t time;
+    bool     level;
+} edge_t;
+
+typedef struct {
+    uint32_t start;
+    uint32_t end;
+} press_t;
+
+typedef struct {
+    edge_t   edges[MAX_EDGES];
+    unsigned edge_count;
+    press_t  presses[MAX_PRESSES];
+    unsigned press_count;
+    int      expect_false[2];
+    int      expect_missed[2];
+} waveform_t;
+
+typedef struct {
+    unsigned presses;
+    unsigned false_presses;
+    unsigned missed;
+    unsigned chatter;
+    uint32_t press_latency_sum;
+    uint32_t press_latency_max;
+    uint32_t release_latency_sum;
+    uint32_t release_latency_max;
+    unsigned releases;
+} result_t;
+
+static bool eager;
+
+bool debounce_eager_key(uint8_t row, uint8_t col) {
+    return eager;
+}
+
+//------------------------------------------------------------------------------
+// Waveforms
+//------------------------------------------------------------------------------
+static int algorithm_of(const char *name) {
+    for (int i = EAGER; i <= DEFERRED; i++) {
+        if (strcmp(name, algorithm_names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool load(const char *path, waveform_t *wave) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+    memset(wave, 0, sizeof(*wave));
+
+    char     line[256];
+    unsigned number = 0;
+    bool     ok     = true;
+    while (ok && fgets(line, sizeof(line), file)) {
+        number++;
+        char *comment = strchr(line, '#');
+        if (comment) {
+            *comment = '\0';
+        }
+
+        char     word[16], kind[16];
+        unsigned a, b;
+        int      count;
+        if (sscanf(line, " %15s", word) != 1) {
+            continue;
+        } else if (sscanf(line, " press %u %u", &a, &b) == 2 && wave->press_count < MAX_PRESSES) {
+            wave->presses[wave->press_count++] = (press_t){a, b};
+        } else if (sscanf(line, " expect %15s %15s %d", word, kind, &count) == 3 && algorithm_of(word) >= 0 && (strcmp(kind, "false") == 0 || strcmp(kind, "missed") == 0)) {
+            int *expected = strcmp(kind, "false") == 0 ? wave->expect_false : wave->expect_missed;
+            expected[algorithm_of(word)] = count;
+        } else if (sscanf(line, " %u %u", &a, &b) == 2 && b <= 1 && wave->edge_count < MAX_EDGES) {
+            wave->edges[wave->edge_count++] = (edge_t){a, b};
+        } else {
+            fprintf(stderr, "%s:%u: can't read this line\n", path, number);
+            ok = false;
+        }
+    }
+    fclose(file);
+    return ok;
+}
+
+static bool level_at(const waveform_t *wave, uint32_t time) {
+    bool level = false;
+    for (unsigned i = 0; i < wave->edge_count && wave->edges[i].time <= time; i++) {
+        level = wave->edges[i].level;
+    }
+    return level;
+}
+
+//------------------------------------------------------------------------------
+// Replay
+//------------------------------------------------------------------------------
+static void replay(const waveform_t *wave, enum algorithm algorithm, uint32_t scan_us, result_t *result) {
+    memset(result, 0, sizeof(*result));
+    eager = algorithm == EAGER;
+
+    host_time_us = 0;
+    debounce_init(MATRIX_ROWS);
+    debounce_clear_chatter();
+
+    matrix_row_t raw[MATRIX_ROWS]    = {0};
+    matrix_row_t cooked[MATRIX_ROWS] = {0};
+    bool         matched[MAX_PRESSES] = {false};
+    int          current              = -1; // Intended press the cooked press belongs to
+
+    const uint32_t end = (wave->edge_count ? wave->edges[wave->edge_count - 1].time : 0) + TAIL_US;
+    for (uint32_t time = 0; time < end; time += scan_us) {
+        host_time_us              = time;
+        const matrix_row_t before = raw[0];
+        raw[0]                    = level_at(wave, time);
+        const bool was_down       = cooked[0] & 1;
+        debounce(raw, cooked, MATRIX_ROWS, raw[0] != before);
+        const bool down = cooked[0] & 1;
+
+        if (down && !was_down) {
+            result->presses++;
+            // The first intended press not matched yet that the key could
+            // still be bouncing from.
+            current = -1;
+            for (unsigned i = 0; i < wave->press_count; i++) {
+                if (!matched[i] && time >= wave->presses[i].start && time < wave->presses[i].end) {
+                    current = i;
+                    break;
+                }
+            }
+            if (current < 0) {
+                result->false_presses++;
+                continue;
+            }
+            matched[current]        = true;
+            const uint32_t latency = time - wave->presses[current].start;
+            result->press_latency_sum += latency;
+            if (latency > result->press_latency_max) {
+                result->press_latency_max = latency;
+            }
+        } else if (!down && was_down && current >= 0) {
+            const uint32_t latency = time > wave->presses[current].end ? time - wave->presses[current].end : 0;
+            result->releases++;
+            result->release_latency_sum += latency;
+            if (latency > result->release_latency_max) {
+                result->release_latency_max = latency;
+            }
+            current = -1;
+        }
+    }
+
+    for (unsigned i = 0; i < wave->press_count; i++) {
+        result->missed += !matched[i];
+    }
+    result->chatter = debounce_chatter_count(0, 0);
+}
+
+static void print_result(enum algorithm algorithm, const result_t *result) {
+    const unsigned matched  = result->presses - result->false_presses;
+    const unsigned releases = result->releases;
+    printf("  %-8s  press %5u / %5u us  release %5u / %5u us  false %u  missed %u  bounces %u\n", algorithm_names[algorithm], matched ? result->press_latency_sum / matched : 0, result->press_latency_max, releases ? result->release_latency_sum / releases : 0, result->release_latency_max, result->false_presses, result->missed, result->chatter);
+}
+
+int main(int argc, char **argv) {
+    uint32_t scan_us = 1000;
+
+    int option;
+    while ((option = getopt(argc, argv, "s:")) != -1) {
+        if (option == 's') {
+            scan_us = strtoul(optarg, NULL, 10);
+        } else {
+            fprintf(stderr, "usage: %s [-s scan_us] waveform...\n", argv[0]);
+            return 2;
+        }
+    }
+    if (optind == argc || scan_us == 0) {
+        fprintf(stderr, "usage: %s [-s scan_us] waveform...\n", argv[0]);
+        return 2;
+    }
+
+    static waveform_t wave;
+    printf("scan every %u us, mean / max latency\n", (unsigned)scan_us);
+    for (int i = optind; i < argc; i++) {
+        if (!load(argv[i], &wave)) {
+            return 2;
+        }
+        printf("%s\n", argv[i]);
+        for (int algorithm = EAGER; algorithm <= DEFERRED; algorithm++) {
+            result_t result;
+            replay(&wave, algorithm, scan_us, &result);
+            print_result(algorithm, &result);
+            CHECK_EQ(result.false_presses, wave.expect_false[algorithm]);
+            CHECK_EQ(result.missed, wave.expect_missed[algorithm]);
+        }
+    }
+    return host_finish("debounce_replay");
+}
@@ -0,0 +1,332 @@
+// Harness for features/dynamic_macros.c: records macros, plays them back and
+// reads what the host would type from the reports that reach the driver.
+//
+// A small keymap stands in for QMK's action code: every event registers or
+// unregisters the keycode at its position and sends a keyboard report, as
+// `register_code()` does. One position taps a key within a single event, and
+// one clicks a mouse button.
+//
+// Each report waits for a USB poll on the keyboard, so the report count is
+// what playback time goes by. Without batching there is a report per event.
+
+#include "host.h"
+#include "dynamic_macros.h"
+
+#define MAX_REPORTS 512
+
+// Positions of the stand-in keymap besides the letters.
+#define POS_SHIFT 0, 5
+#define POS_GUI 1, 5
+#define POS_TAP_X 2, 5
+#define POS_CLICK 3, 5
+#define POS_SPACE 4, 5
+
+layer_state_t layer_state;
+
+static report_keyboard_t keyboard_report;
+
+static struct {
+    char     kinds[MAX_REPORTS]; // 'k' for keyboard, 'm' for mouse
+    uint8_t  mods[MAX_REPORTS];
+    uint8_t  keys[MAX_REPORTS][KEYBOARD_REPORT_KEYS];
+    unsigned count;
+} sent;
+
+static unsigned keyboard_sends; // Reports QMK asked for, batched or not
+
+static uint8_t eeprom[1024];
+
+//------------------------------------------------------------------------------
+// Stand-ins for QMK
+//------------------------------------------------------------------------------
+static void driver_send_keyboard(report_keyboard_t *report) {
+    if (sent.count < MAX_REPORTS) {
+        sent.kinds[sent.count] = 'k';
+        sent.mods[sent.count]  = report->mods;
+        memcpy(sent.keys[sent.count], report->keys, KEYBOARD_REPORT_KEYS);
+    }
+    sent.count++;
+}
+
+static void driver_send_mouse(report_mouse_t *report) {
+    if (sent.count < MAX_REPORTS) {
+        sent.kinds[sent.count] = 'm';
+    }
+    sent.count++;
+}
+
+static void driver_send_extra(report_extra_t *report) {}
+
+static host_driver_t  usb_driver = {.send_keyboard = driver_send_keyboard, .send_mouse = driver_send_mouse, .send_extra = driver_send_extra};
+static host_driver_t *driver     = &usb_driver;
+
+host_driver_t *host_get_driver(void) {
+    return driver;
+}
+
+void host_set_driver(host_driver_t *new_driver) {
+    driver = new_driver;
+}
+
+void send_keyboard_report(void) {
+    keyboard_sends++;
+    driver->send_keyboard(&keyboard_report);
+}
+
+static void add_key(uint8_t key) {
+    for (int i = 0; i < KEYBOARD_REPORT_KEYS; i++) {
+        if (!keyboard_report.keys[i]) {
+            keyboard_report.keys[i] = key;
+            return;
+        }
+    }
+}
+
+static void del_key(uint8_t key) {
+    for (int i = 0; i < KEYBOARD_REPORT_KEYS; i++) {
+        if (keyboard_report.keys[i] == key) {
+            keyboard_report.keys[i] = 0;
+        }
+    }
+}
+
+void register_code(uint8_t code) {
+    if (IS_MODIFIER_KEYCODE(code)) {
+        keyboard_report.mods |= MOD_BIT(code);
+    } else {
+        add_key(code);
+    }
+    send_keyboard_report();
+}
+
+void unregister_code(uint8_t code) {
+    if (IS_MODIFIER_KEYCODE(code)) {
+        keyboard_report.mods &= ~MOD_BIT(code);
+    } else {
+        del_key(code);
+    }
+    send_keyboard_report();
+}
+
+void clear_keyboard(void) {
+    memset(&keyboard_report, 0, sizeof(keyboard_report));
+    send_keyboard_report();
+}
+
+void layer_clear(void) {
+    layer_state = 0;
+}
+
+layer_state_t layer_state_set(layer_state_t state) {
+    return layer_state = state;
+}
+
+void eeconfig_read_user_datablock(void *data, uint32_t offset, uint32_t length) {
+    memcpy(data, eeprom + offset, length);
+}
+
+void eeconfig_update_user_datablock(const void *data, uint32_t offset, uint32_t length) {
+    memcpy(eeprom + offset, data, length);
+}
+
+// Rows 0-4 and columns 0-4 hold the letters, column 5 the other keys.
+static uint8_t letter_at(uint8_t row, uint8_t col) {
+    return KC_A + row * 5 + col;
+}
+
+void process_record(keyrecord_t *record) {
+    const keypos_t key     = record->event.key;
+    const bool     pressed = record->event.pressed;
+    if (key.col < 5) {
+        pressed ? register_code(letter_at(key.row, key.col)) : unregister_code(letter_at(key.row, key.col));
+        return;
+    }
+    switch (key.row) {
+        case 0: pressed ? register_code(KC_LSFT) : unregister_code(KC_LSFT); break;
+        case 1: pressed ? register_code(KC_LGUI) : unregister_code(KC_LGUI); break;
+        case 2:
+            if (pressed) {
+                register_code(KC_X);
+                unregister_code(KC_X);
+            }
+            break;
+        case 3: host_mouse_send(&(report_mouse_t){.buttons = pressed}); break;
+        case 4: pressed ? register_code(KC_SPACE) : unregister_code(KC_SPACE); break;
+    }
+}
+
+void host_mouse_send(report_mouse_t *report) {
+    driver->send_mouse(report);
+}
+
+//------------------------------------------------------------------------------
+// Helpers
+//------------------------------------------------------------------------------
+static void dm_key(uint16_t keycode) {
+    keyrecord_t record = {.event = MAKE_KEYEVENT(0, 0, true)};
+    process_dynamic_macros(keycode, &record);
+    record.event.pressed = false;
+    process_dynamic_macros(keycode, &record);
+}
+
+// An event typed while recording, sent through the keymap like a real one.
+// Returns the number of events, 1.
+static unsigned event(uint8_t row, uint8_t col, bool pressed) {
+    keyrecord_t record = {.event = MAKE_KEYEVENT(row, col, pressed)};
+    host_advance_ms(30);
+    if (process_dynamic_macros(KC_NO, &record)) {
+        process_record(&record);
+    }
+    return 1;
+}
+
+static unsigned letter(char c, bool pressed) {
+    if (c == ' ') {
+        return event(POS_SPACE, pressed);
+    }
+    const uint8_t index = c - 'a';
+    return event(index / 5, index % 5, pressed);
+}
+
+// Types `text` of lowercase letters, spaces, and capitals with shift.
+// Every third next key is pressed before the previous one is released.
+static unsigned type(const char *text) {
+    unsigned events = 0;
+    char     held   = 0;
+    for (unsigned i = 0; text[i]; i++) {
+        const char c       = text[i];
+        const bool capital = c >= 'A' && c <= 'Z';
+        const char key     = capital ? c - 'A' + 'a' : c;
+        const bool roll    = i % 3 == 2 && !capital && key != held;
+
+        if (held && !roll) {
+            events += letter(held, false);
+            held = 0;
+        }
+        if (capital) {
+            events += event(POS_SHIFT, true);
+        }
+        events += letter(key, true);
+        if (held) {
+            events += letter(held, false);
+        }
+        if (capital) {
+            events += event(POS_SHIFT, false);
+        }
+        held = key;
+    }
+    if (held) {
+        events += letter(held, false);
+    }
+    return events;
+}
+
+// What the host types from the reports sent since `from`.
+static void decode(unsigned from, char *text, size_t size) {
+    uint8_t last[KEYBOARD_REPORT_KEYS] = {0};
+    size_t  length                     = 0;
+    for (unsigned r = from; r < sent.count && r < MAX_REPORTS; r++) {
+        if (sent.kinds[r] != 'k') {
+            continue;
+        }
+        for (int i = 0; i < KEYBOARD_REPORT_KEYS; i++) {
+            const uint8_t key = sent.keys[r][i];
+            if (!key || memchr(last, key, KEYBOARD_REPORT_KEYS)) {
+                continue;
+            }
+            char c = key == KC_SPACE ? ' ' : 'a' + key - KC_A;
+            if (c != ' ' && sent.mods[r] & MOD_BIT(KC_LSFT)) {
+                c = c - 'a' + 'A';
+            }
+            if (length + 1 < size) {
+                text[length++] = c;
+            }
+        }
+        memcpy(last, sent.keys[r], KEYBOARD_REPORT_KEYS);
+    }
+    text[length] = '\0';
+}
+
+static void clear_sent(void) {
+    memset(&sent, 0, sizeof(sent));
+    keyboard_sends = 0;
+}
+
+//------------------------------------------------------------------------------
+// Tests
+//------------------------------------------------------------------------------
+static void test_typing(void) {
+    static const char text[] = "Hello world The quick brown fox jumps over the lazy dog Tell Anna";
+    char              typed[128];
+
+    dm_key(DM_REC1);
+    clear_sent();
+    const unsigned events = type(text);
+    dm_key(DM_RSTP);
+
+    // Recording doesn't change what is typed.
+    decode(0, typed, sizeof(typed));
+    CHECK_STR(typed, text);
+    CHECK_EQ(sent.count, events);
+
+    clear_sent();
+    dm_key(DM_PLY1);
+    decode(0, typed, sizeof(typed));
+    CHECK_STR(typed, text);
+    CHECK(!is_dynamic_macro_playing());
+    CHECK(driver == &usb_driver);
+
+    // The clear before and after playback are one report each.
+    const unsigned batched   = sent.count - 2;
+    const unsigned unbatched = keyboard_sends - 2;
+    CHECK_EQ(unbatched, events);
+    CHECK(batched * 10 <= unbatched * 6);
+    printf("typing: %u events, %u reports unbatched, %u batched, %.2fx faster\n", events, unbatched, batched, (double)unbatched / batched);
+}
+
+static void test_tap_in_one_event(void) {
+    char typed[16];
+
+    dm_key(DM_REC2);
+    letter('a', true);
+    event(POS_TAP_X, true);
+    event(POS_TAP_X, false);
+    letter('a', false);
+    letter('a', true);
+    letter('a', false);
+    dm_key(DM_RSTP);
+
+    // The tap isn't merged away, and neither is the release between two
+    // presses of the same key.
+    clear_sent();
+    dm_key(DM_PLY2);
+    decode(0, typed, sizeof(typed));
+    CHECK_STR(typed, "axa");
+}
+
+static void test_mouse_after_modifier(void) {
+    dm_key(DM_REC1);
+    event(POS_GUI, true);
+    event(POS_CLICK, true);
+    event(POS_CLICK, false);
+    event(POS_GUI, false);
+    dm_key(DM_RSTP);
+
+    // The held modifier goes out before the click.
+    clear_sent();
+    dm_key(DM_PLY1);
+    CHECK_EQ(sent.count, 6);
+    CHECK_EQ(sent.kinds[1], 'k');
+    CHECK_EQ(sent.mods[1], MOD_BIT(KC_LGUI));
+    CHECK_EQ(sent.kinds[2], 'm');
+    CHECK_EQ(sent.kinds[3], 'm');
+    CHECK_EQ(sent.mods[4], 0);
+}
+
+int main(void) {
+    dynamic_macros_init();
+    test_typing();
+    test_tap_in_one_event();
+    test_mouse_after_modifier();
+    return host_finish("dynamic_macros_test");
+}
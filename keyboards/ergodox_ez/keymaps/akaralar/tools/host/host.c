@@ -0,0 +1,82 @@
+#include "host.h"
+#include "matrix.h"
+
+uint32_t host_time_us = 0;
+
+static unsigned checks   = 0;
+static unsigned failures = 0;
+
+//------------------------------------------------------------------------------
+// Time
+//------------------------------------------------------------------------------
+void host_advance_us(uint32_t us) {
+    host_time_us += us;
+}
+
+void host_advance_ms(uint32_t ms) {
+    host_time_us += ms * 1000;
+}
+
+uint16_t timer_read(void) {
+    return host_time_us / 1000;
+}
+
+uint32_t timer_read32(void) {
+    return host_time_us / 1000;
+}
+
+uint16_t timer_elapsed(uint16_t last) {
+    return TIMER_DIFF_16(timer_read(), last);
+}
+
+uint32_t timer_elapsed32(uint32_t last) {
+    return timer_read32() - last;
+}
+
+void wait_us(uint16_t us) {
+    host_advance_us(us);
+}
+
+void wait_ms(uint16_t ms) {
+    host_advance_ms(ms);
+}
+
+void matrix_io_delay(void) {
+    wait_us(MATRIX_IO_DELAY);
+}
+
+//------------------------------------------------------------------------------
+// Checks
+//------------------------------------------------------------------------------
+bool host_check(bool ok, const char *expr, const char *file, int line) {
+    checks++;
+    if (!ok) {
+        failures++;
+        fprintf(stderr, "%s:%d: failed: %s\n", file, line, expr);
+    }
+    return ok;
+}
+
+bool host_check_eq(long actual, long expected, const char *expr, const char *file, int line) {
+    checks++;
+    if (actual != expected) {
+        failures++;
+        fprintf(stderr, "%s:%d: failed: %s is %ld, expected %ld\n", file, line, expr, actual, expected);
+    }
+    return actual == expected;
+}
+
+bool host_check_str(const char *actual, const char *expected, const char *expr, const char *file, int line) {
+    checks++;
+    if (strcmp(actual, expected) != 0) {
+        failures++;
+        fprintf(stderr, "%s:%d: failed: %s is\n    \"%s\", expected\n    \"%s\"\n", file, line, expr, actual, expected);
+        return false;
+    }
+    return true;
+}
+
+int host_finish(const char *name) {
+    printf("%s: %u checks, %u failed\n", name, checks, failures);
+    return failures ? 1 : 0;
+}
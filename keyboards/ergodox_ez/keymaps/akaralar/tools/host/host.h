@@ -0,0 +1,29 @@
+#pragma once
+
+#include "quantum.h"
+
+//------------------------------------------------------------------------------
+// Host harnesses
+//
+// The keymap sources built for Linux against the stand-ins for QMK in `qmk/`,
+// and driven by a harness per module. Time only moves when a harness or the
+// code under test says so, through `host_advance_us()`, `wait_us()` and
+// `wait_ms()`, so every run is the same.
+//
+// Checks count failures instead of stopping, `host_finish()` prints the
+// totals and gives the exit status. `make test` builds and runs them all.
+//------------------------------------------------------------------------------
+
+extern uint32_t host_time_us;
+
+void host_advance_us(uint32_t us);
+void host_advance_ms(uint32_t ms);
+
+bool host_check(bool ok, const char *expr, const char *file, int line);
+bool host_check_eq(long actual, long expected, const char *expr, const char *file, int line);
+bool host_check_str(const char *actual, const char *expected, const char *expr, const char *file, int line);
+int  host_finish(const char *name);
+
+#define CHECK(cond) host_check((cond), #cond, __FILE__, __LINE__)
+#define CHECK_EQ(actual, expected) host_check_eq((long)(actual), (long)(expected), #actual, __FILE__, __LINE__)
+#define CHECK_STR(actual, expected) host_check_str((actual), (expected), #actual, __FILE__, __LINE__)
@@ -0,0 +1,317 @@
+// Harness for matrix.c against a mocked MCP23018 and right-hand port.
+//
+// The mocked expander keeps its registers and answers like the real one: the
+// columns in GPIOB are those of the row pulled low in GPIOA. It can be
+// detached, then every transaction fails. The right half answers PINF with
+// the columns of the row selected in the DDR and PORT registers. A row that
+// was read less than SETTLE_US ago still pulls its columns low, like a column
+// line that wasn't given time to charge back up.
+//
+// Every transaction and read is logged, so that a test can check the order of
+// a scan.
+
+#include "host.h"
+#include "matrix.h"
+#include "i2c_master.h"
+#include "ergodox_matrix.h"
+
+void matrix_init_custom(void);
+bool matrix_scan_custom(matrix_row_t current_matrix[]);
+
+#define ROWS_PER_HAND (MATRIX_ROWS / 2)
+
+// Time a transaction of a few bytes takes at 400 kHz, and a failed one that
+// isn't acknowledged.
+#define I2C_TRANSACTION_US 90
+#define I2C_NACK_US 25
+
+// Time a column line needs to settle after its row is released.
+#define SETTLE_US 10
+
+#define MCP_IODIRA 0x00
+#define MCP_GPIOA 0x12
+#define MCP_GPIOB 0x13
+
+volatile uint8_t DDRB, PORTB, DDRC, PORTC, DDRD, PORTD, DDRF, PORTF, TCCR3A, TCCR3B, TIFR3, SREG;
+volatile uint16_t TCNT3;
+
+bool         debug_enable, debug_matrix;
+i2c_status_t mcp23018_status;
+
+static struct {
+    bool     attached;
+    uint8_t  registers[0x16];
+    unsigned transactions;
+    unsigned init_attempts;
+    uint32_t init_times[16];
+} mcp;
+
+static matrix_row_t keys[MATRIX_ROWS];
+static matrix_row_t matrix[MATRIX_ROWS];
+
+static char log_text[512];
+
+// Times two rows of a half were selected at once.
+static unsigned overlapping_rows = 0;
+
+static int      last_right_row = -1;
+static uint32_t last_right_read;
+
+static void log_event(const char *format, int a, int b) {
+    const size_t length = strlen(log_text);
+    snprintf(log_text + length, sizeof(log_text) - length, format, a, b);
+}
+
+//------------------------------------------------------------------------------
+// Mocks
+//------------------------------------------------------------------------------
+// Right-hand row pulled low, -1 when none.
+static int right_selected_row(void) {
+    static const struct {
+        volatile uint8_t *ddr;
+        volatile uint8_t *port;
+        uint8_t           bit;
+    } pins[ROWS_PER_HAND] = {
+        {&DDRB, &PORTB, 0}, {&DDRB, &PORTB, 1}, {&DDRB, &PORTB, 2}, {&DDRB, &PORTB, 3}, {&DDRD, &PORTD, 2}, {&DDRD, &PORTD, 3}, {&DDRC, &PORTC, 6},
+    };
+    int selected = -1;
+    for (int row = 0; row < ROWS_PER_HAND; row++) {
+        if ((*pins[row].ddr & 1 << pins[row].bit) && !(*pins[row].port & 1 << pins[row].bit)) {
+            overlapping_rows += selected != -1;
+            selected = row;
+        }
+    }
+    return selected;
+}
+
+// Left-hand row pulled low in GPIOA, -1 when none.
+static int left_selected_row(void) {
+    int selected = -1;
+    for (int row = 0; row < ROWS_PER_HAND; row++) {
+        if (!(mcp.registers[MCP_GPIOA] & 1 << row)) {
+            overlapping_rows += selected != -1;
+            selected = row;
+        }
+    }
+    return selected;
+}
+
+volatile uint8_t *host_pinf(void) {
+    static volatile uint8_t pins;
+
+    const int    row     = right_selected_row();
+    matrix_row_t columns = row >= 0 ? keys[ROWS_PER_HAND + row] : 0;
+    if (last_right_row >= 0 && last_right_row != row && host_time_us - last_right_read < SETTLE_US) {
+        columns |= keys[ROWS_PER_HAND + last_right_row];
+    }
+    last_right_row  = row;
+    last_right_read = host_time_us;
+    log_event("F%d ", row, 0);
+
+    // Columns are on F0, F1 and F4-F7, active low.
+    pins = ~((columns & 0x03) | (columns & 0x3C) << 2);
+    return &pins;
+}
+
+void i2c_init(void) {}
+
+i2c_status_t i2c_write_register(uint8_t devaddr, uint8_t regaddr, const uint8_t *data, uint16_t length, uint16_t timeout) {
+    mcp.transactions++;
+    if (regaddr == MCP_IODIRA && mcp.init_attempts < 16) {
+        mcp.init_times[mcp.init_attempts++] = host_time_us / 1000;
+    }
+    if (!mcp.attached) {
+        host_advance_us(I2C_NACK_US);
+        return I2C_STATUS_ERROR;
+    }
+    host_advance_us(I2C_TRANSACTION_US);
+    memcpy(&mcp.registers[regaddr], data, length);
+    if (regaddr == MCP_GPIOA) {
+        log_event("A%d:%d ", left_selected_row(), right_selected_row());
+    }
+    return I2C_STATUS_SUCCESS;
+}
+
+i2c_status_t i2c_read_register(uint8_t devaddr, uint8_t regaddr, uint8_t *data, uint16_t length, uint16_t timeout) {
+    mcp.transactions++;
+    if (!mcp.attached) {
+        host_advance_us(I2C_NACK_US);
+        return I2C_STATUS_ERROR;
+    }
+    host_advance_us(I2C_TRANSACTION_US);
+    if (regaddr == MCP_GPIOB) {
+        const int row = left_selected_row();
+        // Columns on GPIOB0-5 with pull-ups, active low.
+        mcp.registers[MCP_GPIOB] = ~(row >= 0 ? keys[row] : 0);
+        log_event("B%d ", row, 0);
+    }
+    memcpy(data, &mcp.registers[regaddr], length);
+    return I2C_STATUS_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+// Helpers
+//------------------------------------------------------------------------------
+static void reset(bool attached) {
+    memset(&mcp, 0, sizeof(mcp));
+    memset(keys, 0, sizeof(keys));
+    memset(matrix, 0, sizeof(matrix));
+    mcp.attached   = attached;
+    last_right_row = -1;
+    host_advance_ms(100);
+    matrix_init_custom();
+}
+
+static bool scan(void) {
+    log_text[0] = '\0';
+    return matrix_scan_custom(matrix);
+}
+
+// Moves time on to the start of the next millisecond.
+static void next_ms(void) {
+    host_time_us = (host_time_us / 1000 + 1) * 1000;
+}
+
+// Scans at the start of every millisecond for `ms` milliseconds, or as often
+// as scans fit in.
+static void scan_for(uint32_t ms) {
+    const uint32_t end = host_time_us + ms * 1000;
+    while (host_time_us < end) {
+        next_ms();
+        scan();
+    }
+}
+
+//------------------------------------------------------------------------------
+// Tests
+//------------------------------------------------------------------------------
+static void test_scan_order(void) {
+    reset(true);
+    scan();
+
+    // Each right row is selected before the left row write, and read before
+    // the left columns, which come from the row just selected.
+    CHECK_STR(log_text, "A0:0 F0 B0 A1:1 F1 B1 A2:2 F2 B2 A3:3 F3 B3 A4:4 F4 B4 A5:5 F5 B5 A6:6 F6 B6 ");
+
+    // Two transactions a row, besides the three of the init.
+    CHECK_EQ(mcp.transactions, 3 + 2 * ROWS_PER_HAND);
+}
+
+static void test_keys(void) {
+    reset(true);
+    keys[2]  = 1 << 3;
+    keys[9]  = 1 << 5;
+    keys[13] = 1 << 0 | 1 << 1;
+
+    CHECK(scan());
+    for (int row = 0; row < MATRIX_ROWS; row++) {
+        CHECK_EQ(matrix[row], keys[row]);
+    }
+    CHECK(!scan());
+
+    keys[2] = 0;
+    CHECK(scan());
+    CHECK_EQ(matrix[2], 0);
+}
+
+static void test_right_half_settles_without_left_half(void) {
+    reset(false);
+    CHECK(!ergodox_matrix_left_connected());
+
+    // Every row of the right half, with the one below it empty.
+    for (int row = ROWS_PER_HAND; row < MATRIX_ROWS; row += 2) {
+        keys[row] = 0b111111;
+    }
+    scan();
+    for (int row = 0; row < MATRIX_ROWS; row++) {
+        CHECK_EQ(matrix[row], keys[row]);
+    }
+}
+
+static void test_disconnect(void) {
+    reset(true);
+    keys[0] = 1 << 1;
+    keys[7] = 1 << 1;
+    scan();
+    CHECK_EQ(matrix[0], 1 << 1);
+
+    const uint16_t errors = ergodox_matrix_i2c_errors();
+    mcp.attached          = false;
+    scan();
+
+    // Keys of the left half are released, the right half carries on.
+    CHECK(!ergodox_matrix_left_connected());
+    CHECK_EQ(ergodox_matrix_i2c_errors(), errors + 1);
+    CHECK_EQ(matrix[0], 0);
+    CHECK_EQ(matrix[7], 1 << 1);
+
+    // No transactions while waiting to retry.
+    mcp.transactions = 0;
+    scan_for(10);
+    CHECK_EQ(mcp.transactions, 0);
+}
+
+static void test_reconnect_backoff(void) {
+    reset(true);
+    scan();
+    mcp.attached      = false;
+    mcp.init_attempts = 0;
+    next_ms();
+    const uint32_t lost = host_time_us / 1000;
+    scan();
+
+    // Attempts to reconnect double their interval up to the maximum.
+    scan_for(8000);
+    static const uint32_t intervals[] = {32, 64, 128, 256, 512, 1024, 2048, 2048};
+    CHECK_EQ(mcp.init_attempts, 8);
+    uint32_t last = lost;
+    for (unsigned i = 0; i < mcp.init_attempts && i < 8; i++) {
+        CHECK_EQ(mcp.init_times[i] - last, intervals[i]);
+        last = mcp.init_times[i];
+    }
+    // Only a failed write each, one in a scan.
+    CHECK_EQ(mcp.transactions - 3 - 2 * ROWS_PER_HAND - 1, mcp.init_attempts);
+
+    // Plugged back in, the next attempt attaches it and its keys are read in
+    // the same scan.
+    mcp.attached = true;
+    keys[4]      = 1 << 2;
+    while (!ergodox_matrix_left_connected()) {
+        next_ms();
+        scan();
+    }
+    CHECK_EQ(mcp.init_attempts, 9);
+    CHECK_EQ(mcp.init_times[8] - last, 2048);
+    CHECK_EQ(matrix[4], 1 << 2);
+
+    // The backoff starts over.
+    mcp.attached      = false;
+    mcp.init_attempts = 0;
+    scan_for(100);
+    CHECK_EQ(mcp.init_attempts, 2);
+    CHECK_EQ(mcp.init_times[1] - mcp.init_times[0], 64);
+}
+
+static void test_scan_rate(void) {
+    // A scan with the left half takes 14 transactions, 1.26 ms, so one starts
+    // every 2 ms.
+    reset(true);
+    scan_for(3000);
+    CHECK_EQ(ergodox_matrix_scan_rate(), 500);
+
+    // Without it a scan is well under a millisecond.
+    reset(false);
+    scan_for(3000);
+    CHECK_EQ(ergodox_matrix_scan_rate(), 1000);
+}
+
+int main(void) {
+    test_scan_order();
+    test_keys();
+    test_right_half_settles_without_left_half();
+    test_disconnect();
+    test_reconnect_backoff();
+    test_scan_rate();
+    CHECK_EQ(overlapping_rows, 0);
+    return host_finish("matrix_test");
+}
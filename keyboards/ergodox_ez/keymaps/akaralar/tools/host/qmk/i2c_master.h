@@ -0,0 +1,15 @@
+#pragma once
+
+#include "quantum.h"
+
+typedef int16_t i2c_status_t;
+
+#define I2C_STATUS_SUCCESS 0
+#define I2C_STATUS_ERROR -1
+#define I2C_STATUS_TIMEOUT -2
+
+extern i2c_status_t mcp23018_status;
+
+void         i2c_init(void);
+i2c_status_t i2c_write_register(uint8_t devaddr, uint8_t regaddr, const uint8_t *data, uint16_t length, uint16_t timeout);
+i2c_status_t i2c_read_register(uint8_t devaddr, uint8_t regaddr, uint8_t *data, uint16_t length, uint16_t timeout);
@@ -0,0 +1,6 @@
+#pragma once
+
+#include "quantum.h"
+
+// Waits MATRIX_IO_DELAY us, weak in QMK.
+void matrix_io_delay(void);
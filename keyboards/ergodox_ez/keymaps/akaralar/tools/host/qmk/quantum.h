@@ -0,0 +1,256 @@
+#pragma once
+
+// Stand-in for QMK's quantum.h in the host builds, see ../host.h. Declares the
+// parts of QMK the keymap sources use, with the keycode values of QMK. Only
+// what a harness links against has to be defined, by host.c or the harness.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define pgm_read_word(p) (*(const uint16_t*)(p))
+#define pgm_read_ptr(p) (*(void* const*)(p))
+#define memcpy_P memcpy
+#define MATRIX_ROWS 14
+#define MATRIX_COLS 6
+#define MATRIX_IO_DELAY 30
+typedef uint8_t matrix_row_t;
+typedef uint16_t layer_state_t;
+typedef struct { uint8_t col; uint8_t row; } keypos_t;
+typedef enum { TICK_EVENT=0, KEY_EVENT=1, ENCODER_CW_EVENT, ENCODER_CCW_EVENT, COMBO_EVENT } keyevent_type_t;
+typedef struct { keypos_t key; uint16_t time; keyevent_type_t type; bool pressed; } keyevent_t;
+typedef struct { bool interrupted:1; bool reserved2:1; bool reserved1:1; bool reserved0:1; uint8_t count:4; } tap_t;
+typedef struct { keyevent_t event; tap_t tap; uint16_t keycode; } keyrecord_t;
+#ifdef WHEEL_EXTENDED_REPORT
+typedef struct { uint8_t buttons; int8_t x; int8_t y; int16_t v; int16_t h; } report_mouse_t;
+#else
+typedef struct { uint8_t buttons; int8_t x; int8_t y; int8_t v; int8_t h; } report_mouse_t;
+#endif
+// Port registers. Reading the column port is a call, so that a harness can
+// answer for the rows selected at that moment.
+extern volatile uint8_t DDRB, PORTB, DDRC, PORTC, DDRD, PORTD, DDRF, PORTF, TCCR3A, TCCR3B, TIFR3, SREG;
+extern volatile uint16_t TCNT3;
+volatile uint8_t *host_pinf(void);
+#define PINF (*host_pinf())
+extern bool debug_enable, debug_matrix;
+#ifdef HOST_VERBOSE
+#    define dprintf(...) printf(__VA_ARGS__)
+#    define dprintln(s) puts(s)
+#    define uprintf(...) printf(__VA_ARGS__)
+#else
+#    define dprintf(...) ((void)0)
+#    define dprintln(s) ((void)0)
+#    define uprintf(...) ((void)0)
+#endif
+uint16_t timer_read(void); uint32_t timer_read32(void);
+uint16_t timer_elapsed(uint16_t); uint32_t timer_elapsed32(uint32_t);
+#define timer_expired(a,b) ((uint16_t)((a)-(b)) < 0x8000)
+#define TIMER_DIFF_16(a, b) ((uint16_t)((a) - (b)))
+void wait_ms(uint16_t); void wait_us(uint16_t);
+#define QK_BASIC 0x0000
+#define QK_BASIC_MAX 0x00FF
+#define QK_MODS 0x0100
+#define QK_MODS_MAX 0x1FFF
+#define QK_MOD_TAP 0x2000
+#define QK_MOD_TAP_MAX 0x3FFF
+#define QK_LAYER_TAP 0x4000
+#define QK_LAYER_TAP_MAX 0x4FFF
+#define QK_MOMENTARY 0x5220
+#define QK_MOMENTARY_MAX 0x523F
+#define IS_QK_MOMENTARY(c) ((c)>=QK_MOMENTARY && (c)<=QK_MOMENTARY_MAX)
+#define QK_TOGGLE_LAYER 0x5260
+#define QK_ONE_SHOT_LAYER 0x5280
+#define QK_ONE_SHOT_LAYER_MAX 0x529F
+#define QK_ONE_SHOT_MOD 0x52A0
+#define QK_ONE_SHOT_MOD_MAX 0x52BF
+#define QK_LAYER_TAP_TOGGLE 0x52C0
+#define QK_KB 0x7E00
+#define QK_USER 0x7E40
+#define SAFE_RANGE QK_USER
+#define EZ_SAFE_RANGE (QK_USER+4)
+#define IS_QK_MOD_TAP(c) ((c)>=QK_MOD_TAP && (c)<=QK_MOD_TAP_MAX)
+#define IS_QK_LAYER_TAP(c) ((c)>=QK_LAYER_TAP && (c)<=QK_LAYER_TAP_MAX)
+#define IS_QK_ONE_SHOT_MOD(c) ((c)>=QK_ONE_SHOT_MOD && (c)<=QK_ONE_SHOT_MOD_MAX)
+#define IS_QK_ONE_SHOT_LAYER(c) ((c)>=QK_ONE_SHOT_LAYER && (c)<=QK_ONE_SHOT_LAYER_MAX)
+#define IS_QK_MODS(c) ((c)>=QK_MODS && (c)<=QK_MODS_MAX)
+#define IS_QK_BASIC(c) ((c)<=QK_BASIC_MAX)
+#define QK_MOD_TAP_GET_MODS(kc) (((kc) >> 8) & 0x1F)
+#define QK_MOD_TAP_GET_TAP_KEYCODE(kc) ((kc) & 0xFF)
+#define QK_LAYER_TAP_GET_LAYER(kc) (((kc) >> 8) & 0xF)
+#define QK_LAYER_TAP_GET_TAP_KEYCODE(kc) ((kc) & 0xFF)
+#define QK_MODS_GET_MODS(kc) (((kc) >> 8) & 0x1F)
+#define QK_MODS_GET_BASIC_KEYCODE(kc) ((kc) & 0xFF)
+#define QK_ONE_SHOT_MOD_GET_MODS(kc) ((kc) & 0x1F)
+#define IS_KEYEVENT(e) ((e).type == KEY_EVENT)
+#define IS_EVENT(e) ((e).type != TICK_EVENT)
+#define MAKE_KEYEVENT(r, c, p) ((keyevent_t){.key = (keypos_t){.row = (r), .col = (c)}, .pressed = (p), .time = timer_read(), .type = KEY_EVENT})
+#define MOD_LCTL 0x01
+#define MOD_LSFT 0x02
+#define MOD_LALT 0x04
+#define MOD_LGUI 0x08
+#define MOD_RCTL 0x11
+#define MOD_RSFT 0x12
+#define MOD_RALT 0x14
+#define MOD_RGUI 0x18
+#define MOD_MEH 0x07
+#define MOD_HYPR 0x0F
+#define MOD_BIT(k) (1<<((k)&7))
+#define MOD_BIT_LCTRL 0x01
+#define MOD_BIT_LSHIFT 0x02
+#define MOD_BIT_LALT 0x04
+#define MOD_BIT_LGUI 0x08
+#define MOD_BIT_RCTRL 0x10
+#define MOD_BIT_RSHIFT 0x20
+#define MOD_BIT_RALT 0x40
+#define MOD_BIT_RGUI 0x80
+#define MOD_MASK_CTRL 0x11
+#define MOD_MASK_SHIFT 0x22
+#define MOD_MASK_ALT 0x44
+#define MOD_MASK_GUI 0x88
+#define MOD_MASK_CSAG 0xFF
+#define MT(m,k) (QK_MOD_TAP | (((m)&0x1F)<<8) | ((k)&0xFF))
+#define MEH_T(k) MT(MOD_MEH,k)
+#define ALL_T(k) MT(MOD_HYPR,k)
+#define LT(l,k) (QK_LAYER_TAP | (((l)&0xF)<<8) | ((k)&0xFF))
+#define MO(l) (QK_MOMENTARY | ((l)&0x1F))
+#define TG(l) (QK_TOGGLE_LAYER | ((l)&0x1F))
+#define TT(l) (QK_LAYER_TAP_TOGGLE | ((l)&0x1F))
+#define OSL(l) (QK_ONE_SHOT_LAYER | ((l)&0x1F))
+#define OSM(m) (QK_ONE_SHOT_MOD | ((m)&0x1F))
+#define LCTL(k) (0x0100|(k))
+#define LSFT(k) (0x0200|(k))
+#define LALT(k) (0x0400|(k))
+#define LGUI(k) (0x0800|(k))
+#define RCTL(k) (0x1100|(k))
+#define RSFT(k) (0x1200|(k))
+#define RALT(k) (0x1400|(k))
+#define RGUI(k) (0x1800|(k))
+#define MEH(k) (0x0700|(k))
+#define HYPR(k) (0x0F00|(k))
+enum { KC_NO=0, KC_TRANSPARENT=1, KC_A=4,KC_B,KC_C,KC_D,KC_E,KC_F,KC_G,KC_H,KC_I,KC_J,KC_K,KC_L,KC_M,KC_N,KC_O,KC_P,KC_Q,KC_R,KC_S,KC_T,KC_U,KC_V,KC_W,KC_X,KC_Y,KC_Z,
+KC_1,KC_2,KC_3,KC_4,KC_5,KC_6,KC_7,KC_8,KC_9,KC_0,KC_ENTER,KC_ESCAPE,KC_BACKSPACE,KC_TAB,KC_SPACE,KC_MINUS,KC_EQUAL,KC_LEFT_BRACKET,KC_RIGHT_BRACKET,KC_BACKSLASH,KC_NONUS_HASH,KC_SEMICOLON,KC_QUOTE,KC_GRAVE,KC_COMMA,KC_DOT,KC_SLASH,KC_CAPS_LOCK,
+KC_F1,KC_F2,KC_F3,KC_F4,KC_F5,KC_F6,KC_F7,KC_F8,KC_F9,KC_F10,KC_F11,KC_F12,KC_PRINT_SCREEN,KC_SCROLL_LOCK,KC_PAUSE,KC_INSERT,KC_HOME,KC_PAGE_UP,KC_DELETE,KC_END,KC_PAGE_DOWN,KC_RIGHT,KC_LEFT,KC_DOWN,KC_UP,
+KC_MS_UP=0xCD, KC_MS_DOWN, KC_MS_LEFT, KC_MS_RIGHT, KC_MS_BTN1, KC_MS_BTN2, KC_MS_BTN3, KC_MS_BTN4, KC_MS_BTN5, KC_MS_BTN6, KC_MS_BTN7, KC_MS_BTN8, KC_MS_WH_UP, KC_MS_WH_DOWN, KC_MS_WH_LEFT, KC_MS_WH_RIGHT, KC_MS_ACCEL0, KC_MS_ACCEL1, KC_MS_ACCEL2,
+KC_LEFT_CTRL=0xE0,KC_LEFT_SHIFT,KC_LEFT_ALT,KC_LEFT_GUI,KC_RIGHT_CTRL,KC_RIGHT_SHIFT,KC_RIGHT_ALT,KC_RIGHT_GUI,
+KC_MUTE=0xA8, KC_VOLU, KC_VOLD, KC_MNXT, KC_MPRV, KC_MSTP, KC_MPLY, KC_BRIU=0xBD, KC_BRID,
+QK_BOOT=0x7C00, DM_REC1=0x7C53, DM_REC2, DM_RSTP, DM_PLY1, DM_PLY2 };
+#define KC_TRNS KC_TRANSPARENT
+#define _______ KC_TRNS
+#define XXXXXXX KC_NO
+#define KC_BSPC KC_BACKSPACE
+#define KC_DEL KC_DELETE
+#define KC_ESC KC_ESCAPE
+#define KC_ENT KC_ENTER
+#define KC_SPC KC_SPACE
+#define KC_QUOT KC_QUOTE
+#define KC_COMM KC_COMMA
+#define KC_SLSH KC_SLASH
+#define KC_MINS KC_MINUS
+#define KC_EQL KC_EQUAL
+#define KC_LBRC KC_LEFT_BRACKET
+#define KC_RBRC KC_RIGHT_BRACKET
+#define KC_BSLS KC_BACKSLASH
+#define KC_SCLN KC_SEMICOLON
+#define KC_GRV KC_GRAVE
+#define KC_INS KC_INSERT
+#define KC_PGUP KC_PAGE_UP
+#define KC_PGDN KC_PAGE_DOWN
+#define KC_RGHT KC_RIGHT
+#define KC_CAPS KC_CAPS_LOCK
+#define KC_LCTL KC_LEFT_CTRL
+#define KC_LSFT KC_LEFT_SHIFT
+#define KC_LALT KC_LEFT_ALT
+#define KC_LGUI KC_LEFT_GUI
+#define KC_RCTL KC_RIGHT_CTRL
+#define KC_RSFT KC_RIGHT_SHIFT
+#define KC_RALT KC_RIGHT_ALT
+#define KC_RGUI KC_RIGHT_GUI
+#define KC_MEH MEH(KC_NO)
+#define KC_HYPR HYPR(KC_NO)
+#define KC_TILD LSFT(KC_GRAVE)
+#define KC_EXLM LSFT(KC_1)
+#define KC_AT LSFT(KC_2)
+#define KC_HASH LSFT(KC_3)
+#define KC_DLR LSFT(KC_4)
+#define KC_PERC LSFT(KC_5)
+#define KC_CIRC LSFT(KC_6)
+#define KC_AMPR LSFT(KC_7)
+#define KC_ASTR LSFT(KC_8)
+#define KC_LPRN LSFT(KC_9)
+#define KC_RPRN LSFT(KC_0)
+#define KC_UNDS LSFT(KC_MINUS)
+#define KC_PLUS LSFT(KC_EQUAL)
+#define KC_LCBR LSFT(KC_LEFT_BRACKET)
+#define KC_RCBR LSFT(KC_RIGHT_BRACKET)
+#define KC_PIPE LSFT(KC_BACKSLASH)
+#define KC_COLN LSFT(KC_SEMICOLON)
+#define KC_DQUO LSFT(KC_QUOTE)
+#define KC_LABK LSFT(KC_COMMA)
+#define KC_RABK LSFT(KC_DOT)
+#define KC_QUES LSFT(KC_SLASH)
+#define KC_MS_U KC_MS_UP
+#define KC_MS_D KC_MS_DOWN
+#define KC_MS_L KC_MS_LEFT
+#define KC_MS_R KC_MS_RIGHT
+#define KC_WH_U KC_MS_WH_UP
+#define KC_WH_D KC_MS_WH_DOWN
+#define KC_WH_L KC_MS_WH_LEFT
+#define KC_WH_R KC_MS_WH_RIGHT
+#define KC_BTN1 KC_MS_BTN1
+#define KC_BTN2 KC_MS_BTN2
+#define KC_BTN3 KC_MS_BTN3
+#define SEND_STRING(s) send_string(s)
+void send_string(const char*);
+void tap_code(uint8_t); void tap_code16(uint16_t); void register_code(uint8_t); void unregister_code(uint8_t);
+void register_code16(uint16_t); void unregister_code16(uint16_t);
+void register_mods(uint8_t); void unregister_mods(uint8_t); uint8_t get_mods(void); void set_mods(uint8_t); void add_mods(uint8_t); void del_mods(uint8_t); void clear_mods(void);
+uint8_t get_oneshot_mods(void); void set_oneshot_mods(uint8_t); void del_oneshot_mods(uint8_t); void clear_oneshot_mods(void);
+uint8_t get_weak_mods(void); void add_weak_mods(uint8_t); void del_weak_mods(uint8_t); void clear_weak_mods(void);
+void send_keyboard_report(void);
+void process_record(keyrecord_t*); void action_tapping_process(keyrecord_t); void action_exec(keyevent_t);
+extern layer_state_t layer_state, default_layer_state;
+uint8_t get_highest_layer(layer_state_t); uint8_t biton32(uint32_t);
+bool layer_state_is(uint8_t); layer_state_t layer_state_set(layer_state_t); void layer_clear(void); void layer_on(uint8_t); void layer_off(uint8_t); void layer_invert(uint8_t);
+bool is_caps_word_on(void); void caps_word_on(void); void caps_word_off(void);
+uint8_t mod_config(uint8_t); uint16_t keycode_config(uint16_t);
+uint16_t keycode_at_keymap_location(uint8_t, uint8_t, uint8_t);
+uint16_t keymap_key_to_keycode(uint8_t layer, keypos_t key);
+void clear_keyboard(void);
+extern const uint16_t keymaps[][MATRIX_ROWS][MATRIX_COLS];
+void eeconfig_read_user_datablock(void *data, uint32_t offset, uint32_t length);
+void eeconfig_update_user_datablock(const void *data, uint32_t offset, uint32_t length);
+void raw_hid_send(uint8_t *data, uint8_t length);
+report_mouse_t mousekey_get_report(void); void host_mouse_send(report_mouse_t*);
+#define KEYBOARD_REPORT_KEYS 6
+typedef struct { uint8_t mods; uint8_t reserved; uint8_t keys[KEYBOARD_REPORT_KEYS]; } report_keyboard_t;
+typedef struct { uint8_t mods; uint8_t bits[30]; } report_nkro_t;
+typedef struct { uint8_t report_id; uint16_t usage; } report_extra_t;
+typedef struct {
+    uint8_t (*keyboard_leds)(void);
+    void (*send_keyboard)(report_keyboard_t *);
+    void (*send_nkro)(report_nkro_t *);
+    void (*send_mouse)(report_mouse_t *);
+    void (*send_extra)(report_extra_t *);
+} host_driver_t;
+host_driver_t *host_get_driver(void); void host_set_driver(host_driver_t *driver);
+void ergodox_board_led_off(void); void ergodox_right_led_1_off(void); void ergodox_right_led_2_off(void); void ergodox_right_led_3_off(void);
+void ergodox_right_led_1_on(void); void ergodox_right_led_2_on(void); void ergodox_right_led_3_on(void);
+#define LAYOUT_ergodox(...) {{0}}
+#define QMK_KEYBOARD "ergodox_ez/glow"
+#define QMK_KEYMAP "akaralar"
+#define QMK_VERSION "x"
+void keyboard_post_init_user(void);
+uint16_t get_tapping_term(uint16_t keycode, keyrecord_t *record);
+bool get_permissive_hold(uint16_t keycode, keyrecord_t *record);
+#define GET_TAPPING_TERM(keycode, record) get_tapping_term(keycode, record)
+uint8_t keymap_layer_count(void); uint16_t keymap_key_to_keycode(uint8_t layer, keypos_t key);
+extern volatile uint8_t GPIOR0;
+#define IS_MODIFIER_KEYCODE(code) ((code) >= KC_LEFT_CTRL && (code) <= KC_RIGHT_GUI)
+#define KEYEQ(keya, keyb) ((keya).row == (keyb).row && (keya).col == (keyb).col)
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+uint16_t pointing_device_get_hires_scroll_resolution(void);
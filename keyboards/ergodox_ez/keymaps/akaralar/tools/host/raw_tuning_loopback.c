@@ -0,0 +1,169 @@
+// Keyboard end of the raw HID tuning protocol for tests of tools/raw_tuning.py,
+// see raw_tuning_test.py.
+//
+//     raw_tuning_loopback eeprom_file
+//
+// Reads reports from stdin as hidraw takes them, a report id and 32 bytes,
+// runs them through features/raw_tuning.c and features/tuning.c and writes the
+// replies to stdout. The user EEPROM datablock is kept in `eeprom_file`, so
+// that saved parameters are loaded again by the next run.
+//
+// The counters come from stand-ins with fixed values, so that a test knows
+// what each command has to return: the chatter count of a key is
+// `row * 10 + col`, its press count `row * 100 + col`, and so on below.
+
+#include "host.h"
+#include "raw_tuning.h"
+#include "tuning.h"
+#include "debounce_per_key.h"
+#include "ergodox_matrix.h"
+#include "key_stats.h"
+#include "misfire.h"
+#include "speculative_tap.h"
+#include "stack_watch.h"
+
+#define REPORT_SIZE 32
+
+static uint8_t     eeprom[EECONFIG_USER_DATA_SIZE];
+static const char *eeprom_path;
+
+static bool cleared;
+
+//------------------------------------------------------------------------------
+// Stand-ins
+//------------------------------------------------------------------------------
+void eeconfig_read_user_datablock(void *data, uint32_t offset, uint32_t length) {
+    memcpy(data, eeprom + offset, length);
+}
+
+void eeconfig_update_user_datablock(const void *data, uint32_t offset, uint32_t length) {
+    memcpy(eeprom + offset, data, length);
+}
+
+void raw_hid_send(uint8_t *data, uint8_t length) {
+    fwrite(data, length, 1, stdout);
+    fflush(stdout);
+}
+
+uint16_t ergodox_matrix_scan_rate(void) {
+    return 1234;
+}
+
+uint16_t ergodox_matrix_i2c_errors(void) {
+    return 5;
+}
+
+bool ergodox_matrix_left_connected(void) {
+    return true;
+}
+
+uint8_t debounce_chatter_count(uint8_t row, uint8_t col) {
+    return cleared ? 0 : row * 10 + col;
+}
+
+void debounce_clear_chatter(void) {
+    cleared = true;
+}
+
+uint16_t key_stats_presses(uint8_t row, uint8_t col) {
+    return cleared ? 0 : row * 100 + col;
+}
+
+// Two slots in use, keys 2:3 and 5:12.
+const key_stats_tap_hold_t *key_stats_tap_hold(uint8_t slot) {
+    static key_stats_tap_hold_t stats;
+    if (slot >= 2 || cleared) {
+        return NULL;
+    }
+    stats = (key_stats_tap_hold_t){
+        .key            = slot ? (12 | 5 << 4) : (3 | 2 << 4),
+        .taps           = 300 + slot,
+        .holds          = 40 + slot,
+        .tap_durations  = {1, 2, 3, 4, 5, 6},
+        .hold_durations = {0, 0, 7, 8, 9, 10},
+    };
+    return &stats;
+}
+
+void key_stats_clear(void) {
+    cleared = true;
+}
+
+// One key in use, 1:4, and one logged misfire.
+const misfire_key_t *misfire_key(uint8_t slot) {
+    static const misfire_key_t stats = {.key = 4 | 1 << 4, .settles = 200, .tap_misfires = 3, .hold_misfires = 2};
+    return slot == 0 && !cleared ? &stats : NULL;
+}
+
+const misfire_log_t *misfire_log(uint8_t index) {
+    static const misfire_log_t entry = {.key = 4 | 1 << 4, .reason = 0x80 | 3, .settle_time = 180, .correction_time = 420};
+    return index == 0 && !cleared ? &entry : NULL;
+}
+
+void misfire_clear(void) {}
+
+const speculative_tap_counts_t *speculative_tap_counts(void) {
+    static const speculative_tap_counts_t counts = {.speculations = 900, .rollbacks = 45};
+    return &counts;
+}
+
+void speculative_tap_clear(void) {}
+
+uint16_t stack_watch_size(void) {
+    return 1100;
+}
+
+uint16_t stack_watch_unused(void) {
+    return 640;
+}
+
+uint16_t stack_watch_depth(uint8_t mark) {
+    return mark < STACK_MARK_COUNT ? 100 + 10 * mark : 0;
+}
+
+void stack_watch_clear(void) {}
+
+//------------------------------------------------------------------------------
+// Loopback
+//------------------------------------------------------------------------------
+static void load_eeprom(void) {
+    memset(eeprom, 0xFF, sizeof(eeprom));
+    FILE *file = fopen(eeprom_path, "rb");
+    if (file) {
+        fread(eeprom, 1, sizeof(eeprom), file);
+        fclose(file);
+    }
+}
+
+static void store_eeprom(void) {
+    FILE *file = fopen(eeprom_path, "wb");
+    if (!file) {
+        perror(eeprom_path);
+        return;
+    }
+    fwrite(eeprom, 1, sizeof(eeprom), file);
+    fclose(file);
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s eeprom_file\n", argv[0]);
+        return 2;
+    }
+    eeprom_path = argv[1];
+    load_eeprom();
+    tuning_init();
+
+    uint8_t report[1 + REPORT_SIZE];
+    while (fread(report, sizeof(report), 1, stdin) == 1) {
+        process_raw_tuning(&report[1], REPORT_SIZE);
+
+        // Time enough for a pending save to finish, a byte per task call.
+        for (int i = 0; i < 64; i++) {
+            host_advance_ms(1);
+            tuning_task();
+        }
+        store_eeprom();
+    }
+    return 0;
+}
@@ -0,0 +1,177 @@
+#!/usr/bin/env python3
+"""Runs every command of tools/raw_tuning.py against raw_tuning_loopback.
+
+The loopback is features/raw_tuning.c and features/tuning.c built for the
+host, speaking the protocol over pipes instead of hidraw. Its counters have
+fixed values, see raw_tuning_loopback.c.
+
+    raw_tuning_test.py [path to raw_tuning_loopback]
+"""
+
+import contextlib
+import io
+import os
+import subprocess
+import sys
+import tempfile
+import unittest
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(HERE, ".."))
+
+import raw_tuning  # noqa: E402
+
+LOOPBACK = os.path.join(HERE, "raw_tuning_loopback")
+
+
+class Loopback(raw_tuning.Keyboard):
+    """The loopback program in place of a hidraw device. It keeps running
+    across command lines, as the keyboard would, until `stop()`."""
+
+    def __init__(self, eeprom):
+        self.process = subprocess.Popen([LOOPBACK, eeprom], stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+        self.read_fd = self.process.stdout.fileno()
+        self.write_fd = self.process.stdin.fileno()
+        self.timeout = 1.0
+
+    def close(self):
+        pass
+
+    def stop(self):
+        self.process.stdin.close()
+        self.process.wait()
+        self.process.stdout.close()
+
+
+class RawTuningTest(unittest.TestCase):
+    def setUp(self):
+        self.directory = tempfile.TemporaryDirectory()
+        self.eeprom = os.path.join(self.directory.name, "eeprom")
+        self.keyboard = Loopback(self.eeprom)
+
+    def tearDown(self):
+        self.keyboard.stop()
+        self.directory.cleanup()
+
+    def restart(self):
+        """Unplugs the keyboard and plugs it back in."""
+        self.keyboard.stop()
+        self.keyboard = Loopback(self.eeprom)
+
+    def run_cli(self, *argv):
+        """Runs a command line, returns its exit status and output."""
+        stdout = io.StringIO()
+        stderr = io.StringIO()
+        with contextlib.redirect_stdout(stdout), contextlib.redirect_stderr(stderr):
+            try:
+                status = raw_tuning.main(list(argv), open_keyboard=lambda device: self.keyboard)
+            except SystemExit as e:
+                status = e.code
+        return status, stdout.getvalue() + stderr.getvalue()
+
+    def cli(self, *argv):
+        status, output = self.run_cli(*argv)
+        self.assertEqual(status, 0, output)
+        return output
+
+    def test_version(self):
+        self.assertEqual(self.cli("version"), "protocol 1, tuning 2, 8 parameters\n")
+
+    def test_params(self):
+        lines = self.cli("params").splitlines()
+        self.assertEqual(len(lines), len(raw_tuning.PARAMS))
+        self.assertEqual(lines[0].split(), ["tapping_term", "175"])
+        self.assertEqual(lines[7].split(), ["eager_mods", "238"])
+
+    def test_get_set(self):
+        self.assertEqual(self.cli("get", "streak_timeout"), "100\n")
+        self.assertEqual(self.cli("set", "streak_timeout", "120"), "streak_timeout = 120\n")
+        self.assertEqual(self.cli("set", "7", "0xee"), "eager_mods = 238\n")
+
+    def test_set_out_of_range(self):
+        status, output = self.run_cli("set", "tapping_term", "70000")
+        self.assertEqual(status, 2)
+        self.assertIn("value 70000 out of range, 0 to 65535", output)
+        status, output = self.run_cli("set", "-1", "5")
+        self.assertEqual(status, 2)
+        status, output = self.run_cli("get", "256")
+        self.assertEqual(status, 2)
+        self.assertIn("parameter id 256 out of range", output)
+
+    def test_set_rejected_by_keyboard(self):
+        # Below the index finger difference, get_tapping_term() would wrap.
+        status, output = self.run_cli("set", "tapping_term", "20")
+        self.assertEqual(status, 1)
+        self.assertIn("invalid argument", output)
+        status, output = self.run_cli("get", "99")
+        self.assertEqual(status, 1)
+
+    def test_unknown_command(self):
+        # A command of a newer protocol gets a reply rather than a timeout.
+        for command in (0x00, raw_tuning.GET_STACK + 1, 0xFF):
+            with self.assertRaises(raw_tuning.TuningError) as raised:
+                self.keyboard.command(command)
+            self.assertEqual(raised.exception.status, raw_tuning.UNKNOWN_COMMAND)
+
+    def test_save_and_reset(self):
+        # Saved parameters are loaded after a restart, changes that weren't
+        # saved are not.
+        self.cli("set", "tapping_term", "190")
+        self.cli("save")
+        self.cli("set", "tapping_term", "150")
+        self.restart()
+        self.assertEqual(self.cli("get", "tapping_term"), "190\n")
+
+        self.assertEqual(self.cli("reset").splitlines()[0].split(), ["tapping_term", "175"])
+        self.cli("save")
+        self.restart()
+        self.assertEqual(self.cli("get", "tapping_term"), "175\n")
+
+    def test_counters(self):
+        self.assertEqual(self.cli("counters").split(), ["scan", "rate", "1234/s", "I2C", "errors", "5", "left", "half", "connected"])
+
+    def test_chatter(self):
+        lines = self.cli("chatter", "--clear").splitlines()
+        # Every key but 0:0, as col:row and count.
+        self.assertEqual(len(lines), raw_tuning.MATRIX_ROWS * raw_tuning.MATRIX_COLS - 1)
+        self.assertIn("5:13 135", lines)
+        self.assertEqual(self.cli("chatter"), "")
+
+    def test_presses(self):
+        lines = self.cli("presses").splitlines()
+        self.assertEqual(lines[0].split(), ["5:13", "1305"])
+        self.assertEqual(lines[-1].split(), ["1:0", "1"])
+
+    def test_tap_hold(self):
+        lines = self.cli("tap-hold").splitlines()
+        self.assertEqual(len(lines), 5)
+        self.assertEqual(lines[1].split(), ["2:3", "taps", "300", "1", "2", "3", "4", "5", "6"])
+        self.assertEqual(lines[2].split(), ["holds", "40", "0", "0", "7", "8", "9", "10"])
+        self.assertEqual(lines[3].split()[:3], ["5:12", "taps", "301"])
+
+    def test_misfires(self):
+        lines = self.cli("misfires").splitlines()
+        self.assertEqual(lines[1].split(), ["1:4", "200", "3", "2", "2.5%", "+0"])
+        self.assertEqual(lines[4].split(), ["1:4", "hold", "by", "chord", "settled", "after", "180", "ms,", "corrected", "after", "420", "ms"])
+
+    def test_speculation(self):
+        self.assertEqual(self.cli("speculation").split(), ["speculated", "900", "rolled", "back", "45", "(5.0%)"])
+
+    def test_stack(self):
+        lines = self.cli("stack").splitlines()
+        self.assertEqual(lines[0].split(), ["free", "at", "boot", "1100", "bytes"])
+        self.assertEqual(lines[1].split(), ["stack", "peak", "460", "bytes"])
+        self.assertEqual(lines[2].split(), ["headroom", "640", "bytes"])
+        depths = [line.split()[-2] for line in lines[5:]]
+        self.assertEqual(depths, ["100", "110", "120", "130", "140", "150"])
+
+    def test_clear_stats(self):
+        self.cli("clear-stats")
+        self.assertEqual(self.cli("presses"), "")
+        self.assertEqual(len(self.cli("tap-hold").splitlines()), 1)
+
+
+if __name__ == "__main__":
+    if len(sys.argv) > 1:
+        LOOPBACK = os.path.abspath(sys.argv.pop(1))
+    unittest.main()
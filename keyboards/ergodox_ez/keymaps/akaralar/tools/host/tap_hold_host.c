@@ -0,0 +1,208 @@
+// The keymap's tap-hold code as a shared library for tools/tap_hold_model.py:
+// features/achordion.c with the callbacks in tap_hold.c, as the keyboard runs
+// them. QMK's tapping, which settles records before Achordion sees them, is
+// part of QMK rather than the keymap and stays in the model.
+//
+// The model hands every record QMK would pass to process_record_user() to
+// `tap_hold_host_record()`, and moves time on with `tap_hold_host_advance()`,
+// which runs achordion_task() every millisecond as the scan loop does. What
+// comes out is queued in `tap_hold_host_entries` until the next call:
+//  - records that go on to the rest of the keymap, passed through or sent
+//    again by Achordion,
+//  - decisions, as misfire_settled() gets them from achordion_settled(),
+//  - mods applied and cleared eagerly.
+//
+// Records that go on are counted by features/key_stats.c, as in
+// process_record_user(), so that tests can read the duration histograms.
+//
+// Times are in ms since `tap_hold_host_start()`.
+
+#include <stdlib.h>
+
+#include "host.h"
+#include "keymap.h"
+#include "achordion.h"
+#include "key_stats.h"
+#include "misfire.h"
+#include "tuning.h"
+
+#define MAX_ENTRIES 256
+
+enum entry_kind { ENTRY_RECORD, ENTRY_SETTLED, ENTRY_MODS };
+
+typedef struct {
+    uint32_t time;       // When the entry was queued
+    uint32_t event_time; // Time of the record's event
+    uint16_t keycode;
+    uint8_t  kind;
+    uint8_t  row;
+    uint8_t  col;
+    uint8_t  pressed; // Also set for mods applied
+    uint8_t  tap;     // Tap count of a record
+    uint8_t  value;   // Reason of a decision with bit 7 set for holds, or mods
+} tap_hold_host_entry_t;
+
+tap_hold_host_entry_t tap_hold_host_entries[MAX_ENTRIES];
+uint16_t              tap_hold_host_entry_count;
+
+tuning_params_t tuning;
+layer_state_t   layer_state;
+layer_state_t   default_layer_state;
+keymap_state_t  keymap_state;
+
+// Keycode of the last press of each key, for the records Achordion sends
+// again. QMK looks them up in its source layer cache.
+static uint16_t keycodes[MATRIX_ROWS][MATRIX_COLS];
+
+static uint8_t mods;
+
+//------------------------------------------------------------------------------
+// Stand-ins for QMK
+//------------------------------------------------------------------------------
+static uint32_t now(void) {
+    return timer_read32();
+}
+
+// Full time of a 16-bit event time, which lies in the past.
+static uint32_t event_time(uint16_t time) {
+    return now() - (uint16_t)(timer_read() - time);
+}
+
+static tap_hold_host_entry_t *queue(uint8_t kind) {
+    if (tap_hold_host_entry_count == MAX_ENTRIES) {
+        fprintf(stderr, "tap_hold_host: more than %d entries in one call\n", MAX_ENTRIES);
+        abort();
+    }
+    tap_hold_host_entry_t *entry = &tap_hold_host_entries[tap_hold_host_entry_count++];
+    *entry                       = (tap_hold_host_entry_t){.time = now(), .kind = kind};
+    return entry;
+}
+
+static void queue_record(uint16_t keycode, keyrecord_t *record) {
+    process_key_stats(keycode, record);
+    tap_hold_host_entry_t *entry = queue(ENTRY_RECORD);
+    entry->event_time            = event_time(record->event.time);
+    entry->keycode               = keycode;
+    entry->row                   = record->event.key.row;
+    entry->col                   = record->event.key.col;
+    entry->pressed               = record->event.pressed;
+    entry->tap                   = record->tap.count;
+}
+
+void process_record(keyrecord_t *record) {
+    queue_record(keycodes[record->event.key.row][record->event.key.col], record);
+}
+
+static void queue_mods(uint8_t value, bool on) {
+    tap_hold_host_entry_t *entry = queue(ENTRY_MODS);
+    entry->value                 = value;
+    entry->pressed               = on;
+}
+
+void register_mods(uint8_t value) {
+    mods |= value;
+    queue_mods(value, true);
+}
+
+void unregister_mods(uint8_t value) {
+    mods &= ~value;
+    if (value) {
+        queue_mods(value, false);
+    }
+}
+
+uint8_t get_mods(void) {
+    return mods;
+}
+
+uint8_t mod_config(uint8_t mod) {
+    return mod;
+}
+
+void send_keyboard_report(void) {}
+
+uint8_t get_highest_layer(layer_state_t state) {
+    uint8_t layer = 0;
+    while (state >>= 1) {
+        layer++;
+    }
+    return layer;
+}
+
+void misfire_settled(uint16_t keycode, keyrecord_t *record, bool hold, uint8_t reason) {
+    tap_hold_host_entry_t *entry = queue(ENTRY_SETTLED);
+    entry->event_time            = event_time(record->event.time);
+    entry->keycode               = keycode;
+    entry->row                   = record->event.key.row;
+    entry->col                   = record->event.key.col;
+    entry->value                 = reason | (hold ? 0x80 : 0);
+}
+
+#ifdef MISFIRE_NUDGE
+// Tuning sweeps compare fixed tapping terms.
+int8_t misfire_term_offset(keypos_t key) {
+    return 0;
+}
+#endif
+
+//------------------------------------------------------------------------------
+// Library
+//------------------------------------------------------------------------------
+// Starts a replay at time 0. Achordion keeps its state from the previous one,
+// which has to end with all keys released and time for its timers to run out.
+void tap_hold_host_start(void) {
+    host_time_us              = 0;
+    tap_hold_host_entry_count = 0;
+    mods                      = 0;
+    key_stats_clear();
+}
+
+void tap_hold_host_set_param(uint8_t param, uint16_t value) {
+    if (param < TUNING_PARAM_COUNT) {
+        tuning.values[param] = value;
+    }
+}
+
+void tap_hold_host_set_layers(uint32_t state) {
+    layer_state = state;
+    tap_hold_layer_state_set(state);
+}
+
+static keyrecord_t make_record(uint8_t row, uint8_t col, bool pressed, uint8_t tap, uint32_t time) {
+    keyrecord_t record = {.event = MAKE_KEYEVENT(row, col, pressed)};
+    record.event.time  = time;
+    record.tap.count   = tap;
+    return record;
+}
+
+uint16_t tap_hold_host_tapping_term(uint16_t keycode, uint8_t row, uint8_t col) {
+    keyrecord_t record = make_record(row, col, true, 0, now());
+    return get_tapping_term(keycode, &record);
+}
+
+bool tap_hold_host_permissive_hold(uint16_t keycode, uint8_t row, uint8_t col) {
+    keyrecord_t record = make_record(row, col, true, 0, now());
+    return get_permissive_hold(keycode, &record);
+}
+
+// Runs the scan loop's tasks up to `time`.
+void tap_hold_host_advance(uint32_t time) {
+    tap_hold_host_entry_count = 0;
+    while (now() < time) {
+        host_advance_ms(1);
+        achordion_task();
+    }
+}
+
+// Hands a record to process_achordion() at `time`, as process_record_user()
+// does. The record's event happened at `event_time`.
+void tap_hold_host_record(uint16_t keycode, uint8_t row, uint8_t col, bool pressed, uint8_t tap, uint32_t event_time, uint32_t time) {
+    tap_hold_host_advance(time);
+    if (pressed) {
+        keycodes[row][col] = keycode;
+    }
+    keyrecord_t record = make_record(row, col, pressed, tap, event_time);
+    if (process_achordion(keycode, &record)) {
+        queue_record(keycode, &record);
+    }
+}
@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+"""Checks tap-hold decisions of the keymap through tools/tap_hold_model.py.
+
+The decisions come from features/achordion.c and the callbacks in tap_hold.c,
+built as libtap_hold.so. Keys are named by the Colemak character they type,
+and timed in ms with the default tuning: a 175 ms tapping term, 275 ms
+Achordion timeout and 100 ms typing streak.
+
+    tap_hold_test.py
+"""
+
+import ctypes
+import os
+import sys
+import unittest
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(HERE, ".."))
+
+import tap_hold_model as model  # noqa: E402
+
+
+class Recorder(model.Observer):
+    def __init__(self):
+        self.settles = []
+        self.tokens = []
+
+    def settled(self, key, record, hold, reason, now, other_key=None, other_record=None):
+        self.settles.append((key.name, hold, model.REASONS[reason]))
+
+    def output(self, token, record, now):
+        self.tokens.append(token)
+
+
+KEY_STATS_BUCKETS = 6
+
+
+class KeyStats(ctypes.Structure):
+    """key_stats_tap_hold_t, see features/key_stats.h."""
+    _fields_ = [("key", ctypes.c_uint8), ("taps", ctypes.c_uint16), ("holds", ctypes.c_uint16),
+                ("tap_durations", ctypes.c_uint8 * KEY_STATS_BUCKETS),
+                ("hold_durations", ctypes.c_uint8 * KEY_STATS_BUCKETS)]
+
+
+def key_stats(char_pos):
+    """Tap and hold duration histograms of a key, as features/key_stats.c
+    counted them in the last run."""
+    lib = model.load_firmware()
+    lib.key_stats_tap_hold.argtypes = [ctypes.c_uint8]
+    lib.key_stats_tap_hold.restype = ctypes.POINTER(KeyStats)
+    col, row = char_pos
+    slot = 0
+    while True:
+        stats = lib.key_stats_tap_hold(slot)
+        if not stats:
+            return None
+        if stats.contents.key == row | col << 4:
+            return list(stats.contents.tap_durations), list(stats.contents.hold_durations)
+        slot += 1
+
+
+class TapHoldTest(unittest.TestCase):
+    keymap = model.Keymap()
+    chars = keymap.char_positions(model.BASE_LAYERS)
+
+    def type(self, *steps):
+        """Runs `(time, char, "d" or "u")` steps, returns the recorder."""
+        events = [model.Event(time, self.chars[char][0], action == "d") for time, char, action in steps]
+        recorder = Recorder()
+        model.Simulator(self.keymap, model.BASE_LAYERS, observer=recorder).run(events)
+        return recorder
+
+    def test_opposite_hands_hold(self):
+        # Cmd on S with H tapped on the other hand, inside the tapping term.
+        typed = self.type((0, "s", "d"), (40, "h", "d"), (80, "h", "u"), (300, "s", "u"))
+        self.assertEqual(typed.settles, [("MT_C_S", True, "permissive hold")])
+        self.assertEqual(typed.tokens, ["<LGUI+KC_H>"])
+
+    def test_same_hand_tap(self):
+        # Alt on R held past its tapping term, then G on the same hand.
+        typed = self.type((0, "r", "d"), (200, "g", "d"), (230, "r", "u"), (260, "g", "u"))
+        self.assertEqual(typed.settles, [("MT_C_R", False, "chord")])
+        self.assertEqual(typed.tokens, ["r", "g"])
+
+    def test_nested_shortcut(self):
+        # Cmd + C on the same hand, C tapped within S.
+        typed = self.type((0, "s", "d"), (200, "c", "d"), (230, "c", "u"), (300, "s", "u"))
+        self.assertEqual(typed.settles, [("MT_C_S", True, "nested tap")])
+        self.assertEqual(typed.tokens, ["<LGUI+KC_C>"])
+
+    def test_timeout(self):
+        typed = self.type((0, "r", "d"), (400, "r", "u"))
+        self.assertEqual(typed.settles, [("MT_C_R", True, "timeout")])
+        self.assertEqual(typed.tokens, [])
+
+    def test_hold_duration(self):
+        # Held past the tapping term and the timeout, released at 300 ms: the
+        # 256-383 ms bucket, not the press time again.
+        self.type((0, "r", "d"), (300, "r", "u"))
+        self.assertEqual(key_stats(self.chars["r"][0]), ([0] * 6, [0, 0, 0, 0, 1, 0]))
+
+    def test_tap_duration(self):
+        # Settled as tapped by the chord rule when G is pressed at 200 ms,
+        # which is when the tap is released: the 192-255 ms bucket.
+        self.type((0, "r", "d"), (200, "g", "d"), (230, "r", "u"), (260, "g", "u"))
+        self.assertEqual(key_stats(self.chars["r"][0]), ([0, 0, 0, 1, 0, 0], [0] * 6))
+
+    def test_streak(self):
+        # Space pressed mid-word is held by permissive hold, and tapped again
+        # by the streak.
+        typed = self.type((0, "g", "d"), (20, " ", "d"), (40, "h", "d"), (60, "h", "u"), (90, " ", "u"), (95, "g", "u"))
+        self.assertEqual(typed.settles, [("LS_NAVI", False, "streak")])
+        self.assertEqual(typed.tokens, ["g", " ", "h"])
+
+    def test_streak_roll(self):
+        # "she" typed fast: H is pressed and released within S, which the
+        # streak settles as tapped, not as a nested Cmd + H.
+        typed = self.type((0, "h", "d"), (30, "h", "u"), (50, "s", "d"), (80, "h", "d"), (110, "h", "u"),
+                          (130, "s", "u"), (150, "e", "d"), (180, "e", "u"))
+        self.assertEqual(typed.settles, [("MT_C_S", False, "streak"), ("MT_C_E", False, "qmk")])
+        self.assertEqual(typed.tokens, ["h", "s", "h", "e"])
+
+    def test_streak_shortcut(self):
+        # Cmd + C with the right hand cmd on E isn't part of the streak.
+        typed = self.type((0, "h", "d"), (30, "h", "u"), (50, "e", "d"), (80, "c", "d"), (110, "c", "u"), (130, "e", "u"))
+        self.assertEqual(typed.settles, [("MT_C_E", True, "permissive hold")])
+        self.assertEqual(typed.tokens, ["h", "<RGUI+KC_C>"])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+"""Counts keymap reads per key event, with and without the shadow keymap.
+
+Replays key traces, or text typed by `Typist`, through the tap-hold model in
+tap_hold_model.py to follow the layer state, and counts the PROGMEM reads of
+each way of resolving keys:
+
+  - walk: QMK's layer_switch_get_layer() reads every active layer from the top
+    down until a key is not transparent, then the keycode is read again,
+  - shadow: features/shadow_keymap.c answers from RAM and only reads PROGMEM
+    to resolve keys again on a layer change.
+
+Releases are resolved once on the layer they were pressed on, as with QMK's
+layer cache. The shadow reads PROGMEM for them if that layer is no longer the
+resolved one.
+
+    lookup_bench.py traces/*.trace
+    lookup_bench.py --synthetic corpus.txt --layout qwerty
+
+Traces are read as in sweep_tuning.py.
+"""
+
+import argparse
+import glob
+import sys
+
+import sweep_tuning
+import tap_hold_model as model
+
+
+class Counter(model.Simulator):
+    def __init__(self, keymap, base_layers):
+        super().__init__(keymap, base_layers)
+        self.events = 0
+        self.walk_reads = 0
+        self.shadow_reads = 0
+        self.layer_changes = 0
+        self.press_layers = {}
+        self.seen = set()
+        self.shadow = {}
+        self.resolve_all()
+
+    def ordered(self, layers):
+        return sorted(layers, key=self.keymap.layer_index, reverse=True)
+
+    def lookup(self, pos, layers):
+        """Layer the key resolves to and the layers read to find it."""
+        reads = 0
+        for layer in self.ordered(layers):
+            reads += 1
+            if self.keymap.layers.get(layer, {}).get(pos, model.TRNS).kind != "trns":
+                return layer, reads
+        return self.ordered(self.base_layers)[0], reads
+
+    def resolve_all(self, changed=None):
+        active = self.active_layers()
+        highest = max(map(self.keymap.layer_index, changed)) if changed else None
+        for pos in model.LAYOUT_POSITIONS:
+            if highest is None or self.keymap.layer_index(self.shadow[pos]) <= highest:
+                self.shadow[pos], reads = self.lookup(pos, active)
+                if changed:
+                    self.shadow_reads += reads
+
+    def resolve(self, event):
+        # Buffered events are resolved again when the tapping state is
+        # flushed, count them once.
+        if event in self.seen:
+            return super().resolve(event)
+        self.seen.add(event)
+        self.events += 1
+        if event.pressed:
+            layer, reads = self.lookup(event.pos, self.active_layers())
+            self.walk_reads += reads + 1
+            self.press_layers[event.pos] = layer
+        else:
+            layer = self.press_layers.pop(event.pos, None)
+            self.walk_reads += 1
+            if layer != self.shadow[event.pos]:
+                self.shadow_reads += 1
+        return super().resolve(event)
+
+    def output(self, key, record, now):
+        before = self.active_layers()
+        super().output(key, record, now)
+        changed = before ^ self.active_layers()
+        if changed:
+            self.layer_changes += 1
+            self.resolve_all(changed)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("traces", nargs="*", help="trace files, or globs of them")
+    parser.add_argument("--synthetic", metavar="TEXT", help="type this text file instead of reading traces")
+    parser.add_argument("--wpm", type=float, default=70.0, help="typing speed of --synthetic")
+    parser.add_argument("--sigma", type=float, default=0.45, help="spread of key intervals of --synthetic")
+    parser.add_argument("--seed", type=int, default=1, help="random seed of --synthetic")
+    parser.add_argument("--layout", choices=sorted(model.LAYOUTS), default="colemak")
+    args = parser.parse_args()
+
+    keymap = model.Keymap(layout=model.LAYOUTS[args.layout])
+    base_layers = model.BASE_LAYERS
+    try:
+        if args.synthetic:
+            traces = [events for events, _ in sweep_tuning.synthetic_traces(args.synthetic, keymap, base_layers, args)]
+        else:
+            paths = [path for pattern in args.traces for path in sorted(glob.glob(pattern)) or [pattern]]
+            if not paths:
+                parser.error("no traces given")
+            traces = [sweep_tuning.read_trace(path) for path in paths]
+    except (OSError, sweep_tuning.TraceError) as e:
+        print("lookup_bench: %s" % e, file=sys.stderr)
+        return 1
+
+    events = walk = shadow = changes = 0
+    for trace in traces:
+        counter = Counter(keymap, base_layers)
+        counter.run(trace)
+        events += counter.events
+        walk += counter.walk_reads
+        shadow += counter.shadow_reads
+        changes += counter.layer_changes
+    if not events:
+        print("lookup_bench: no key events", file=sys.stderr)
+        return 1
+
+    print("key events      %8d" % events)
+    print("layer changes   %8d" % changes)
+    print("walk reads      %8d %6.2f/event" % (walk, walk / events))
+    print("shadow reads    %8d %6.2f/event" % (shadow, shadow / events))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,185 @@
+#!/usr/bin/env python3
+"""Generates keymap_packed.h, the keymap of keymap.c in the packed form.
+
+Each layer of `keymaps` is stored in the form that takes less flash, see
+features/packed_keymap.h:
+
+  - dense: all MATRIX_ROWS * MATRIX_COLS keycodes, as in `keymaps`,
+  - sparse: a fill keycode, KC_TRNS or KC_NO, a word per row with a bitmap of
+    the keys that are not the fill and the index of the row's first keycode,
+    then only those keycodes.
+
+Matrix positions without a key read as the fill on sparse layers.
+
+The output is decoded again and compared with keymap.c before it is written.
+rules.mk runs this when keymap.c changes, with the output in the build
+directory:
+
+    pack_keymap.py --output keymap_packed.h
+    pack_keymap.py --stats
+"""
+
+import argparse
+import sys
+
+import tap_hold_model as model
+
+MATRIX_ROWS = model.MATRIX_ROWS
+MATRIX_COLS = 6
+
+DENSE = 0xFF
+FILLS = {"trns": "KC_TRNS", "no": "KC_NO"}
+
+
+def layer_keys(keymap, name):
+    """C expression of each matrix position of a layer, None for no key."""
+    keys = [[None] * MATRIX_COLS for _ in range(MATRIX_ROWS)]
+    for (col, row), key in keymap.layers[name].items():
+        keys[row][col] = FILLS.get(key.kind) or " ".join(key.name.split())
+    return keys
+
+
+class Packed:
+    def __init__(self):
+        self.layers = []  # (name, fill, rows, keys)
+        self.rows = []
+        self.keys = []
+
+    def add_layer(self, name, keys):
+        positions = [key for row in keys for key in row]
+        dense_size = 2 * len(positions)
+
+        # The fill that leaves fewer keys, holes match either.
+        fill = min(FILLS.values(), key=lambda fill: sum(key not in (fill, None) for key in positions))
+        stored = sum(key not in (fill, None) for key in positions)
+        if 2 * MATRIX_ROWS + 2 * stored >= dense_size:
+            self.layers.append((name, "KC_NO", DENSE, len(self.keys)))
+            self.keys.extend(key or "KC_NO" for key in positions)
+            return
+
+        self.layers.append((name, fill, len(self.rows), len(self.keys)))
+        start = len(self.keys)
+        for row in keys:
+            bitmap = 0
+            first = len(self.keys) - start
+            for col, key in enumerate(row):
+                if key not in (fill, None):
+                    bitmap |= 1 << col
+                    self.keys.append(key)
+            self.rows.append((bitmap, first))
+
+    def keycode(self, layer, row, col):
+        """Same lookup as `packed_keymap_keycode()`."""
+        _, fill, rows, keys = self.layers[layer]
+        if rows == DENSE:
+            return self.keys[keys + row * MATRIX_COLS + col]
+        bitmap, first = self.rows[rows + row]
+        if not bitmap & (1 << col):
+            return fill
+        return self.keys[keys + first + bin(bitmap & ((1 << col) - 1)).count("1")]
+
+    def layer_keys(self, layer):
+        """Keycodes stored for a layer."""
+        start = self.layers[layer][3]
+        end = self.layers[layer + 1][3] if layer + 1 < len(self.layers) else len(self.keys)
+        return self.keys[start:end]
+
+    def size(self):
+        return 5 * len(self.layers) + 2 * len(self.rows) + 2 * len(self.keys) + 1
+
+
+def pack(keymap):
+    packed = Packed()
+    for name in keymap.layer_names:
+        if name not in keymap.layers:
+            raise ValueError("layer %s has no LAYOUT_ergodox in keymap.c" % name)
+        packed.add_layer(name, layer_keys(keymap, name))
+
+    for index, name in enumerate(keymap.layer_names):
+        keys = layer_keys(keymap, name)
+        for row in range(MATRIX_ROWS):
+            for col in range(MATRIX_COLS):
+                if keys[row][col] is not None and packed.keycode(index, row, col) != keys[row][col]:
+                    raise ValueError("%s %d:%d packed as %s instead of %s" % (
+                        name, col, row, packed.keycode(index, row, col), keys[row][col]))
+    return packed
+
+
+def render(packed):
+    lines = [
+        "// Generated by tools/pack_keymap.py from `keymaps` in keymap.c, do not edit.",
+        "// See features/packed_keymap.h.",
+        "",
+        "// clang-format off",
+        "",
+        "const packed_keymap_layer_t PROGMEM packed_keymap_layers[] = {",
+    ]
+    for name, fill, rows, keys in packed.layers:
+        rows = "PACKED_KEYMAP_DENSE" if rows == DENSE else "%3d" % rows
+        lines.append("    [%s] = {.fill = %-7s, .keys = %4d, .rows = %s}," % (name, fill, keys, rows))
+    lines += [
+        "};",
+        "const uint8_t PROGMEM NUM_PACKED_KEYMAP_LAYERS =",
+        "    sizeof(packed_keymap_layers) / sizeof(packed_keymap_layer_t);",
+        "",
+        "// Bitmap of the keys stored in the low byte, index of the first in the high byte.",
+        "const uint16_t PROGMEM packed_keymap_rows[] = {",
+    ]
+    if not packed.rows:
+        lines.append("    0,")
+    for i in range(0, len(packed.rows), MATRIX_ROWS // 2):
+        rows = packed.rows[i:i + MATRIX_ROWS // 2]
+        lines.append("    " + " ".join("0x%02X%02X," % (first, bitmap) for bitmap, first in rows))
+    lines += [
+        "};",
+        "",
+        "const uint16_t PROGMEM packed_keymap_keys[] = {",
+    ]
+    for index, (name, _, _, _) in enumerate(packed.layers):
+        lines.append("    // %s" % name)
+        keys = packed.layer_keys(index)
+        for i in range(0, len(keys), MATRIX_COLS):
+            lines.append("    " + " ".join("%s," % key for key in keys[i:i + MATRIX_COLS]))
+    lines += [
+        "};",
+        "",
+        "// clang-format on",
+        "",
+    ]
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--keymap", default=model.KEYMAP_C, help="keymap.c to read")
+    parser.add_argument("--output", help="header to write")
+    parser.add_argument("--stats", action="store_true", help="print the size of each layer")
+    args = parser.parse_args()
+
+    try:
+        keymap = model.Keymap(args.keymap)
+        packed = pack(keymap)
+    except (OSError, ValueError) as e:
+        print("pack_keymap: %s" % e, file=sys.stderr)
+        return 1
+
+    if args.stats:
+        for index, (name, fill, rows, _) in enumerate(packed.layers):
+            kind = "dense" if rows == DENSE else "sparse, %s fill" % fill
+            size = 2 * len(packed.layer_keys(index)) + (0 if rows == DENSE else 2 * MATRIX_ROWS)
+            print("%-6s %4d bytes  %s" % (name, size, kind))
+        unpacked = 2 * len(packed.layers) * MATRIX_ROWS * MATRIX_COLS
+        print("packed %4d bytes, keymaps %d bytes" % (packed.size(), unpacked))
+
+    if args.output:
+        try:
+            with open(args.output, "w") as f:
+                f.write(render(packed))
+        except OSError as e:
+            print("pack_keymap: %s" % e, file=sys.stderr)
+            return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
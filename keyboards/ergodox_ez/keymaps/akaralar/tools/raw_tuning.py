@@ -0,0 +1,365 @@
+#!/usr/bin/env python3
+"""Live tuning of the keyboard over raw HID.
+
+Host side of the protocol in features/raw_tuning.h. Talks to the keyboard
+through Linux hidraw, so it needs nothing beyond the standard library, only
+read/write access to the /dev/hidraw* device. The firmware has to be built
+with `RAW_TUNING=yes`, see rules.mk.
+
+    raw_tuning.py params
+    raw_tuning.py set tapping_term 180
+    raw_tuning.py set eager_mods 0xee
+    raw_tuning.py counters
+    raw_tuning.py chatter
+    raw_tuning.py presses
+    raw_tuning.py tap-hold
+    raw_tuning.py misfires
+    raw_tuning.py speculation
+    raw_tuning.py stack
+"""
+
+import argparse
+import glob
+import os
+import select
+import struct
+import sys
+
+RAW_USAGE_PAGE = 0xFF60
+RAW_USAGE_ID = 0x61
+REPORT_SIZE = 32
+PROTOCOL_VERSION = 1
+
+MATRIX_ROWS = 14
+MATRIX_COLS = 6
+
+# Commands, see `enum raw_tuning_command`.
+VERSION = 0x01
+GET_PARAM = 0x02
+SET_PARAM = 0x03
+GET_PARAMS = 0x04
+RESET_PARAMS = 0x05
+SAVE_PARAMS = 0x06
+GET_COUNTERS = 0x07
+GET_CHATTER = 0x08
+CLEAR_CHATTER = 0x09
+GET_PRESSES = 0x0A
+GET_TAP_HOLD = 0x0B
+CLEAR_STATS = 0x0C
+GET_MISFIRES = 0x0D
+GET_MISFIRE = 0x0E
+GET_SPECULATION = 0x0F
+GET_STACK = 0x10
+
+STATUS = {0: "ok", 1: "unknown command", 2: "invalid argument"}
+UNKNOWN_COMMAND = 1
+INVALID_ARGUMENT = 2
+
+# Hold duration buckets of the tap-hold statistics, see features/key_stats.h.
+BUCKETS = ["<96", "96-", "128-", "192-", "256-", "384+"]
+
+# Decision paths, see `enum achordion_settle_reason`.
+REASONS = ["qmk", "permissive hold", "timeout", "chord", "streak", "other hold", "nested tap"]
+MISFIRE_HOLD = 0x80
+
+# Stack depth marks, see `enum stack_mark`.
+STACK_MARKS = ["process_record_user", "achordion", "casemodes", "symbol macro", "dynamic macro", "position combo"]
+
+# Parameter names in id order, see `enum tuning_param`.
+PARAMS = [
+    "tapping_term",
+    "index_tap_term_diff",
+    "ring_pinky_tap_term_diff",
+    "space_tap_term_diff",
+    "achordion_timeout_diff",
+    "streak_timeout",
+    "space_streak_timeout",
+    "eager_mods",
+]
+
+
+class TuningError(Exception):
+    def __init__(self, message, status=None):
+        super().__init__(message)
+        self.status = status
+
+
+def has_raw_usage(descriptor):
+    """Whether a HID report descriptor declares the raw HID usage page and id."""
+    page = struct.pack("<BH", 0x06, RAW_USAGE_PAGE)
+    usage = bytes([0x09, RAW_USAGE_ID])
+    index = descriptor.find(page)
+    return index >= 0 and descriptor.find(usage, index) >= 0
+
+
+def find_device():
+    for path in sorted(glob.glob("/sys/class/hidraw/hidraw*")):
+        try:
+            with open(os.path.join(path, "device", "report_descriptor"), "rb") as f:
+                descriptor = f.read()
+        except OSError:
+            continue
+        if has_raw_usage(descriptor):
+            return os.path.join("/dev", os.path.basename(path))
+    raise TuningError("no raw HID device found")
+
+
+class Keyboard:
+    """The keyboard behind a hidraw device. Reports are written to `write_fd`
+    and replies read from `read_fd`, the same file for hidraw."""
+
+    def __init__(self, path, timeout=1.0):
+        self.read_fd = self.write_fd = os.open(path, os.O_RDWR)
+        self.timeout = timeout
+
+    def close(self):
+        os.close(self.read_fd)
+
+    def command(self, command, args=b""):
+        report = bytes([command]) + args
+        # hidraw expects the report id first, raw HID reports have none.
+        os.write(self.write_fd, b"\x00" + report.ljust(REPORT_SIZE, b"\x00"))
+        while True:
+            ready, _, _ = select.select([self.read_fd], [], [], self.timeout)
+            if not ready:
+                raise TuningError("no reply to command 0x%02x" % command)
+            reply = os.read(self.read_fd, REPORT_SIZE)
+            # Skip unrelated reports, for example from another host program.
+            if reply[0] == command:
+                break
+        status = reply[1]
+        if status != 0:
+            raise TuningError(STATUS.get(status, "status %d" % status), status)
+        return reply[2:]
+
+    def version(self):
+        protocol, tuning, count = self.command(VERSION)[:3]
+        if protocol != PROTOCOL_VERSION:
+            raise TuningError("unsupported protocol version %d" % protocol)
+        return tuning, count
+
+    def params(self):
+        result = self.command(GET_PARAMS)
+        count = result[0]
+        return list(struct.unpack_from("<%dH" % count, result, 1))
+
+    def set_param(self, param, value):
+        result = self.command(SET_PARAM, struct.pack("<BH", param, value))
+        return struct.unpack_from("<H", result, 1)[0]
+
+    def counters(self):
+        scan_rate, i2c_errors, connected = struct.unpack_from("<HHB", self.command(GET_COUNTERS))
+        return scan_rate, i2c_errors, bool(connected)
+
+    def chatter(self):
+        return [list(self.command(GET_CHATTER, bytes([row]))[1:1 + MATRIX_COLS])
+                for row in range(MATRIX_ROWS)]
+
+    def presses(self):
+        return [list(struct.unpack_from("<%dH" % MATRIX_COLS, self.command(GET_PRESSES, bytes([row])), 1))
+                for row in range(MATRIX_ROWS)]
+
+    def slots(self, command):
+        """Yields the results of a command taking a slot or index, until the
+        first one that is not in use."""
+        for slot in range(256):
+            try:
+                yield self.command(command, bytes([slot]))
+            except TuningError as e:
+                if e.status == INVALID_ARGUMENT:
+                    return
+                raise
+
+    def misfires(self):
+        """Yields (row, col, settles, tap misfires, hold misfires, term offset)."""
+        for result in self.slots(GET_MISFIRES):
+            key, settles, taps, holds, offset = struct.unpack_from("<BHHHb", result, 1)
+            yield key & 0x0F, key >> 4, settles, taps, holds, offset
+
+    def misfire_log(self):
+        """Yields (row, col, hold, reason, settle time, correction time), latest
+        first."""
+        for result in self.slots(GET_MISFIRE):
+            key, reason, settle_time, correction_time = struct.unpack_from("<BBHH", result, 1)
+            yield (key & 0x0F, key >> 4, bool(reason & MISFIRE_HOLD), reason & ~MISFIRE_HOLD,
+                   settle_time, correction_time)
+
+    def speculation(self):
+        """Returns (speculated presses, rollbacks)."""
+        return struct.unpack_from("<HH", self.command(GET_SPECULATION))
+
+    def stack(self):
+        """Returns (free RAM at boot, never used, [deepest depth per mark])."""
+        result = self.command(GET_STACK)
+        size, unused, count = struct.unpack_from("<HHB", result)
+        return size, unused, list(struct.unpack_from("<%dH" % count, result, 5))
+
+    def tap_holds(self):
+        """Yields (row, col, taps, holds, tap histogram, hold histogram)."""
+        buckets = len(BUCKETS)
+        for result in self.slots(GET_TAP_HOLD):
+            key, taps, holds = struct.unpack_from("<BHH", result, 1)
+            histograms = result[6:6 + 2 * buckets]
+            yield key & 0x0F, key >> 4, taps, holds, list(histograms[:buckets]), list(histograms[buckets:])
+
+
+def param_id(name):
+    if name.isdigit():
+        if int(name) > 0xFF:
+            raise argparse.ArgumentTypeError("parameter id %s out of range, 0 to 255" % name)
+        return int(name)
+    try:
+        return PARAMS.index(name)
+    except ValueError:
+        raise argparse.ArgumentTypeError("unknown parameter %r" % name)
+
+
+def param_value(value):
+    """A parameter value, every parameter is a uint16_t."""
+    try:
+        number = int(value, 0)
+    except ValueError:
+        raise argparse.ArgumentTypeError("invalid value %r" % value)
+    if not 0 <= number <= 0xFFFF:
+        raise argparse.ArgumentTypeError("value %s out of range, 0 to 65535" % value)
+    return number
+
+
+def param_name(param):
+    return PARAMS[param] if param < len(PARAMS) else "param_%d" % param
+
+
+def print_params(keyboard):
+    for param, value in enumerate(keyboard.params()):
+        print("%-26s %5d" % (param_name(param), value))
+
+
+def print_chatter(keyboard):
+    # Same position labels as the keymap, col:row.
+    for row, counts in enumerate(keyboard.chatter()):
+        for col, count in enumerate(counts):
+            if count:
+                print("%d:%-2d %3d" % (col, row, count))
+
+
+def print_presses(keyboard):
+    counts = [(count, col, row)
+              for row, row_counts in enumerate(keyboard.presses())
+              for col, count in enumerate(row_counts) if count]
+    for count, col, row in sorted(counts, reverse=True):
+        print("%d:%-2d %5d" % (col, row, count))
+
+
+def print_tap_holds(keyboard):
+    print("key         %s" % " ".join("%5s" % bucket for bucket in BUCKETS))
+    for row, col, taps, holds, tap_histogram, hold_histogram in keyboard.tap_holds():
+        print("%d:%-2d taps  %5d %s" % (col, row, taps, " ".join("%5d" % n for n in tap_histogram)))
+        print("     holds %5d %s" % (holds, " ".join("%5d" % n for n in hold_histogram)))
+
+
+def print_misfires(keyboard):
+    print("key  settles  taps holds   rate offset")
+    for row, col, settles, taps, holds, offset in keyboard.misfires():
+        rate = 100.0 * (taps + holds) / settles if settles else 0.0
+        print("%d:%-2d %7d %5d %5d %5.1f%% %+6d" % (col, row, settles, taps, holds, rate, offset))
+    print()
+    print("latest misfires")
+    for row, col, hold, reason, settle_time, correction_time in keyboard.misfire_log():
+        print("%d:%-2d %-4s by %-15s settled after %4d ms, corrected after %4d ms" % (
+            col, row, "hold" if hold else "tap",
+            REASONS[reason] if reason < len(REASONS) else str(reason), settle_time, correction_time))
+
+
+def print_stack(keyboard):
+    size, unused, depths = keyboard.stack()
+    print("free at boot %5d bytes" % size)
+    print("stack peak   %5d bytes" % (size - unused))
+    print("headroom     %5d bytes" % unused)
+    print()
+    print("deepest stack at")
+    for mark, depth in enumerate(depths):
+        name = STACK_MARKS[mark] if mark < len(STACK_MARKS) else "mark %d" % mark
+        print("  %-20s %5d bytes" % (name, depth))
+
+
+def main(argv=None, open_keyboard=None):
+    """Runs the command line in `argv`. The keyboard is opened with
+    `open_keyboard(device)`, a hidraw device by default."""
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--device", help="hidraw device, found by usage page if omitted")
+    commands = parser.add_subparsers(dest="command", required=True)
+    commands.add_parser("version", help="show protocol and parameter versions")
+    commands.add_parser("params", help="show all parameters")
+    get = commands.add_parser("get", help="show a parameter")
+    get.add_argument("param", type=param_id)
+    set_ = commands.add_parser("set", help="change a parameter")
+    set_.add_argument("param", type=param_id)
+    set_.add_argument("value", type=param_value)
+    commands.add_parser("reset", help="restore default parameters")
+    commands.add_parser("save", help="save parameters to EEPROM now")
+    commands.add_parser("counters", help="show matrix counters")
+    chatter = commands.add_parser("chatter", help="show keys that bounced")
+    chatter.add_argument("--clear", action="store_true", help="clear counters afterwards")
+    commands.add_parser("presses", help="show press counts, most pressed first")
+    commands.add_parser("tap-hold", help="show tap-hold outcomes and hold durations in ms")
+    commands.add_parser("misfires", help="show misfire rates and the latest misfires")
+    commands.add_parser("speculation", help="show how often speculative taps were rolled back")
+    commands.add_parser("stack", help="show stack usage since boot and its depth at marked places")
+    commands.add_parser("clear-stats", help="clear key statistics, misfires, speculation counters and stack marks")
+    args = parser.parse_args(argv)
+    if open_keyboard is None:
+        open_keyboard = lambda device: Keyboard(device or find_device())
+
+    try:
+        keyboard = open_keyboard(args.device)
+        try:
+            tuning, count = keyboard.version()
+            if args.command == "version":
+                print("protocol %d, tuning %d, %d parameters" % (PROTOCOL_VERSION, tuning, count))
+            elif args.command == "params":
+                print_params(keyboard)
+            elif args.command == "get":
+                result = keyboard.command(GET_PARAM, bytes([args.param]))
+                print(struct.unpack_from("<H", result, 1)[0])
+            elif args.command == "set":
+                value = keyboard.set_param(args.param, args.value)
+                print("%s = %d" % (param_name(args.param), value))
+            elif args.command == "reset":
+                keyboard.command(RESET_PARAMS)
+                print_params(keyboard)
+            elif args.command == "save":
+                keyboard.command(SAVE_PARAMS)
+            elif args.command == "counters":
+                scan_rate, i2c_errors, connected = keyboard.counters()
+                print("scan rate    %5d/s" % scan_rate)
+                print("I2C errors   %5d" % i2c_errors)
+                print("left half    %s" % ("connected" if connected else "disconnected"))
+            elif args.command == "chatter":
+                print_chatter(keyboard)
+                if args.clear:
+                    keyboard.command(CLEAR_CHATTER)
+            elif args.command == "presses":
+                print_presses(keyboard)
+            elif args.command == "tap-hold":
+                print_tap_holds(keyboard)
+            elif args.command == "misfires":
+                print_misfires(keyboard)
+            elif args.command == "speculation":
+                speculations, rollbacks = keyboard.speculation()
+                rate = 100.0 * rollbacks / speculations if speculations else 0.0
+                print("speculated   %5d" % speculations)
+                print("rolled back  %5d (%.1f%%)" % (rollbacks, rate))
+            elif args.command == "stack":
+                print_stack(keyboard)
+            elif args.command == "clear-stats":
+                keyboard.command(CLEAR_STATS)
+        finally:
+            keyboard.close()
+    except (OSError, TuningError) as e:
+        print("raw_tuning: %s" % e, file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,209 @@
+#!/usr/bin/env python3
+"""Counts which tap-hold rules a text corpus triggers, per bigram.
+
+Types a plain-text corpus on the keymap with random timing (see `Typist` in
+tap_hold_model.py) and records how each tap-hold key is settled when the next
+key is pressed while it is still undecided:
+
+  - opposite hands: achordion_chord() settles it as held, a misfire when
+    typing text,
+  - thumb: held because the other key is on the thumb cluster (col >= 4),
+  - same hand: settled as tapped by the chord rule,
+  - layer tap: layer-tap keys are always held by the chord rule,
+  - streak: settled as tapped by the typing streak,
+  - other hold: the other key is a tap-hold key pressed while held,
+  - nested tap: held because the other key was tapped within it.
+
+Each row is a bigram of the tap-hold key's character and the next one, with
+the holds it caused first, to compare layouts and mod placements before
+changing them:
+
+    roll_analyzer.py corpus.txt --layout qwerty --wpm 80 --wpm-sd 20
+
+The corpus is read in chunks that are typed in parallel, so memory stays
+bounded however large it is. Each chunk starts with all keys released.
+"""
+
+import argparse
+import collections
+import multiprocessing
+import os
+import random
+import re
+import sys
+import threading
+
+import tap_hold_model as model
+
+RULES = ["opposite hands", "thumb", "same hand", "layer tap", "streak", "other hold", "nested tap"]
+HOLDS = {"opposite hands", "thumb", "layer tap", "other hold", "nested tap"}
+
+
+class Counter(model.Observer):
+    def __init__(self, keymap):
+        self.keymap = keymap
+        # (tap-hold character, next character) -> rule -> count
+        self.bigrams = collections.defaultdict(collections.Counter)
+
+    def settled(self, key, record, hold, reason, now, other_key=None, other_record=None):
+        if other_key is None:
+            return
+        self.bigrams[(char(key), char(other_key))][self.rule(key, record, hold, reason, other_record)] += 1
+
+    def rule(self, key, record, hold, reason, other_record):
+        """Names the branch of achordion_chord() in tap_hold.c that gave a
+        chord decision, from the keys involved."""
+        if reason == model.STREAK:
+            return "streak"
+        if reason == model.OTHER_HOLD:
+            return "other hold"
+        if reason == model.NESTED_TAP:
+            return "nested tap"
+        if not hold:
+            return "same hand"
+        if key.name in self.keymap.layer_taps:
+            return "layer tap"
+        if other_record.pos[0] >= 4:
+            return "thumb"
+        return "opposite hands"
+
+
+def char(key):
+    if key.tap in model.CHARS:
+        return model.CHARS[key.tap][0]
+    return "<%s>" % key.name
+
+
+def show(c):
+    return {" ": "SPC", "\n": "ENT", "\t": "TAB"}.get(c, c)
+
+
+#------------------------------------------------------------------------------
+# Workers
+#------------------------------------------------------------------------------
+worker = {}
+
+
+def init_worker(keymap, base_layers, args):
+    worker.update(keymap=keymap, base_layers=base_layers, args=args)
+
+
+def analyze(task):
+    """Types one chunk and returns its bigram counts."""
+    index, text = task
+    args = worker["args"]
+    # Seeded per chunk, so results don't depend on the order chunks run in.
+    rng = random.Random(args.seed * 1000003 + index)
+    wpm = max(10.0, rng.gauss(args.wpm, args.wpm_sd))
+    typist = model.Typist(worker["keymap"], worker["base_layers"], rng, wpm=wpm, sigma=args.sigma,
+                          hold=args.hold, hold_sd=args.hold_sd)
+    counter = Counter(worker["keymap"])
+    events, _ = typist.events(" ".join(text.split()))
+    model.Simulator(worker["keymap"], worker["base_layers"], args.params, counter).run(events)
+    return {bigram: dict(rules) for bigram, rules in counter.bigrams.items()}
+
+
+def chunks(f, size):
+    """Yields (index, text) pieces of about `size` characters, split at
+    whitespace so that words stay whole."""
+    rest = ""
+    index = 0
+    while True:
+        data = f.read(size)
+        if not data:
+            break
+        data = rest + data
+        split = max(data.rfind(" "), data.rfind("\n"))
+        if split <= 0:
+            rest = data
+            if len(rest) < 16 * size:
+                continue
+            split = len(rest)
+        rest = data[split:]
+        yield index, data[:split]
+        index += 1
+    if rest.strip():
+        yield index, rest
+
+
+def bounded(tasks, slots):
+    """Yields from `tasks` only while a slot is free. Pool.imap_unordered()
+    reads its input as fast as it can, this keeps it from reading the whole
+    corpus ahead of the workers."""
+    for task in tasks:
+        slots.acquire()
+        yield task
+
+
+#------------------------------------------------------------------------------
+# Command line
+#------------------------------------------------------------------------------
+def param(text):
+    m = re.match(r"(\w+)=(\w+)$", text)
+    if not m or m.group(1) not in model.PARAMS:
+        raise argparse.ArgumentTypeError("expected <param>=<value>, with one of %s" % ", ".join(model.PARAMS))
+    return m.group(1), int(m.group(2), 0)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("corpus", help="plain-text corpus, - for standard input")
+    parser.add_argument("--layout", choices=sorted(model.LAYOUTS), default="colemak")
+    parser.add_argument("--wpm", type=float, default=70.0, help="mean typing speed")
+    parser.add_argument("--wpm-sd", type=float, default=15.0, help="spread of the typing speed between chunks")
+    parser.add_argument("--sigma", type=float, default=0.45, help="spread of key intervals within a chunk")
+    parser.add_argument("--hold", type=float, default=95.0, help="mean time a key is held in ms")
+    parser.add_argument("--hold-sd", type=float, default=25.0, help="spread of the hold time in ms")
+    parser.add_argument("--param", type=param, action="append", default=[], metavar="NAME=VALUE",
+                        help="tuning parameter, see tuning.h, defaults as in tuning.c")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--chunk", type=int, default=4096, help="characters per chunk")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count(), help="worker processes")
+    parser.add_argument("--top", type=int, default=40, help="bigrams to show, 0 for all")
+    args = parser.parse_args()
+    args.params = dict(args.param)
+
+    keymap = model.Keymap(layout=model.LAYOUTS[args.layout])
+    base_layers = model.BASE_LAYERS
+    model.build_firmware()
+    totals = collections.defaultdict(collections.Counter)
+    slots = threading.BoundedSemaphore(args.jobs * 4)
+
+    try:
+        f = sys.stdin if args.corpus == "-" else open(args.corpus, errors="replace")
+    except OSError as e:
+        print("roll_analyzer: %s" % e, file=sys.stderr)
+        return 1
+    with f, multiprocessing.Pool(args.jobs, init_worker, (keymap, base_layers, args)) as pool:
+        for result in pool.imap_unordered(analyze, bounded(chunks(f, args.chunk), slots)):
+            slots.release()
+            for bigram, rules in result.items():
+                totals[bigram].update(rules)
+
+    by_rule = collections.Counter()
+    for rules in totals.values():
+        by_rule.update(rules)
+    settles = sum(by_rule.values())
+    if not settles:
+        print("roll_analyzer: no tap-hold key was followed by another key", file=sys.stderr)
+        return 1
+
+    for rule in RULES:
+        print("%-15s %9d %5.1f%%" % (rule, by_rule[rule], 100.0 * by_rule[rule] / settles))
+    print()
+
+    def holds(rules):
+        return sum(n for rule, n in rules.items() if rule in HOLDS)
+
+    rows = sorted(totals.items(), key=lambda item: (-holds(item[1]), -sum(item[1].values()), item[0]))
+    if args.top:
+        rows = rows[:args.top]
+    print("bigram   %8s %8s" % ("total", "holds") + "".join(" %14s" % rule for rule in RULES))
+    for (first, second), rules in rows:
+        print("%-8s %8d %8d" % (show(first) + " " + show(second), sum(rules.values()), holds(rules))
+              + "".join(" %14d" % rules[rule] for rule in RULES))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
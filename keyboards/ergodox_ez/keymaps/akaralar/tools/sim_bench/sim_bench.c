@@ -0,0 +1,276 @@
+// Cycle counts of the firmware on a simulated ATmega32U4.
+//
+// Runs a firmware built with SIM_BENCH=yes (see features/sim_bench.h) in
+// simavr, presses keys from trace files by writing `sim_bench_matrix`, and
+// counts the cycles between the marks the firmware writes to GPIOR0:
+//
+//   - scan: from one matrix scan to the next, a whole pass of the main loop,
+//   - record: a `process_record_user()` call, including the calls it makes
+//     again for replayed events.
+//
+//     sim_bench -m 0x800123 firmware.elf traces/*.trace
+//
+// The matrix address is the `sim_bench_matrix` symbol of the ELF file, see
+// `make sim-bench` in the userspace Makefile. Traces are the native format of
+// tools/sweep_tuning.py, `<time> <col>:<row> <d|u>` per line.
+//
+// The report has one line per trace and measurement, with cycles at 16 MHz, so
+// that reports of two commits can be compared with diff.
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "sim_io.h"
+
+#define FREQUENCY 16000000UL
+#define CYCLES_PER_MS (FREQUENCY / 1000)
+
+// GPIOR0 in the data address space.
+#define GPIOR0_ADDR 0x3E
+
+#define MATRIX_ROWS 14
+#define MATRIX_COLS 6
+
+// Time allowed for the firmware to boot, and to settle after a trace.
+#define BOOT_MS 2000
+#define SETTLE_MS 1000
+
+// Same values as `enum sim_bench_mark` in features/sim_bench.h.
+enum mark {
+    MARK_SCAN = 1,
+    MARK_RECORD,
+    MARK_RECORD_END,
+};
+
+//------------------------------------------------------------------------------
+// Samples
+//------------------------------------------------------------------------------
+typedef struct {
+    uint32_t *cycles;
+    size_t    count;
+    size_t    size;
+} samples_t;
+
+static void samples_add(samples_t *samples, uint32_t cycles) {
+    if (samples->count == samples->size) {
+        samples->size   = samples->size ? samples->size * 2 : 1024;
+        samples->cycles = realloc(samples->cycles, samples->size * sizeof(uint32_t));
+        if (!samples->cycles) {
+            perror("sim_bench");
+            exit(1);
+        }
+    }
+    samples->cycles[samples->count++] = cycles;
+}
+
+static int compare_cycles(const void *a, const void *b) {
+    const uint32_t x = *(const uint32_t *)a;
+    const uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void samples_print(const char *trace, const char *name, samples_t *samples) {
+    if (!samples->count) {
+        printf("%-24s %-8s %8d\n", trace, name, 0);
+        return;
+    }
+    qsort(samples->cycles, samples->count, sizeof(uint32_t), compare_cycles);
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < samples->count; i++) {
+        total += samples->cycles[i];
+    }
+    printf("%-24s %-8s %8zu mean %8llu p50 %8u p99 %8u max %8u\n", trace, name, samples->count,
+           (unsigned long long)(total / samples->count), samples->cycles[samples->count / 2],
+           samples->cycles[samples->count * 99 / 100], samples->cycles[samples->count - 1]);
+}
+
+//------------------------------------------------------------------------------
+// Marks
+//------------------------------------------------------------------------------
+#define MAX_DEPTH 16
+
+static samples_t scans;
+static samples_t records;
+static bool      measuring = false;
+
+static avr_cycle_count_t last_scan = 0;
+static avr_cycle_count_t record_starts[MAX_DEPTH];
+static uint8_t           record_depth = 0;
+
+static void mark_written(struct avr_t *avr, avr_io_addr_t addr, uint8_t value, void *param) {
+    avr->data[addr] = value;
+
+    switch (value) {
+        case MARK_SCAN:
+            if (measuring && last_scan) {
+                samples_add(&scans, avr->cycle - last_scan);
+            }
+            last_scan = avr->cycle;
+            break;
+        case MARK_RECORD:
+            // Replayed events call `process_record_user()` from inside it.
+            if (record_depth < MAX_DEPTH) {
+                record_starts[record_depth] = avr->cycle;
+            }
+            record_depth++;
+            break;
+        case MARK_RECORD_END:
+            if (record_depth == 0) {
+                break;
+            }
+            record_depth--;
+            if (measuring && record_depth < MAX_DEPTH) {
+                samples_add(&records, avr->cycle - record_starts[record_depth]);
+            }
+            break;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Simulation
+//------------------------------------------------------------------------------
+static avr_t   *avr;
+static uint16_t matrix_addr;
+
+static bool run_until(avr_cycle_count_t cycle) {
+    while (avr->cycle < cycle) {
+        const int state = avr_run(avr);
+        if (state == cpu_Done || state == cpu_Crashed) {
+            fprintf(stderr, "sim_bench: firmware stopped at cycle %llu\n", (unsigned long long)avr->cycle);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void set_key(uint8_t row, uint8_t col, bool pressed) {
+    uint8_t *cols = &avr->data[matrix_addr + row];
+    *cols = pressed ? *cols | (1 << col) : *cols & ~(1 << col);
+}
+
+static bool run_trace(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "sim_bench: %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    memset(&avr->data[matrix_addr], 0, MATRIX_ROWS);
+    scans.count   = 0;
+    records.count = 0;
+    last_scan     = 0;
+    measuring     = true;
+
+    // Trace times are relative to its first event.
+    const avr_cycle_count_t start      = avr->cycle + CYCLES_PER_MS;
+    bool                    first      = true;
+    unsigned long           first_time = 0;
+    unsigned                number     = 0;
+    bool                    ok         = true;
+    char                    line[128];
+
+    while (ok && fgets(line, sizeof(line), f)) {
+        number++;
+        char *comment = strchr(line, '#');
+        if (comment) {
+            *comment = '\0';
+        }
+
+        unsigned long time;
+        unsigned      col, row;
+        char          action;
+        if (sscanf(line, "%lu %u:%u %c", &time, &col, &row, &action) != 4) {
+            continue;
+        }
+        if (row >= MATRIX_ROWS || col >= MATRIX_COLS || (action != 'd' && action != 'u')) {
+            fprintf(stderr, "sim_bench: %s:%u: bad event\n", path, number);
+            ok = false;
+            break;
+        }
+        if (first) {
+            first      = false;
+            first_time = time;
+        }
+        ok = run_until(start + (avr_cycle_count_t)(time - first_time) * CYCLES_PER_MS);
+        set_key(row, col, action == 'd');
+    }
+    fclose(f);
+
+    if (ok) {
+        memset(&avr->data[matrix_addr], 0, MATRIX_ROWS);
+        ok = run_until(avr->cycle + SETTLE_MS * CYCLES_PER_MS);
+    }
+    measuring = false;
+
+    if (ok) {
+        const char *name = strrchr(path, '/');
+        name             = name ? name + 1 : path;
+        samples_print(name, "scan", &scans);
+        samples_print(name, "record", &records);
+    }
+    return ok;
+}
+
+//------------------------------------------------------------------------------
+// Command line
+//------------------------------------------------------------------------------
+static void usage(void) {
+    fprintf(stderr, "usage: sim_bench -m <sim_bench_matrix address> <firmware.elf> <trace>...\n");
+    exit(2);
+}
+
+int main(int argc, char *argv[]) {
+    unsigned long address = 0;
+    int           arg     = 1;
+
+    if (arg + 1 < argc && strcmp(argv[arg], "-m") == 0) {
+        // Data addresses in AVR ELF files are offset by 0x800000.
+        address = strtoul(argv[arg + 1], NULL, 16) & 0xFFFF;
+        arg += 2;
+    }
+    if (!address || argc - arg < 2) {
+        usage();
+    }
+    matrix_addr = address;
+
+    elf_firmware_t firmware;
+    memset(&firmware, 0, sizeof(firmware));
+    if (elf_read_firmware(argv[arg], &firmware) != 0) {
+        fprintf(stderr, "sim_bench: can't read %s\n", argv[arg]);
+        return 1;
+    }
+
+    avr = avr_make_mcu_by_name("atmega32u4");
+    if (!avr) {
+        fprintf(stderr, "sim_bench: simavr has no atmega32u4\n");
+        return 1;
+    }
+    avr_init(avr);
+    firmware.frequency = FREQUENCY;
+    avr_load_firmware(avr, &firmware);
+    avr_register_io_write(avr, GPIOR0_ADDR, mark_written, NULL);
+
+    // USB stays unattached, reports are dropped by LUFA.
+    if (!run_until(BOOT_MS * CYCLES_PER_MS)) {
+        return 1;
+    }
+    if (!last_scan) {
+        fprintf(stderr, "sim_bench: no matrix scan after %d ms, was the firmware built with SIM_BENCH=yes?\n",
+                BOOT_MS);
+        return 1;
+    }
+
+    for (arg++; arg < argc; arg++) {
+        if (!run_trace(argv[arg])) {
+            return 1;
+        }
+    }
+    return 0;
+}
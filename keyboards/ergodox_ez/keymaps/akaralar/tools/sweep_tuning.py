@@ -0,0 +1,280 @@
+#!/usr/bin/env python3
+"""Sweeps tap-hold tuning parameters over recorded key traces.
+
+Each trace is replayed through the tap-hold model in tap_hold_model.py, which
+runs the keymap's Achordion code built for the host, for every combination of
+the swept parameters, and each combination is scored by
+
+  - errors: edits needed to turn the output into the intended text,
+  - latency: mean time from a key press to the character it typed,
+  - flashes: eager mods applied to keys that then turned out to be taps.
+
+The combinations that no other combination beats on all three scores are
+printed, best first by errors. The first of them can be written out as a
+config.h snippet (see the TUNING_DEFAULT_* defines in features/tuning.c) or as
+an image of one tuning EEPROM slot.
+
+    sweep_tuning.py traces/*.trace --tapping-term 150:220:10 --streak-timeout 60,100,140
+    sweep_tuning.py --synthetic corpus.txt --wpm 90 --header tuning_defaults.h
+
+A trace is a text file with one key event per line, `<time> <col>:<row> <d|u>`
+with the time in ms and the position labels of keymap.c, `#` starts a comment.
+QMK console logs with `EVENT:` lines (debug_enable) are read as well. The
+intended text goes in a file next to the trace with the extension `.txt`.
+"""
+
+import argparse
+import difflib
+import glob
+import itertools
+import multiprocessing
+import os
+import random
+import re
+import struct
+import sys
+
+import tap_hold_model as model
+
+TUNING_H = os.path.join(os.path.dirname(os.path.abspath(__file__)), os.pardir, "features", "tuning.h")
+
+SCORES = ["errors", "latency", "flashes"]
+
+
+#------------------------------------------------------------------------------
+# Traces
+#------------------------------------------------------------------------------
+class TraceError(Exception):
+    pass
+
+
+NATIVE_EVENT = re.compile(r"(\d+)\s+(\d+):(\d+)\s+([du])$")
+# QMK's debug_event(): row and column as hex, then d/u and the 16-bit time.
+QMK_EVENT = re.compile(r"EVENT:\s*([0-9A-Fa-f]{2})([0-9A-Fa-f]{2})([du])\((\d+)\)")
+
+
+def read_trace(path):
+    events = []
+    last_time, offset = None, 0
+    with open(path) as f:
+        for number, line in enumerate(f, 1):
+            line = line.split("#", 1)[0].strip()
+            if not line:
+                continue
+            m = NATIVE_EVENT.match(line)
+            if m:
+                time, col, row, pressed = int(m.group(1)), int(m.group(2)), int(m.group(3)), m.group(4) == "d"
+            else:
+                m = QMK_EVENT.search(line)
+                if not m:
+                    continue
+                row, col, pressed = int(m.group(1), 16), int(m.group(2), 16), m.group(3) == "d"
+                # The keyboard timer wraps around every 65.5 s.
+                time = int(m.group(4)) + offset
+                if last_time is not None and time < last_time - 0x8000:
+                    offset += 0x10000
+                    time += 0x10000
+            if row >= model.MATRIX_ROWS:
+                raise TraceError("%s:%d: no row %d" % (path, number, row))
+            last_time = time
+            events.append(model.Event(time, (col, row), pressed))
+    if not events:
+        raise TraceError("%s: no key events" % path)
+    events.sort(key=lambda e: (e.time, not e.pressed))
+    return events
+
+
+def read_intended(path):
+    text_path = os.path.splitext(path)[0] + ".txt"
+    try:
+        with open(text_path) as f:
+            return list(f.read().rstrip("\n"))
+    except OSError:
+        raise TraceError("%s: no intended text in %s" % (path, text_path))
+
+
+def synthetic_traces(path, keymap, base_layers, args):
+    """Types a text file paragraph by paragraph with `Typist`."""
+    with open(path) as f:
+        paragraphs = [p.strip() for p in f.read().split("\n\n") if p.strip()]
+    rng = random.Random(args.seed)
+    typist = model.Typist(keymap, base_layers, rng, wpm=args.wpm, sigma=args.sigma)
+    traces = []
+    for paragraph in paragraphs:
+        events, typed = typist.events(" ".join(paragraph.split()))
+        if events:
+            traces.append((events, typed))
+    return traces
+
+
+#------------------------------------------------------------------------------
+# Scoring
+#------------------------------------------------------------------------------
+class Scorer(model.Observer):
+    def __init__(self):
+        self.tokens = []
+        self.latency = 0
+        self.flashes = 0
+
+    def output(self, token, record, now):
+        self.tokens.append(token)
+        self.latency += now - record.time
+
+    def eager_flash(self, key, record):
+        self.flashes += 1
+
+
+def edit_count(intended, output):
+    count = 0
+    for tag, i1, i2, j1, j2 in difflib.SequenceMatcher(None, intended, output, autojunk=False).get_opcodes():
+        if tag != "equal":
+            count += max(i2 - i1, j2 - j1)
+    return count
+
+
+# Set up once per worker process, so that the traces are not sent with every
+# combination.
+worker = {}
+
+
+def init_worker(keymap, base_layers, traces):
+    worker.update(keymap=keymap, base_layers=base_layers, traces=traces)
+
+
+def score(params):
+    errors = latency = outputs = flashes = 0
+    for events, intended in worker["traces"]:
+        scorer = Scorer()
+        model.Simulator(worker["keymap"], worker["base_layers"], params, scorer).run(events)
+        errors += edit_count(intended, scorer.tokens)
+        latency += scorer.latency
+        outputs += len(scorer.tokens)
+        flashes += scorer.flashes
+    return params, (errors, latency / outputs if outputs else 0.0, flashes)
+
+
+def pareto(results):
+    """Results whose scores no other result matches or beats on every score."""
+    front = []
+    for params, scores in sorted(results, key=lambda r: r[1]):
+        if not any(all(o <= s for o, s in zip(other, scores)) for _, other in front):
+            front.append((params, scores))
+    return front
+
+
+def valid(params):
+    # Same check as params_valid() in tuning.c.
+    return params["tapping_term"] > params["index_tap_term_diff"]
+
+
+#------------------------------------------------------------------------------
+# Output
+#------------------------------------------------------------------------------
+def header(params):
+    lines = ["// Tap-hold defaults written by tools/sweep_tuning.py"]
+    for name in model.PARAMS:
+        value = params[name]
+        lines.append("#define TUNING_DEFAULT_%s %s" % (name.upper(), "0x%02X" % value if name == "eager_mods" else value))
+    return "\n".join(lines) + "\n"
+
+
+def crc8(data):
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) if crc & 0x80 else crc << 1
+            crc &= 0xFF
+    return crc
+
+
+def tuning_version():
+    with open(TUNING_H) as f:
+        m = re.search(r"#define\s+TUNING_VERSION\s+(\d+)", f.read())
+    return int(m.group(1))
+
+
+def blob(params):
+    """An image of `tuning_slot_t` with sequence 0. Write it at the start of
+    the tuning area, TUNING_EEPROM_OFFSET in the user EEPROM datablock."""
+    data = struct.pack("<BB%dH" % len(model.PARAMS), tuning_version(), 0, *(params[name] for name in model.PARAMS))
+    return data + bytes([crc8(data)])
+
+
+#------------------------------------------------------------------------------
+# Command line
+#------------------------------------------------------------------------------
+def values(text):
+    """`start:stop:step` with `stop` included, or a comma separated list."""
+    try:
+        if ":" in text:
+            start, stop, step = (int(part, 0) for part in text.split(":"))
+            if step <= 0:
+                raise ValueError
+            return list(range(start, stop + 1, step))
+        return [int(part, 0) for part in text.split(",")]
+    except ValueError:
+        raise argparse.ArgumentTypeError("expected start:stop:step or a list, not %r" % text)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("traces", nargs="*", help="trace files, or globs of them")
+    parser.add_argument("--synthetic", metavar="TEXT", help="type this text file instead of reading traces")
+    parser.add_argument("--wpm", type=float, default=70.0, help="typing speed of --synthetic")
+    parser.add_argument("--sigma", type=float, default=0.45, help="spread of key intervals of --synthetic")
+    parser.add_argument("--seed", type=int, default=1, help="random seed of --synthetic")
+    parser.add_argument("--layout", choices=sorted(model.LAYOUTS), default="colemak")
+    for name in model.PARAMS:
+        parser.add_argument("--" + name.replace("_", "-"), type=values, metavar="RANGE",
+                            default=[model.DEFAULT_PARAMS[name]])
+    parser.add_argument("--jobs", type=int, default=os.cpu_count(), help="worker processes")
+    parser.add_argument("--header", metavar="FILE", help="write the best settings as config.h defines")
+    parser.add_argument("--blob", metavar="FILE", help="write the best settings as a tuning EEPROM slot")
+    args = parser.parse_args()
+
+    keymap = model.Keymap(layout=model.LAYOUTS[args.layout])
+    base_layers = model.BASE_LAYERS
+    try:
+        if args.synthetic:
+            traces = synthetic_traces(args.synthetic, keymap, base_layers, args)
+        else:
+            paths = [path for pattern in args.traces for path in sorted(glob.glob(pattern)) or [pattern]]
+            if not paths:
+                parser.error("no traces given")
+            traces = [(read_trace(path), read_intended(path)) for path in paths]
+    except (OSError, TraceError) as e:
+        print("sweep_tuning: %s" % e, file=sys.stderr)
+        return 1
+
+    grid = [dict(zip(model.PARAMS, combination))
+            for combination in itertools.product(*(getattr(args, name) for name in model.PARAMS))]
+    grid = [params for params in grid if valid(params)]
+    if not grid:
+        print("sweep_tuning: no valid parameter combination", file=sys.stderr)
+        return 1
+    print("%d traces, %d combinations" % (len(traces), len(grid)), file=sys.stderr)
+
+    model.build_firmware()
+    with multiprocessing.Pool(args.jobs, init_worker, (keymap, base_layers, traces)) as pool:
+        results = list(pool.imap_unordered(score, grid, chunksize=max(1, len(grid) // (args.jobs * 8))))
+
+    front = pareto(results)
+    swept = [name for name in model.PARAMS if len(getattr(args, name)) > 1] or model.PARAMS
+    print(" ".join("%8s" % score for score in SCORES) + "  " + " ".join(swept))
+    for params, (errors, latency, flashes) in front:
+        print("%8d %8.1f %8d  %s" % (errors, latency, flashes,
+                                     " ".join("%s=%d" % (name, params[name]) for name in swept)))
+
+    best = front[0][0]
+    if args.header:
+        with open(args.header, "w") as f:
+            f.write(header(best))
+    if args.blob:
+        with open(args.blob, "wb") as f:
+            f.write(blob(best))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,755 @@
+"""Host model of the keymap's tap-hold behaviour.
+
+Shared by sweep_tuning.py and roll_analyzer.py. The keymap layers and keycode
+macros are parsed from keymap.h and keymap.c, so layout changes are picked up
+as they are. A key press goes through two stages on the keyboard:
+
+  - QMK's tapping (action_tapping.c): a tap-hold key released within its
+    tapping term is a tap, otherwise a hold. Permissive hold settles it as held
+    when another key is pressed and released inside the tapping term. This is
+    part of QMK, which is not in this tree, and is modelled in `Simulator`.
+  - features/achordion.c with the keymap's callbacks in tap_hold.c: holds are
+    settled again on the next key press with the chord rule, the typing streak
+    and the timeout. This is the keymap's own C code, built for the host as
+    tools/host/libtap_hold.so (see tap_hold_host.c) and run through `Firmware`.
+    The tapping terms and permissive hold of the first stage come from there
+    too.
+
+Other layouts are derived from the keymap's layers with their permutation
+table, as features/layout_permutation.c does.
+
+Custom keycodes and other process_record_user() handlers (case modes, custom
+shift keys, macros) are not modelled, their keys are output as `<NAME>` tokens.
+One-shot keys are output as tokens when tapped.
+
+Traces typed by `Typist` only exercise the model with itself. To tune on real
+typing, record a trace on the keyboard: build with CONSOLE_ENABLE = yes, turn on
+debug (DB_TOGG), type a text while `qmk console` runs and save its output as
+`<name>.trace` with the text in `<name>.txt`. sweep_tuning.py reads the
+`EVENT:` lines of the log.
+"""
+
+import collections
+import ctypes
+import math
+import os
+import re
+import subprocess
+
+TOOLS = os.path.dirname(os.path.abspath(__file__))
+KEYMAP_C = os.path.join(TOOLS, os.pardir, "keymap.c")
+HOST = os.path.join(TOOLS, "host")
+LIBRARY = os.path.join(HOST, "libtap_hold.so")
+
+MATRIX_ROWS = 14
+
+# Matrix position (col, row) of each LAYOUT_ergodox argument, in the col:row
+# labels of the keymap.c position diagram.
+LAYOUT_POSITIONS = (
+    [(0, r) for r in range(0, 7)]
+    + [(1, r) for r in range(0, 7)]
+    + [(2, r) for r in range(0, 6)]
+    + [(3, r) for r in range(0, 7)]
+    + [(4, r) for r in range(0, 5)]
+    + [(5, 5), (5, 6), (5, 4), (5, 3), (5, 2), (5, 1)]
+    + [(0, r) for r in range(7, 14)]
+    + [(1, r) for r in range(7, 14)]
+    + [(2, r) for r in range(8, 14)]
+    + [(3, r) for r in range(7, 14)]
+    + [(4, r) for r in range(9, 14)]
+    + [(5, 7), (5, 8), (5, 9), (5, 12), (5, 11), (5, 10)]
+)
+
+# Base layers, see `enum layers` in keymap.c.
+BASE_LAYERS = ["COLE"]
+
+# Permutation of each layout in `layout_permutations`, see `enum layouts`.
+LAYOUTS = {"colemak": None, "qwerty": "QWERTY"}
+
+# Layers the layout permutation applies to, as in layout_permutation_layer().
+PERMUTED_LAYERS = ["COLE", "CLET", "CTUR"]
+
+# Settle reasons, see `enum achordion_settle_reason`.
+QMK, PERMISSIVE_HOLD, TIMEOUT, CHORD, STREAK, OTHER_HOLD, NESTED_TAP = range(7)
+REASONS = ["qmk", "permissive hold", "timeout", "chord", "streak", "other hold", "nested tap"]
+
+# Tuning parameters, see `enum tuning_param` and the defaults in tuning.c.
+PARAMS = [
+    "tapping_term",
+    "index_tap_term_diff",
+    "ring_pinky_tap_term_diff",
+    "space_tap_term_diff",
+    "achordion_timeout_diff",
+    "streak_timeout",
+    "space_streak_timeout",
+    "eager_mods",
+]
+DEFAULT_PARAMS = {
+    "tapping_term": 175,
+    "index_tap_term_diff": 25,
+    "ring_pinky_tap_term_diff": 15,
+    "space_tap_term_diff": 25,
+    "achordion_timeout_diff": 100,
+    "streak_timeout": 100,
+    "space_streak_timeout": 50,
+    "eager_mods": 0xEE,
+}
+
+# QMK keycode ranges, see quantum_keycodes.h.
+QK_MOD_TAP = 0x2000
+QK_LAYER_TAP = 0x4000
+QK_MOMENTARY = 0x5220
+QK_ONE_SHOT_LAYER = 0x5280
+QK_ONE_SHOT_MOD = 0x52A0
+QK_LAYER_TAP_TOGGLE = 0x52C0
+QK_USER = 0x7E40
+
+# 8-bit mod masks.
+MOD_BITS = {
+    "LCTL": 0x01, "LSFT": 0x02, "LALT": 0x04, "LGUI": 0x08,
+    "RCTL": 0x10, "RSFT": 0x20, "RALT": 0x40, "RGUI": 0x80,
+}
+SHIFT_BITS = MOD_BITS["LSFT"] | MOD_BITS["RSFT"]
+MOD_KEYCODES = {
+    "KC_LCTL": "LCTL", "KC_LSFT": "LSFT", "KC_LALT": "LALT", "KC_LGUI": "LGUI",
+    "KC_RCTL": "RCTL", "KC_RSFT": "RSFT", "KC_RALT": "RALT", "KC_RGUI": "RGUI",
+    "KC_LEFT_GUI": "LGUI",
+}
+MOD_WRAPPERS = {
+    "LCTL": ["LCTL"], "LSFT": ["LSFT"], "LALT": ["LALT"], "LGUI": ["LGUI"],
+    "RCTL": ["RCTL"], "RSFT": ["RSFT"], "RALT": ["RALT"], "RGUI": ["RGUI"],
+    "C": ["LCTL"], "S": ["LSFT"], "A": ["LALT"], "G": ["LGUI"],
+    "MEH": ["LCTL", "LSFT", "LALT"], "HYPR": ["LCTL", "LSFT", "LALT", "LGUI"],
+}
+MOD_TAP_WRAPPERS = {
+    "MEH_T": ["LCTL", "LSFT", "LALT"], "ALL_T": ["LCTL", "LSFT", "LALT", "LGUI"],
+    "LCTL_T": ["LCTL"], "LSFT_T": ["LSFT"], "LALT_T": ["LALT"], "LGUI_T": ["LGUI"],
+    "RCTL_T": ["RCTL"], "RSFT_T": ["RSFT"], "RALT_T": ["RALT"], "RGUI_T": ["RGUI"],
+}
+
+# HID usages of the basic keycodes the keymap's tap-hold keys use.
+BASIC_CODES = {"KC_%s" % c: 0x04 + i for i, c in enumerate("ABCDEFGHIJKLMNOPQRSTUVWXYZ")}
+BASIC_CODES.update(("KC_%s" % c, 0x1E + i) for i, c in enumerate("1234567890"))
+for names, code in [
+    (("KC_ENTER", "KC_ENT"), 0x28),
+    (("KC_ESCAPE", "KC_ESC"), 0x29),
+    (("KC_BSPC", "KC_BACKSPACE"), 0x2A),
+    (("KC_TAB",), 0x2B),
+    (("KC_SPACE", "KC_SPC"), 0x2C),
+    (("KC_MINS", "KC_MINUS"), 0x2D),
+    (("KC_EQL", "KC_EQUAL"), 0x2E),
+    (("KC_LBRC",), 0x2F),
+    (("KC_RBRC",), 0x30),
+    (("KC_BSLS",), 0x31),
+    (("KC_SCLN",), 0x33),
+    (("KC_QUOT", "KC_QUOTE"), 0x34),
+    (("KC_GRV", "KC_GRAVE"), 0x35),
+    (("KC_COMM", "KC_COMMA"), 0x36),
+    (("KC_DOT",), 0x37),
+    (("KC_SLSH", "KC_SLASH"), 0x38),
+]:
+    for name in names:
+        BASIC_CODES[name] = code
+MOD_CODES = {"LCTL": 0xE0, "LSFT": 0xE1, "LALT": 0xE2, "LGUI": 0xE3,
+             "RCTL": 0xE4, "RSFT": 0xE5, "RALT": 0xE6, "RGUI": 0xE7}
+
+# Characters typed by basic keycodes, unshifted and shifted (US layout).
+CHARS = {}
+for c in "abcdefghijklmnopqrstuvwxyz":
+    CHARS["KC_" + c.upper()] = (c, c.upper())
+for c, s in zip("1234567890", "!@#$%^&*()"):
+    CHARS["KC_" + c] = (c, s)
+for names, pair in [
+    (("KC_SPACE", "KC_SPC"), (" ", " ")),
+    (("KC_ENTER", "KC_ENT"), ("\n", "\n")),
+    (("KC_TAB",), ("\t", "\t")),
+    (("KC_COMM", "KC_COMMA"), (",", "<")),
+    (("KC_DOT",), (".", ">")),
+    (("KC_SLSH", "KC_SLASH"), ("/", "?")),
+    (("KC_QUOT", "KC_QUOTE"), ("'", '"')),
+    (("KC_SCLN",), (";", ":")),
+    (("KC_MINS", "KC_MINUS"), ("-", "_")),
+    (("KC_EQL", "KC_EQUAL"), ("=", "+")),
+    (("KC_LBRC",), ("[", "{")),
+    (("KC_RBRC",), ("]", "}")),
+    (("KC_BSLS",), ("\\", "|")),
+    (("KC_GRV", "KC_GRAVE"), ("`", "~")),
+]:
+    for name in names:
+        CHARS[name] = pair
+
+
+class Key(collections.namedtuple("Key", "name kind tap mods layer code")):
+    """A keycode: `kind` is one of basic, mt, lt, mo, os, mod, trns, no or
+    other.
+
+    `tap` is the basic keycode of basic, mt and lt keys, `mods` an 8-bit mod
+    mask and `layer` the layer of lt, mo and one-shot layer keys. `code` is
+    the 16-bit QMK keycode, custom ones numbered from QK_USER.
+    """
+
+    @property
+    def is_tap_hold(self):
+        return self.kind in ("mt", "lt", "os")
+
+
+TRNS = Key("_______", "trns", None, 0, None, 0x0001)
+
+
+def mods_5bit(mods):
+    """The 5-bit mods of QMK keycodes, of the right hand if any."""
+    return 0x10 | mods >> 4 if mods & 0xF0 else mods
+
+
+#------------------------------------------------------------------------------
+# Keymap parsing
+#------------------------------------------------------------------------------
+def split_args(text):
+    """Splits a macro argument list on top level commas."""
+    args, depth, current = [], 0, []
+    for c in text:
+        if c == "," and depth == 0:
+            args.append("".join(current).strip())
+            current = []
+            continue
+        depth += c == "("
+        depth -= c == ")"
+        current.append(c)
+    if "".join(current).strip():
+        args.append("".join(current).strip())
+    return args
+
+
+def balanced(text, start):
+    """Returns the text inside the parentheses opening at `start`."""
+    depth = 0
+    for i in range(start, len(text)):
+        depth += text[i] == "("
+        depth -= text[i] == ")"
+        if depth == 0:
+            return text[start + 1:i]
+    raise ValueError("unbalanced parentheses")
+
+
+class Keymap:
+    def __init__(self, path=KEYMAP_C, layout=None):
+        source = ""
+        for name in (os.path.join(os.path.dirname(path), "keymap.h"), path):
+            if os.path.exists(name) or name == path:
+                with open(name) as f:
+                    source += f.read() + "\n"
+        source = re.sub(r"/\*.*?\*/", "", source, flags=re.S)
+        lines = [re.sub(r"//.*", "", line) for line in source.splitlines()]
+        source = "\n".join(lines)
+
+        # Object-like and function-like macros.
+        self.defines = {}
+        self.functions = {}
+        for line in re.sub(r"\\\n", " ", source).splitlines():
+            m = re.match(r"\s*#define\s+(\w+)(\([^)]*\))?\s+(.+)", line)
+            if m:
+                (self.functions if m.group(2) else self.defines)[m.group(1)] = m.group(3).strip()
+
+        m = re.search(r"enum\s+layers\s*{(.*?)}", source, re.S)
+        self.layer_names = [name.strip() for name in m.group(1).split(",") if name.strip()]
+
+        # Real layer-tap keys, as listed in the IS_LAYER_TAP() macro.
+        self.layer_taps = set(re.findall(r"\(code\)\s*==\s*(\w+)", self.functions.get("IS_LAYER_TAP", "")))
+
+        m = re.search(r"enum\s+layouts\s*{(.*?)}", source, re.S)
+        self.layout_names = [name.strip() for name in m.group(1).split(",") if name.strip()] if m else []
+
+        # Custom keycodes, numbered as they are met.
+        self.user_codes = {}
+
+        self.layers = {}
+        permutations = {}
+        for m in re.finditer(r"\[(\w+)\]\s*=\s*LAYOUT_ergodox\(", source):
+            args = split_args(balanced(source, m.end() - 1))
+            if len(args) != len(LAYOUT_POSITIONS):
+                raise ValueError("%s: expected %d keys, found %d" % (m.group(1), len(LAYOUT_POSITIONS), len(args)))
+            if m.group(1) in self.layout_names:
+                permutations[m.group(1)] = self.parse_permutation(m.group(1), args)
+            else:
+                self.layers[m.group(1)] = {pos: self.parse(arg) for pos, arg in zip(LAYOUT_POSITIONS, args)}
+
+        if layout:
+            if layout not in permutations:
+                raise ValueError("layout %s has no LAYOUT_ergodox in keymap.c" % layout)
+            self.permute(permutations[layout])
+
+    def expand(self, token):
+        seen = set()
+        while token in self.defines and token not in seen:
+            seen.add(token)
+            token = self.defines[token]
+        return token
+
+    def mods(self, text):
+        bits = 0
+        for name in re.findall(r"MOD_(\w+)", text):
+            bits |= MOD_BITS.get(name, 0)
+        return bits
+
+    def layer(self, text):
+        text = self.expand(text.strip())
+        return text if text in self.layer_names else None
+
+    def key(self, name, kind, tap=None, mods=0, layer=None):
+        return Key(name, kind, tap, mods, layer, self.keycode(name, kind, tap, mods, layer))
+
+    def keycode(self, name, kind, tap, mods, layer):
+        """The QMK keycode of a key, see quantum_keycodes.h."""
+        tap_code = BASIC_CODES.get(tap, 0)
+        layer_index = self.layer_index(layer) if layer else 0
+        if kind == "basic":
+            return mods_5bit(mods) << 8 | tap_code
+        if kind == "mt":
+            return QK_MOD_TAP | mods_5bit(mods) << 8 | tap_code
+        if kind == "lt":
+            return QK_LAYER_TAP | layer_index << 8 | tap_code
+        if kind == "mo":
+            return QK_MOMENTARY | layer_index
+        if kind == "os":
+            return QK_ONE_SHOT_LAYER | layer_index if layer else QK_ONE_SHOT_MOD | mods_5bit(mods)
+        if kind == "mod":
+            mod, bit = next((mod, bit) for mod, bit in MOD_BITS.items() if bit & mods)
+            return mods_5bit(mods & ~bit) << 8 | MOD_CODES[mod]
+        if kind == "no":
+            return 0x0000
+        return self.user_codes.setdefault(name, QK_USER + len(self.user_codes))
+
+    def parse(self, token, name=None):
+        name = name or token
+        text = self.expand(token.strip())
+        if text in ("_______", "KC_TRNS", "KC_TRANSPARENT"):
+            return TRNS
+        if text in ("XXXXXXX", "KC_NO"):
+            return self.key(name, "no")
+        if text in MOD_KEYCODES:
+            return self.key(name, "mod", mods=MOD_BITS[MOD_KEYCODES[text]])
+        if text in CHARS:
+            return self.key(name, "basic", text)
+        m = re.match(r"(\w+)\s*\(", text)
+        if not m:
+            return self.key(name, "other")
+        func, args = m.group(1), split_args(balanced(text, m.end() - 1))
+        if func == "MT":
+            return self.key(name, "mt", self.expand(args[1]), self.mods(self.expand(args[0])))
+        if func in MOD_TAP_WRAPPERS:
+            bits = sum(MOD_BITS[mod] for mod in MOD_TAP_WRAPPERS[func])
+            return self.key(name, "mt", self.expand(args[0]), bits)
+        if func == "LT":
+            return self.key(name, "lt", self.expand(args[1]), layer=self.layer(args[0]))
+        if func == "MO":
+            return self.key(name, "mo", layer=self.layer(args[0]))
+        if func == "OSL":
+            return self.key(name, "os", layer=self.layer(args[0]))
+        if func == "OSM":
+            return self.key(name, "os", mods=self.mods(self.expand(args[0])))
+        if func == "TT" and self.layer(args[0]):
+            # Tap-toggle isn't a tap-hold key for Achordion, only its keycode
+            # is needed.
+            key = self.key(name, "other")
+            return key._replace(code=QK_LAYER_TAP_TOGGLE | self.layer_index(self.layer(args[0])))
+        if func in MOD_WRAPPERS:
+            inner = self.parse(args[0], name)
+            bits = sum(MOD_BITS[mod] for mod in MOD_WRAPPERS[func])
+            return self.key(name, inner.kind, inner.tap, inner.mods | bits, inner.layer)
+        return self.key(name, "other")
+
+    @staticmethod
+    def parse_permutation(name, args):
+        """Maps each moved position to the position it takes its letter from."""
+        moves = {}
+        for pos, arg in zip(LAYOUT_POSITIONS, args):
+            m = re.match(r"FROM\(\s*(\d+)\s*,\s*(\d+)\s*\)$", arg)
+            if m:
+                moves[pos] = (int(m.group(1)), int(m.group(2)))
+            elif arg != "SAME":
+                raise ValueError("%s: expected SAME or FROM(col, row), found %s" % (name, arg))
+        return moves
+
+    def permute(self, moves):
+        """Same lookup as `keycode_at_keymap_location()` with a permutation."""
+        base = self.layers[BASE_LAYERS[0]]
+        permuted = {}
+        for name in PERMUTED_LAYERS:
+            layer = dict(self.layers[name])
+            for pos, source in moves.items():
+                key = self.layers[name][pos]
+                if key.kind in ("basic", "mt") and not (key.kind == "basic" and key.mods):
+                    tap = base[source].tap
+                    layer[pos] = self.key(tap if key.kind == "basic" else "MT(0x%02X, %s)" % (key.mods, tap),
+                                          key.kind, tap, key.mods)
+                else:
+                    layer[pos] = self.layers[name][source]
+            permuted[name] = layer
+        self.layers.update(permuted)
+
+    def layer_index(self, layer):
+        return self.layer_names.index(layer)
+
+    def key_at(self, pos, layers):
+        """Keycode at `pos` with `layers` active, highest layer first."""
+        for layer in sorted(layers, key=self.layer_index, reverse=True):
+            key = self.layers.get(layer, {}).get(pos, TRNS)
+            if key.kind != "trns":
+                return key
+        return TRNS
+
+    def char_positions(self, base_layers):
+        """Maps each character typed by a plain key on the base layers to
+        (pos, shifted). Characters needing another layer are left out."""
+        chars = {}
+        for pos in LAYOUT_POSITIONS:
+            key = self.key_at(pos, base_layers)
+            if key.kind in ("basic", "mt", "lt") and key.tap in CHARS and (key.kind != "basic" or not key.mods):
+                plain, shifted = CHARS[key.tap]
+                chars.setdefault(plain, (pos, False))
+                chars.setdefault(shifted, (pos, True))
+        return chars
+
+
+#------------------------------------------------------------------------------
+# Keymap tap-hold code, see tools/host/tap_hold_host.c
+#------------------------------------------------------------------------------
+class Entry(ctypes.Structure):
+    """`tap_hold_host_entry_t`: a record passed on, a decision or eager mods."""
+
+    _fields_ = [
+        ("time", ctypes.c_uint32),
+        ("event_time", ctypes.c_uint32),
+        ("keycode", ctypes.c_uint16),
+        ("kind", ctypes.c_uint8),
+        ("row", ctypes.c_uint8),
+        ("col", ctypes.c_uint8),
+        ("pressed", ctypes.c_uint8),
+        ("tap", ctypes.c_uint8),
+        ("value", ctypes.c_uint8),
+    ]
+
+
+ENTRY_RECORD, ENTRY_SETTLED, ENTRY_MODS = range(3)
+MAX_ENTRIES = 256
+
+library = None
+
+
+def build_firmware():
+    """Builds libtap_hold.so when it is out of date. Command line tools call
+    this before starting worker processes, which only load it."""
+    subprocess.run(["make", "-s", "-C", HOST, "libtap_hold.so"], check=True)
+
+
+def load_firmware():
+    global library
+    if library is None:
+        if not os.path.exists(LIBRARY):
+            build_firmware()
+        library = ctypes.CDLL(LIBRARY)
+        u8, u16, u32 = ctypes.c_uint8, ctypes.c_uint16, ctypes.c_uint32
+        library.tap_hold_host_set_param.argtypes = [u8, u16]
+        library.tap_hold_host_set_layers.argtypes = [u32]
+        library.tap_hold_host_tapping_term.argtypes = [u16, u8, u8]
+        library.tap_hold_host_tapping_term.restype = u16
+        library.tap_hold_host_permissive_hold.argtypes = [u16, u8, u8]
+        library.tap_hold_host_permissive_hold.restype = ctypes.c_bool
+        library.tap_hold_host_advance.argtypes = [u32]
+        library.tap_hold_host_record.argtypes = [u16, u8, u8, ctypes.c_bool, u8, u32, u32]
+    return library
+
+
+class Firmware:
+    """features/achordion.c and the callbacks in tap_hold.c, as the keyboard
+    runs them.
+
+    The C code keeps its state in statics, so there is one per process: a
+    replay has to end with all keys released, and some idle time, before the
+    next one starts.
+    """
+
+    def __init__(self, params):
+        self.lib = load_firmware()
+        self.entries = (Entry * MAX_ENTRIES).in_dll(self.lib, "tap_hold_host_entries")
+        self.entry_count = ctypes.c_uint16.in_dll(self.lib, "tap_hold_host_entry_count")
+        self.lib.tap_hold_host_start()
+        for param, name in enumerate(PARAMS):
+            self.lib.tap_hold_host_set_param(param, params[name])
+
+    def tapping_term(self, key, pos):
+        return self.lib.tap_hold_host_tapping_term(key.code, pos[1], pos[0])
+
+    def permissive_hold(self, key, pos):
+        return self.lib.tap_hold_host_permissive_hold(key.code, pos[1], pos[0])
+
+    def set_layers(self, state):
+        """Calls layer_state_set_user() with a bit per active layer."""
+        self.lib.tap_hold_host_set_layers(state)
+
+    def advance(self, time):
+        """Runs achordion_task() every ms up to `time`, returns the entries."""
+        self.lib.tap_hold_host_advance(time)
+        return self.entries[:self.entry_count.value]
+
+    def record(self, key, record, now):
+        """Calls process_achordion() at `now`, returns the entries."""
+        self.lib.tap_hold_host_record(key.code, record.pos[1], record.pos[0], record.pressed, record.tap,
+                                      record.time, now)
+        return self.entries[:self.entry_count.value]
+
+
+#------------------------------------------------------------------------------
+# Simulation
+#------------------------------------------------------------------------------
+Event = collections.namedtuple("Event", "time pos pressed")
+
+
+class Record:
+    __slots__ = ("pos", "pressed", "time", "tap")
+
+    def __init__(self, pos, pressed, time, tap=0):
+        self.pos, self.pressed, self.time, self.tap = pos, pressed, time, tap
+
+
+class Observer:
+    """Receives the decisions made during a simulation."""
+
+    def settled(self, key, record, hold, reason, now, other_key=None, other_record=None):
+        """A tap-hold key was settled, as misfire_settled() is told.
+        `other_key` is the first key pressed after it, if that came before
+        the decision."""
+        pass
+
+    def eager_flash(self, key, record):
+        """Eager mods were applied, but the key was not held."""
+        pass
+
+    def output(self, token, record, now):
+        pass
+
+
+class Simulator:
+    def __init__(self, keymap, base_layers, params=None, observer=None):
+        self.keymap = keymap
+        self.firmware = Firmware(dict(DEFAULT_PARAMS, **(params or {})))
+        self.base_layers = set(base_layers)
+        self.observer = observer or Observer()
+        self.layers = set()
+        self.mods = 0
+        # Keycode each pressed key resolved to, used for its release.
+        self.pressed_keys = {}
+        self.tap_counts = {}
+        self.tapping_terms = {}
+        # QMK tapping state.
+        self.tapping = None
+        self.buffer = []
+        # Key of each press handed to the firmware, for the records it sends
+        # on.
+        self.delivered = {}
+        # Tap-hold presses the firmware hasn't settled, with the first press
+        # after each.
+        self.unsettled = {}
+        # Tap-hold key and record with eager mods applied.
+        self.eager = None
+        self.firmware.set_layers(0)
+
+    def active_layers(self):
+        return self.base_layers | self.layers
+
+    def layer_state(self):
+        return sum(1 << self.keymap.layer_index(layer) for layer in self.layers)
+
+    def tapping_term(self, key, pos):
+        if (key, pos) not in self.tapping_terms:
+            self.tapping_terms[(key, pos)] = self.firmware.tapping_term(key, pos)
+        return self.tapping_terms[(key, pos)]
+
+    # Timers -----------------------------------------------------------------
+    def advance(self, time):
+        """Runs timers that expire up to and including `time`."""
+        while self.tapping is not None and self.tapping[2].time + self.tapping[3] <= time:
+            self.resolve_tapping_hold(self.tapping[2].time + self.tapping[3])
+        self.drain(self.firmware.advance(time))
+
+    def run(self, events):
+        for event in events:
+            self.advance(event.time)
+            self.tapping_event(event, event.time)
+        if events:
+            self.advance(events[-1].time + 60000)
+
+    # QMK tapping ------------------------------------------------------------
+    def resolve(self, event):
+        if event.pressed:
+            key = self.keymap.key_at(event.pos, self.active_layers())
+        else:
+            key = self.pressed_keys.get(event.pos, TRNS)
+        return key
+
+    def tapping_event(self, event, now):
+        if self.tapping is None:
+            key = self.resolve(event)
+            if event.pressed and key.is_tap_hold:
+                self.tapping = (event, key, Record(event.pos, True, event.time), self.tapping_term(key, event.pos))
+                self.pressed_keys[event.pos] = key
+                return
+            if event.pressed:
+                self.pressed_keys[event.pos] = key
+            self.deliver(key, Record(event.pos, event.pressed, event.time, self.tap_counts.get(event.pos, 0)), now)
+            return
+
+        tap_event, key, record, _ = self.tapping
+        if not event.pressed and event.pos == tap_event.pos:
+            # Released within the tapping term.
+            self.tapping = None
+            self.tap_counts[event.pos] = 1
+            record.tap = 1
+            self.deliver(key, record, now)
+            self.deliver(key, Record(event.pos, False, event.time, 1), now)
+            self.flush(now)
+            return
+
+        self.buffer.append(event)
+        if (not event.pressed and self.firmware.permissive_hold(key, tap_event.pos)
+                and any(e.pos == event.pos and e.pressed for e in self.buffer[:-1])):
+            self.resolve_tapping_hold(now)
+
+    def resolve_tapping_hold(self, now):
+        _, key, record, _ = self.tapping
+        self.tapping = None
+        self.tap_counts[record.pos] = 0
+        self.deliver(key, record, now)
+        self.flush(now)
+
+    def flush(self, now):
+        events, self.buffer = self.buffer, []
+        for event in events:
+            self.tapping_event(event, now)
+
+    # Keymap -----------------------------------------------------------------
+    def deliver(self, key, record, now):
+        """Hands a record from QMK's tapping to process_record_user()."""
+        if record.pressed:
+            self.delivered[record.pos] = key
+            for pos, other in self.unsettled.items():
+                if other is None and pos != record.pos:
+                    self.unsettled[pos] = (key, record)
+            if key.is_tap_hold and record.tap == 0:
+                self.unsettled[record.pos] = None
+        self.drain(self.firmware.record(key, record, now), key, record)
+        if not record.pressed:
+            self.unsettled.pop(record.pos, None)
+
+    def drain(self, entries, key=None, record=None):
+        """Follows what the firmware did while handling `record`, or while
+        time went by."""
+        for entry in entries:
+            pos = (entry.col, entry.row)
+            if entry.kind == ENTRY_RECORD:
+                self.output(self.delivered.get(pos, TRNS), Record(pos, bool(entry.pressed), entry.event_time, entry.tap),
+                            entry.time)
+            elif entry.kind == ENTRY_SETTLED:
+                hold, reason = bool(entry.value & 0x80), entry.value & 0x7F
+                other = self.unsettled.pop(pos, None)
+                if other is None or reason == TIMEOUT:
+                    other = (None, None)
+                tap_hold_key, tap_hold_record = self.delivered.get(pos, TRNS), Record(pos, True, entry.event_time)
+                self.observer.settled(tap_hold_key, tap_hold_record, hold, reason, entry.time, *other)
+                if self.eager and self.eager[1].pos == pos:
+                    if not hold:
+                        self.observer.eager_flash(*self.eager)
+                    self.eager = None
+            elif entry.pressed:
+                self.eager = (key, record)
+            elif self.eager:
+                # Cleared on release, before anything settled the key.
+                self.observer.eager_flash(*self.eager)
+                self.eager = None
+
+    # Output -----------------------------------------------------------------
+    def emit(self, key, record, now):
+        mods = self.mods | key.mods if key.kind == "basic" else self.mods
+        if key.tap in CHARS and mods & ~SHIFT_BITS == 0:
+            token = CHARS[key.tap][1 if mods & SHIFT_BITS else 0]
+        else:
+            names = [name for name, bit in MOD_BITS.items() if mods & bit]
+            token = "<%s>" % "+".join(names + [key.tap or key.name])
+        self.observer.output(token, record, now)
+
+    def output(self, key, record, now):
+        kind = key.kind
+        if kind in ("mt", "lt", "os") and record.tap:
+            if record.pressed and kind == "os":
+                # One-shot keys are not modelled.
+                self.observer.output("<%s>" % key.name, record, now)
+            elif record.pressed:
+                self.emit(key, record, now)
+        elif kind in ("mt", "mod") or (kind == "os" and not key.layer):
+            if record.pressed:
+                self.mods |= key.mods
+            else:
+                self.mods &= ~key.mods
+        elif kind in ("lt", "mo", "os"):
+            if key.layer:
+                if record.pressed:
+                    self.layers.add(key.layer)
+                else:
+                    self.layers.discard(key.layer)
+                self.firmware.set_layers(self.layer_state())
+        elif record.pressed and kind == "basic":
+            self.emit(key, record, now)
+        elif record.pressed and kind == "other":
+            self.observer.output("<%s>" % key.name, record, now)
+
+
+#------------------------------------------------------------------------------
+# Synthetic typing
+#------------------------------------------------------------------------------
+class Typist:
+    """Turns text into key events with random timing.
+
+    Key presses follow each other with log-normally distributed intervals
+    averaging `wpm` words (of 5 characters) per minute, and each key is held
+    for a normally distributed time. Both vary per keystroke, so fast rolls
+    overlap the next key as they do on a real keyboard.
+
+    Characters are typed unshifted. Characters that the base layers can't type
+    directly end a burst: nothing is typed for `pause` ms.
+    """
+
+    def __init__(self, keymap, base_layers, rng, wpm=70.0, sigma=0.45, hold=95.0, hold_sd=25.0, pause=1000):
+        self.chars = keymap.char_positions(base_layers)
+        self.rng = rng
+        self.interval = 60000.0 / (wpm * 5)
+        self.sigma = sigma
+        self.hold = hold
+        self.hold_sd = hold_sd
+        self.pause = pause
+
+    def events(self, text, start=0.0):
+        """Returns (events, typed) where `typed` has the characters that were
+        actually typed, for comparison with the output."""
+        rng = self.rng
+        mu = math.log(self.interval) - self.sigma ** 2 / 2
+        time = start
+        release_at = {}
+        events, typed = [], []
+        for c in text:
+            entry = self.chars.get(c.lower())
+            if entry is None or entry[1]:
+                time += self.pause
+                continue
+            pos = entry[0]
+            time += rng.lognormvariate(mu, self.sigma)
+            # A key can't be pressed again before it is released.
+            if release_at.get(pos, -1) >= time:
+                time = release_at[pos] + 1
+            press = int(time)
+            release = press + max(20, int(rng.gauss(self.hold, self.hold_sd)))
+            release_at[pos] = release
+            events.append(Event(press, pos, True))
+            events.append(Event(release, pos, False))
+            typed.append(c.lower())
+        events.sort(key=lambda e: (e.time, not e.pressed))
+        return events, typed